@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Builds relocation-record sized arrays three ways: the old realloc per
+// insert ArrayUtil_add, the geometric ArrayUtil_add and stb_ds arrput.
+//
+#include "../src/arrayutil.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define STB_DS_IMPLEMENTATION
+#include "../src/stb_ds.h"
+
+struct reloc {
+    uint8_t  src_type;
+    uint8_t  flags;
+    uint16_t offset;
+    uint16_t target1;
+    uint16_t target2;
+};
+
+ArrayUtil_type(RelocArr, struct reloc);
+
+// What ArrayUtil_add used to do, minus the write one past the end
+#define OldArrayUtil_add(array, item) \
+    array.len++; \
+    array.items = realloc(array.items, sizeof(*array.items) * array.len); \
+    array.items[array.len - 1] = item
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static struct reloc make(size_t i) {
+    struct reloc r = { (uint8_t)i, (uint8_t)(i >> 8), (uint16_t)i, 1, 2 };
+    return r;
+}
+
+static volatile uint64_t sink;
+
+static double bench_old(size_t n, int reps) {
+    double start = now();
+    for (int r = 0; r < reps; r++) {
+        struct { size_t len; struct reloc *items; } arr = { 0, NULL };
+        for (size_t i = 0; i < n; i++) {
+            OldArrayUtil_add(arr, make(i));
+        }
+        sink += arr.items[n - 1].offset;
+        free(arr.items);
+    }
+    return (now() - start) / reps;
+}
+
+static double bench_new(size_t n, int reps) {
+    double start = now();
+    for (int r = 0; r < reps; r++) {
+        RelocArr arr;
+        ArrayUtil_create(arr);
+        for (size_t i = 0; i < n; i++) {
+            if (ArrayUtil_add(arr, make(i)) < 0)
+                abort();
+        }
+        sink += arr.items[n - 1].offset;
+        ArrayUtil_free(arr);
+    }
+    return (now() - start) / reps;
+}
+
+static double bench_bulk(size_t n, int reps, const struct reloc *src) {
+    double start = now();
+    for (int r = 0; r < reps; r++) {
+        RelocArr arr;
+        ArrayUtil_create(arr);
+        for (size_t i = 0; i < n; i += 256) {
+            size_t chunk = n - i < 256 ? n - i : 256;
+            if (ArrayUtil_append(arr, src + i, chunk) < 0)
+                abort();
+        }
+        sink += arr.items[n - 1].offset;
+        ArrayUtil_free(arr);
+    }
+    return (now() - start) / reps;
+}
+
+static double bench_stb(size_t n, int reps) {
+    double start = now();
+    for (int r = 0; r < reps; r++) {
+        struct reloc *arr = NULL;
+        for (size_t i = 0; i < n; i++)
+            arrput(arr, make(i));
+        sink += arr[n - 1].offset;
+        arrfree(arr);
+    }
+    return (now() - start) / reps;
+}
+
+int main(void) {
+    static const size_t sizes[] = { 16, 256, 4096, 65536 };
+
+    printf("%8s %14s %14s %14s %14s\n",
+        "items", "old add", "ArrayUtil_add", "append x256", "stb arrput");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        int reps = (int)(4000000 / n);
+        if (reps < 5)
+            reps = 5;
+
+        struct reloc *src = malloc(n * sizeof(*src));
+        for (size_t i = 0; i < n; i++)
+            src[i] = make(i);
+
+        printf("%8zu %11.2f us %11.2f us %11.2f us %11.2f us\n",
+            n,
+            bench_old(n, reps) * 1e6,
+            bench_new(n, reps) * 1e6,
+            bench_bulk(n, reps, src) * 1e6,
+            bench_stb(n, reps) * 1e6);
+
+        free(src);
+    }
+
+    return 0;
+}
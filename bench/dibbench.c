@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Decodes synthetic DIBs (icons, cursors and bitmaps of every depth, some
+// with widths that leave tails for the scalar code) with each kernel set
+// the CPU has, checks they all give the scalar result and prints pixels
+// per second.
+//
+#include "../src/dib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct profile {
+    const char *name;
+    enum NE_dibKind kind;
+    uint16_t bpp;
+    uint32_t width;
+    uint32_t height;
+    int core;           // BITMAPCOREHEADER instead of BITMAPINFOHEADER
+    int top_down;
+};
+
+static const struct profile profiles[] = {
+    { "icon 32x32 4bpp",     NE_DIB_ICON,   4,  32,  32, 0, 0 },
+    { "icon 32x32 1bpp",     NE_DIB_ICON,   1,  32,  32, 0, 0 },
+    { "icon 16x16 8bpp",     NE_DIB_ICON,   8,  16,  16, 0, 0 },
+    { "cursor 32x32 1bpp",   NE_DIB_CURSOR, 1,  32,  32, 0, 0 },
+    { "bitmap 640x480 1bpp", NE_DIB_BITMAP, 1, 640, 480, 0, 0 },
+    { "bitmap 640x480 4bpp", NE_DIB_BITMAP, 4, 640, 480, 0, 0 },
+    { "bitmap 640x480 8bpp", NE_DIB_BITMAP, 8, 640, 480, 0, 1 },
+    { "bitmap 640x480 24bpp", NE_DIB_BITMAP, 24, 640, 480, 0, 0 },
+    { "bitmap 333x77 4bpp",  NE_DIB_BITMAP, 4, 333,  77, 1, 0 },
+    { "bitmap 333x77 24bpp", NE_DIB_BITMAP, 24, 333, 77, 0, 0 },
+};
+
+static uint32_t seed = 0x2545F491;
+
+static uint8_t rnd(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (uint8_t)seed;
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint8_t *make_dib(const struct profile *pf, size_t *size) {
+    size_t hotspot = pf->kind == NE_DIB_CURSOR ? 4 : 0;
+    size_t hdr = pf->core ? 12 : 40;
+    size_t entry = pf->core ? 3 : 4;
+    size_t colors = pf->bpp <= 8 ? (size_t)1 << pf->bpp : 0;
+    size_t stride = ((pf->width * pf->bpp + 31) / 32) * 4;
+    size_t mask = pf->kind == NE_DIB_BITMAP ? 0 : ((pf->width + 31) / 32) * 4 * pf->height;
+    uint32_t rows = pf->kind == NE_DIB_BITMAP ? pf->height : pf->height * 2;
+
+    *size = hotspot + hdr + colors * entry + stride * pf->height + mask;
+    uint8_t *p = calloc(1, *size);
+    if (!p)
+        abort();
+
+    for (size_t i = 0; i < *size; i++)
+        p[i] = rnd();
+
+    uint8_t *h = p + hotspot;
+    if (hotspot) {
+        put16(p, 3);
+        put16(p + 2, 7);
+    }
+
+    memset(h, 0, hdr);
+    put32(h, (uint32_t)hdr);
+    if (pf->core) {
+        put16(h + 4, (uint16_t)pf->width);
+        put16(h + 6, (uint16_t)rows);
+        put16(h + 8, 1);
+        put16(h + 10, pf->bpp);
+    } else {
+        put32(h + 4, pf->width);
+        put32(h + 8, pf->top_down ? (uint32_t)-(int32_t)rows : rows);
+        put16(h + 12, 1);
+        put16(h + 14, pf->bpp);
+    }
+
+    return p;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+    enum NE_dibIsa best = NE_dibUseIsa(NE_DIB_AVX2);
+    int failed = 0;
+
+    printf("%-22s %8s", "profile", "pixels");
+    for (int isa = NE_DIB_SCALAR; isa <= (int)best; isa++)
+        printf(" %9s Mpx/s", NE_dibIsaName((enum NE_dibIsa)isa));
+    printf("\n");
+
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        const struct profile *pf = &profiles[i];
+        size_t size;
+        uint8_t *dib = make_dib(pf, &size);
+        size_t pixels = (size_t)pf->width * pf->height;
+        uint8_t *expect = NULL;
+        int reps = (int)(20000000 / pixels);
+
+        printf("%-22s %8zu", pf->name, pixels);
+
+        for (int isa = NE_DIB_SCALAR; isa <= (int)best; isa++) {
+            struct NE_image img;
+
+            NE_dibUseIsa((enum NE_dibIsa)isa);
+
+            double start = now();
+            for (int r = 0; r < reps; r++) {
+                if (NE_dibDecode(dib, size, pf->kind, &img) != NE_OK) {
+                    printf("\n%s: failed to decode\n", pf->name);
+                    return 1;
+                }
+                if (r < reps - 1)
+                    NE_imageFree(&img);
+            }
+            double secs = now() - start;
+
+            if (!expect) {
+                expect = img.rgba;
+            } else {
+                if (memcmp(expect, img.rgba, pixels * 4) != 0) {
+                    printf(" %9s DIFFERS", NE_dibIsaName((enum NE_dibIsa)isa));
+                    failed = 1;
+                }
+                NE_imageFree(&img);
+            }
+
+            printf(" %15.1f", pixels * (double)reps / secs / 1e6);
+        }
+
+        printf("\n");
+        free(expect);
+        free(dib);
+    }
+
+    return failed;
+}
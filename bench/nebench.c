@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Parser throughput benchmark. Generates a corpus of synthetic NE files
+// per profile (see negen.h), then times NE_readFile over every file for a
+// few rounds and reports files/s, MB/s, allocations per file and the
+// p50/p99 latency of a single NE_readFile.
+//
+// MB/s is the size of the files over the time, not what the parser read:
+// NE_readFile maps a file and only touches its headers and tables, never
+// segment data or relocation records. Profiles with big segments show
+// huge figures, compare them with files/s, not across profiles.
+//
+// Heap allocations are counted by wrapping malloc, calloc and realloc at
+// link time (see the nebench target in the Makefile), so only calls made
+// by our own code are seen. The arena is reused between files, as in a
+// batch, so the counts are for the steady state.
+//
+#define _GNU_SOURCE
+#include "negen.h"
+#include "../src/ne.h"
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t heap_allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    heap_allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    heap_allocs++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    heap_allocs++;
+    return __real_realloc(ptr, size);
+}
+
+struct profile {
+    const char *name;
+    unsigned files;
+    struct negen_params params;
+};
+
+// seed, segments, seg_size, relocs, modules, import_names, resources,
+// rsrc_size, names
+static struct profile profiles[] = {
+    { "small",     2000, { 1,   2,   512,    8,  2,    8,    4,  256,    8 } },
+    { "typical",    500, { 1,   8,  4096,   64,  4,   32,   24,  512,   64 } },
+    { "relocs",     100, { 1,  32, 16384, 2000, 12,  400,    8,  512,   64 } },
+    { "resources",  200, { 1,   4,  4096,   16,  4,   32, 1500,  256,   32 } },
+    { "names",      200, { 1,   8,  4096,   64,  4,   32,    8,  512, 2000 } },
+    { "large",       20, { 1, 200, 32768, 1000, 20, 1000,  800, 2048, 1000 } },
+};
+
+#define PROFILE_COUNT (sizeof(profiles) / sizeof(profiles[0]))
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double *sorted, size_t n, double p) {
+    size_t i = (size_t)(p * (double)(n - 1) + 0.5);
+    return sorted[i < n ? i : n - 1];
+}
+
+static void usage(void) {
+    fprintf(
+        stderr,
+        "nebench [options]\n"
+        "  -n FILES          files per profile (default: per profile)\n"
+        "  -r ROUNDS         times every file is parsed (default 3)\n"
+        "  -p, --profile P   run only profile P (small, typical, relocs,\n"
+        "                    resources, names, large)\n"
+        "  -d, --dir DIR     write the corpus to DIR and keep it\n"
+        "  -g, --generate    only write the corpus, needs --dir\n"
+        "      --seed N      first seed, file i uses seed N + i\n"
+        "  Overrides for a custom profile:\n"
+        "      --segments N  --seg-size N  --relocs N  --modules N\n"
+        "      --import-names N  --resources N  --rsrc-size N  --names N\n"
+    );
+}
+
+// Write `count` files of one profile into `dir`. Returns the bytes written
+// or 0 on failure.
+static size_t generate(const struct profile *prof, unsigned count, uint32_t seed, const char *dir) {
+    char path[4096];
+    size_t total = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, prof->name);
+    if (mkdir(path, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "nebench: %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        struct negen_params params = prof->params;
+        const char *error;
+        size_t size;
+
+        params.seed = seed + i;
+        uint8_t *data = negen_build(&params, &size, &error);
+        if (!data) {
+            fprintf(stderr, "nebench: %s: %s\n", prof->name, error);
+            return 0;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s/%05u.exe", dir, prof->name, i);
+        FILE *fp = fopen(path, "wb");
+        int ok = fp && fwrite(data, 1, size, fp) == size;
+        if (fp && fclose(fp) != 0)
+            ok = 0;
+        free(data);
+
+        if (!ok) {
+            fprintf(stderr, "nebench: %s: Failed to write: %s\n", path, strerror(errno));
+            return 0;
+        }
+        total += size;
+    }
+
+    return total;
+}
+
+static int run(const struct profile *prof, unsigned count, int rounds, const char *dir, size_t bytes) {
+    struct NE_arena arena;
+    size_t samples = (size_t)count * (size_t)rounds;
+    double *latency = malloc(samples * sizeof(double));
+    uint64_t heap = 0, arena_allocs = 0;
+    double total = 0;
+    char path[4096];
+    size_t n = 0;
+
+    if (!latency)
+        return -1;
+
+    NE_arenaInit(&arena, 0);
+
+    for (int r = 0; r < rounds; r++) {
+        for (unsigned i = 0; i < count; i++) {
+            struct NE_exe exe = {0};
+
+            snprintf(path, sizeof(path), "%s/%s/%05u.exe", dir, prof->name, i);
+            FILE *fp = fopen(path, "rb");
+            if (!fp) {
+                fprintf(stderr, "nebench: %s: %s\n", path, strerror(errno));
+                goto fail;
+            }
+
+            exe.arena = &arena;
+            uint64_t heap_before = heap_allocs;
+            uint64_t arena_before = arena.allocs;
+
+            double start = now();
+            int ret = NE_readFile(fp, &exe);
+            double elapsed = now() - start;
+
+            heap += heap_allocs - heap_before;
+            arena_allocs += arena.allocs - arena_before;
+
+            if (ret < 0) {
+                fprintf(stderr, "nebench: %s: %s\n", path, exe.error);
+                NE_freeExe(&exe);
+                fclose(fp);
+                goto fail;
+            }
+
+            NE_freeExe(&exe);
+            fclose(fp);
+
+            latency[n++] = elapsed;
+            total += elapsed;
+        }
+    }
+
+    qsort(latency, n, sizeof(double), compare_doubles);
+
+    printf(
+        "%-10s %6u %9.1f %10.0f %11.1f %10.1f %11.1f %9.1f %9.1f\n",
+        prof->name,
+        count,
+        bytes / 1024.0 / count,
+        n / total,
+        bytes * (double)rounds / total / (1024.0 * 1024.0),
+        (double)heap / n,
+        (double)arena_allocs / n,
+        percentile(latency, n, 0.50) * 1e6,
+        percentile(latency, n, 0.99) * 1e6
+    );
+
+    NE_arenaFree(&arena);
+    free(latency);
+    return 0;
+
+fail:
+    NE_arenaFree(&arena);
+    free(latency);
+    return -1;
+}
+
+static void cleanup(const char *dir, const struct profile *prof, unsigned count) {
+    char path[4096];
+
+    for (unsigned i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/%s/%05u.exe", dir, prof->name, i);
+        unlink(path);
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", dir, prof->name);
+    rmdir(path);
+}
+
+int main(int argc, char **argv) {
+    struct profile custom = { "custom", 200, {0} };
+    const char *only = NULL;
+    const char *dir = NULL;
+    char tmp_dir[] = "/tmp/nebench-XXXXXX";
+    unsigned files = 0;
+    uint32_t seed = 1;
+    int rounds = 3;
+    int generate_only = 0;
+    int use_custom = 0;
+    int failed = 0;
+    int opt;
+
+    enum {
+        OPT_SEED = 0x100,
+        OPT_SEGMENTS,
+        OPT_SEG_SIZE,
+        OPT_RELOCS,
+        OPT_MODULES,
+        OPT_IMPORT_NAMES,
+        OPT_RESOURCES,
+        OPT_RSRC_SIZE,
+        OPT_NAMES
+    };
+
+    static const struct option long_opts[] = {
+        { "profile",      required_argument, NULL, 'p' },
+        { "dir",          required_argument, NULL, 'd' },
+        { "generate",     no_argument,       NULL, 'g' },
+        { "seed",         required_argument, NULL, OPT_SEED },
+        { "segments",     required_argument, NULL, OPT_SEGMENTS },
+        { "seg-size",     required_argument, NULL, OPT_SEG_SIZE },
+        { "relocs",       required_argument, NULL, OPT_RELOCS },
+        { "modules",      required_argument, NULL, OPT_MODULES },
+        { "import-names", required_argument, NULL, OPT_IMPORT_NAMES },
+        { "resources",    required_argument, NULL, OPT_RESOURCES },
+        { "rsrc-size",    required_argument, NULL, OPT_RSRC_SIZE },
+        { "names",        required_argument, NULL, OPT_NAMES },
+        { "help",         no_argument,       NULL, 'h' },
+        { 0 }
+    };
+
+    negen_defaults(&custom.params);
+
+    while ((opt = getopt_long(argc, argv, "n:r:p:d:gh", long_opts, NULL)) != -1) {
+        unsigned value = optarg ? (unsigned)strtoul(optarg, NULL, 0) : 0;
+
+        switch (opt) {
+            case 'n': files = value; break;
+            case 'r': rounds = (int)value; break;
+            case 'p': only = optarg; break;
+            case 'd': dir = optarg; break;
+            case 'g': generate_only = 1; break;
+            case OPT_SEED: seed = value; break;
+            case OPT_SEGMENTS: custom.params.segments = value; use_custom = 1; break;
+            case OPT_SEG_SIZE: custom.params.seg_size = value; use_custom = 1; break;
+            case OPT_RELOCS: custom.params.relocs = value; use_custom = 1; break;
+            case OPT_MODULES: custom.params.modules = value; use_custom = 1; break;
+            case OPT_IMPORT_NAMES: custom.params.import_names = value; use_custom = 1; break;
+            case OPT_RESOURCES: custom.params.resources = value; use_custom = 1; break;
+            case OPT_RSRC_SIZE: custom.params.rsrc_size = value; use_custom = 1; break;
+            case OPT_NAMES: custom.params.names = value; use_custom = 1; break;
+            case 'h':
+            default:
+                usage();
+                return 1;
+        }
+    }
+
+    if (rounds < 1 || (generate_only && !dir)) {
+        usage();
+        return 1;
+    }
+
+    if (dir) {
+        if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+            fprintf(stderr, "nebench: %s: %s\n", dir, strerror(errno));
+            return 1;
+        }
+    } else if (!(dir = mkdtemp(tmp_dir))) {
+        fprintf(stderr, "nebench: Failed to create a temp dir: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if (!generate_only) {
+        printf(
+            "%-10s %6s %9s %10s %11s %10s %11s %9s %9s\n",
+            "profile", "files", "avg KB", "files/s", "file MB/s",
+            "heap/file", "arena/file", "p50 us", "p99 us"
+        );
+    }
+
+    for (size_t i = 0; i < (use_custom ? 1 : PROFILE_COUNT); i++) {
+        const struct profile *prof = use_custom ? &custom : &profiles[i];
+        unsigned count = files ? files : prof->files;
+
+        if (only && strcmp(only, prof->name) != 0)
+            continue;
+
+        size_t bytes = generate(prof, count, seed, dir);
+        if (!bytes || (!generate_only && run(prof, count, rounds, dir, bytes) < 0))
+            failed = 1;
+
+        if (dir == tmp_dir)
+            cleanup(dir, prof, count);
+    }
+
+    if (dir == tmp_dir)
+        rmdir(dir);
+
+    return failed;
+}
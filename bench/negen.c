@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "negen.h"
+#include "../src/crc32.h"
+#include "../src/ne.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEGEN_NE_OFFSET 0x40
+#define NEGEN_HEADER    0x40
+
+struct negen_buf {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int failed;
+};
+
+static void negen_reserve(struct negen_buf *b, size_t more) {
+    if (b->failed || b->len + more <= b->cap)
+        return;
+
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + more)
+        cap *= 2;
+
+    uint8_t *data = realloc(b->data, cap);
+    if (!data) {
+        b->failed = 1;
+        return;
+    }
+
+    memset(data + b->cap, 0, cap - b->cap);
+    b->data = data;
+    b->cap = cap;
+}
+
+static void negen_put(struct negen_buf *b, const void *src, size_t len) {
+    negen_reserve(b, len);
+    if (b->failed)
+        return;
+
+    memcpy(b->data + b->len, src, len);
+    b->len += len;
+}
+
+static void negen_put8(struct negen_buf *b, uint8_t v) {
+    negen_put(b, &v, 1);
+}
+
+static void negen_put16(struct negen_buf *b, uint16_t v) {
+    uint8_t le[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    negen_put(b, le, 2);
+}
+
+static void negen_put32(struct negen_buf *b, uint32_t v) {
+    negen_put16(b, (uint16_t)v);
+    negen_put16(b, (uint16_t)(v >> 16));
+}
+
+static void negen_pstr(struct negen_buf *b, const char *s) {
+    size_t len = strlen(s);
+    negen_put8(b, (uint8_t)len);
+    negen_put(b, s, len);
+}
+
+static void negen_fill(struct negen_buf *b, uint8_t byte, size_t len) {
+    negen_reserve(b, len);
+    if (b->failed)
+        return;
+
+    memset(b->data + b->len, byte, len);
+    b->len += len;
+}
+
+static void negen_align(struct negen_buf *b, unsigned shift) {
+    size_t unit = (size_t)1 << shift;
+    negen_fill(b, 0, (unit - b->len % unit) % unit);
+}
+
+static void negen_patch16(struct negen_buf *b, size_t at, uint16_t v) {
+    if (b->failed)
+        return;
+
+    b->data[at] = (uint8_t)v;
+    b->data[at + 1] = (uint8_t)(v >> 8);
+}
+
+// xorshift32, never seeded with 0
+static uint32_t negen_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static unsigned negen_below(uint32_t *state, unsigned n) {
+    return n ? negen_next(state) % n : 0;
+}
+
+void negen_defaults(struct negen_params *p) {
+    memset(p, 0, sizeof(*p));
+    p->seed = 1;
+    p->segments = 8;
+    p->seg_size = 4096;
+    p->relocs = 64;
+    p->modules = 4;
+    p->import_names = 32;
+    p->resources = 24;
+    p->rsrc_size = 512;
+    p->names = 64;
+}
+
+static const uint16_t negen_rsrc_types[] = { 1, 2, 3, 4, 5, 6, 9, 14 };
+
+#define NEGEN_RSRC_TYPES (sizeof(negen_rsrc_types) / sizeof(negen_rsrc_types[0]))
+
+static size_t negen_rsrcStrings(const struct negen_params *p) {
+    char name[32];
+    size_t len = 1 + strlen("CUSTOM");
+
+    for (unsigned i = 7; i < p->resources; i += 8)
+        len += 1 + (size_t)snprintf(name, sizeof(name), "RES%u", i);
+    return len;
+}
+
+// Smallest alignment shift that keeps every sector number in 16 bits
+static unsigned negen_shift(const struct negen_params *p, size_t head) {
+    for (unsigned shift = 4; shift < 16; shift++) {
+        size_t unit = (size_t)1 << shift;
+        size_t size = head + unit;
+
+        size += (size_t)p->segments * (p->seg_size + 2 + (size_t)p->relocs * 8 + unit);
+        size += (size_t)p->resources * (p->rsrc_size * 2 + unit);
+
+        if (size >> shift < 0xFFFF)
+            return shift;
+    }
+
+    return 16;
+}
+
+uint8_t *negen_build(const struct negen_params *params, size_t *size, const char **error) {
+    struct negen_params p = *params;
+    struct negen_buf b = {0};
+    uint32_t rng = p.seed ? p.seed : 0x9E3779B9u;
+    char name[32];
+
+    if (p.segments == 0)
+        p.segments = 1;
+    if (p.seg_size < 16)
+        p.seg_size = 16;
+    if (p.seg_size > 0xFFFF)
+        p.seg_size = 0xFFFF;
+    if (p.modules == 0)
+        p.import_names = 0;
+
+    // warm the generator up, small seeds start out poorly mixed
+    for (int i = 0; i < 8; i++)
+        negen_next(&rng);
+
+    unsigned ntypes = p.resources < NEGEN_RSRC_TYPES ? p.resources : NEGEN_RSRC_TYPES;
+    if (p.resources >= 16)
+        ntypes++;               // plus the named "CUSTOM" type
+
+    size_t rsrc_fixed = 2 + (size_t)ntypes * 8 + (size_t)p.resources * 12 + 2;
+    size_t rsrc_len = rsrc_fixed + negen_rsrcStrings(&p) + 1;
+
+    // MZ stub
+    negen_fill(&b, 0, NEGEN_NE_OFFSET);
+    if (!b.failed) {
+        b.data[0] = 'M';
+        b.data[1] = 'Z';
+        b.data[0x18] = 0x40;
+        b.data[0x3C] = NEGEN_NE_OFFSET;
+    }
+
+    // NE header, filled in at the end
+    size_t ne = b.len;
+    negen_fill(&b, 0, NEGEN_HEADER);
+
+    size_t seg_table = b.len;
+    negen_fill(&b, 0, (size_t)p.segments * 8);
+
+    size_t rsrc_table = b.len;
+    negen_fill(&b, 0, rsrc_len);
+
+    // resident names: module name first, then every other export
+    size_t resident = b.len;
+    negen_pstr(&b, "SYNTH");
+    negen_put16(&b, 0);
+    for (unsigned i = 0; i < p.names; i += 2) {
+        snprintf(name, sizeof(name), "Export%05u", i);
+        negen_pstr(&b, name);
+        negen_put16(&b, (uint16_t)(i + 1));
+    }
+    negen_put8(&b, 0);
+
+    // module references point into the imported names table
+    size_t modref = b.len;
+    size_t import_ofs = 1;
+    for (unsigned m = 0; m < p.modules; m++) {
+        negen_put16(&b, (uint16_t)import_ofs);
+        import_ofs += 1 + (size_t)snprintf(name, sizeof(name), "MOD%03u", m);
+    }
+
+    size_t imports = b.len;
+    uint16_t *proc_ofs = calloc(p.import_names ? p.import_names : 1, sizeof(*proc_ofs));
+    negen_put8(&b, 0);
+    for (unsigned m = 0; m < p.modules; m++) {
+        snprintf(name, sizeof(name), "MOD%03u", m);
+        negen_pstr(&b, name);
+    }
+    for (unsigned n = 0; n < p.import_names && proc_ofs; n++) {
+        proc_ofs[n] = (uint16_t)(b.len - imports);
+        snprintf(name, sizeof(name), "PROC%05u", n);
+        negen_pstr(&b, name);
+    }
+
+    // entry table: every export is a fixed entry in segment 1
+    size_t entries = b.len;
+    for (unsigned i = 0; i < p.names; ) {
+        unsigned n = p.names - i < 255 ? p.names - i : 255;
+
+        negen_put8(&b, (uint8_t)n);
+        negen_put8(&b, 1);
+        for (unsigned j = 0; j < n; j++, i++) {
+            negen_put8(&b, 1);  // exported
+            negen_put16(&b, (uint16_t)((i * 16) % p.seg_size));
+        }
+    }
+    negen_put8(&b, 0);
+    size_t entries_end = b.len;
+
+    if (entries_end - ne > 0xFFFF) {
+        free(b.data);
+        free(proc_ofs);
+        *error = "Tables don't fit the 64K the header can address";
+        return NULL;
+    }
+
+    // non-resident names: the description, then the other exports
+    size_t nonres = b.len;
+    negen_pstr(&b, "Synthetic NE executable");
+    negen_put16(&b, 0);
+    for (unsigned i = 1; i < p.names; i += 2) {
+        snprintf(name, sizeof(name), "Export%05u", i);
+        negen_pstr(&b, name);
+        negen_put16(&b, (uint16_t)(i + 1));
+    }
+    negen_put8(&b, 0);
+    size_t nonres_len = b.len - nonres;
+
+    unsigned shift = negen_shift(&p, b.len);
+    if (shift > 15 || nonres_len > 0xFFFF) {
+        free(b.data);
+        free(proc_ofs);
+        *error = "File is too big for 16-bit sector numbers";
+        return NULL;
+    }
+
+    // segments: data all 0xFF so every relocation chain ends at once
+    for (unsigned s = 0; s < p.segments; s++) {
+        negen_align(&b, shift);
+        size_t start = b.len;
+        uint16_t flags = SEGFLAGS_MOVEABLE | (s % 2 ? SEGFLAGS_TYPE_DATA : SEGFLAGS_TYPE_CODE);
+
+        negen_fill(&b, 0xFF, p.seg_size);
+
+        if (p.relocs) {
+            flags |= SEGFLAGS_HAS_RELOCS;
+            negen_put16(&b, (uint16_t)p.relocs);
+
+            for (unsigned r = 0; r < p.relocs; r++) {
+                unsigned pick = negen_below(&rng, 10);
+                uint16_t src = (uint16_t)(negen_below(&rng, p.seg_size / 2 - 1) * 2);
+                uint8_t src_type = pick < 6 ? 3 : 2;
+
+                if (pick < 4 && p.modules) {
+                    // import by ordinal
+                    negen_put8(&b, src_type);
+                    negen_put8(&b, 1);
+                    negen_put16(&b, src);
+                    negen_put16(&b, (uint16_t)(1 + negen_below(&rng, p.modules)));
+                    negen_put16(&b, (uint16_t)(1 + negen_below(&rng, 999)));
+                } else if (pick < 6 && p.import_names && proc_ofs) {
+                    negen_put8(&b, src_type);
+                    negen_put8(&b, 2);
+                    negen_put16(&b, src);
+                    negen_put16(&b, (uint16_t)(1 + negen_below(&rng, p.modules)));
+                    negen_put16(&b, proc_ofs[negen_below(&rng, p.import_names)]);
+                } else if (pick < 9) {
+                    // internal reference to a fixed segment
+                    negen_put8(&b, src_type);
+                    negen_put8(&b, 0);
+                    negen_put16(&b, src);
+                    negen_put8(&b, (uint8_t)(1 + negen_below(&rng, p.segments < 254 ? p.segments : 254)));
+                    negen_put8(&b, 0);
+                    negen_put16(&b, (uint16_t)negen_below(&rng, p.seg_size));
+                } else {
+                    negen_put8(&b, 5);
+                    negen_put8(&b, 3);
+                    negen_put16(&b, src);
+                    negen_put16(&b, (uint16_t)(1 + negen_below(&rng, 6)));
+                    negen_put16(&b, 0);
+                }
+            }
+        }
+
+        size_t at = seg_table + (size_t)s * 8;
+        negen_patch16(&b, at, (uint16_t)(start >> shift));
+        negen_patch16(&b, at + 2, (uint16_t)p.seg_size);
+        negen_patch16(&b, at + 4, flags);
+        negen_patch16(&b, at + 6, (uint16_t)p.seg_size);
+    }
+
+    // resources, round robin over the types
+    size_t at = rsrc_table;
+    size_t strings = rsrc_table + rsrc_fixed;
+    size_t custom_name = strings - rsrc_table;
+
+    negen_patch16(&b, at, (uint16_t)shift);
+    at += 2;
+
+    // "CUSTOM", then "RES<i>" for every 8th resource
+    uint16_t *name_ofs = calloc(p.resources / 8 + 1, sizeof(*name_ofs));
+    if (!b.failed && name_ofs) {
+        size_t ofs = custom_name + 7;
+
+        b.data[strings] = 6;
+        memcpy(b.data + strings + 1, "CUSTOM", 6);
+
+        for (unsigned i = 7; i < p.resources; i += 8) {
+            int len = snprintf(name, sizeof(name), "RES%u", i);
+
+            name_ofs[i / 8] = (uint16_t)ofs;
+            b.data[rsrc_table + ofs] = (uint8_t)len;
+            memcpy(b.data + rsrc_table + ofs + 1, name, (size_t)len);
+            ofs += 1 + (size_t)len;
+        }
+    }
+
+    for (unsigned t = 0; t < ntypes; t++) {
+        unsigned count = 0;
+        for (unsigned i = t; i < p.resources; i += ntypes)
+            count++;
+
+        uint16_t type_id = t < NEGEN_RSRC_TYPES
+            ? (uint16_t)(0x8000 | negen_rsrc_types[t])
+            : (uint16_t)custom_name;
+
+        negen_patch16(&b, at, type_id);
+        negen_patch16(&b, at + 2, (uint16_t)count);
+        at += 8;
+
+        for (unsigned i = t; i < p.resources; i += ntypes) {
+            size_t len = p.rsrc_size / 2 + negen_below(&rng, p.rsrc_size + 1);
+            uint16_t id = (uint16_t)(0x8000 | (i + 1));
+
+            if (i % 8 == 7 && name_ofs)
+                id = name_ofs[i / 8];
+
+            negen_align(&b, shift);
+            size_t start = b.len;
+            negen_reserve(&b, len);
+            for (size_t k = 0; k < len && !b.failed; k++)
+                b.data[b.len++] = (uint8_t)negen_next(&rng);
+
+            negen_patch16(&b, at, (uint16_t)(start >> shift));
+            negen_patch16(&b, at + 2, (uint16_t)((len + ((size_t)1 << shift) - 1) >> shift));
+            negen_patch16(&b, at + 4, 0x0030);
+            negen_patch16(&b, at + 6, id);
+            at += 12;
+        }
+    }
+    negen_align(&b, shift);
+
+    free(proc_ofs);
+
+    if (b.failed || !name_ofs) {
+        free(name_ofs);
+        free(b.data);
+        *error = "Out of memory";
+        return NULL;
+    }
+
+    free(name_ofs);
+
+    // and finally the header
+    uint8_t *h = b.data + ne;
+    struct negen_buf hb = { h, 0, NEGEN_HEADER, 0 };
+    negen_put(&hb, "NE", 2);
+    negen_put8(&hb, 5);                                 // linker 5.10
+    negen_put8(&hb, 10);
+    negen_put16(&hb, (uint16_t)(entries - ne));
+    negen_put16(&hb, (uint16_t)(entries_end - entries));
+    negen_put32(&hb, 0);                                // CRC, below
+    negen_put8(&hb, 0x02);                              // multiple data
+    negen_put8(&hb, 0);
+    negen_put16(&hb, (uint16_t)(p.segments > 1 ? 2 : 1));
+    negen_put16(&hb, 0x400);
+    negen_put16(&hb, 0x1000);
+    negen_put32(&hb, 1u << 16);                         // CS:IP 1:0
+    negen_put32(&hb, (uint32_t)(p.segments > 1 ? 2 : 1) << 16);
+    negen_put16(&hb, (uint16_t)p.segments);
+    negen_put16(&hb, (uint16_t)p.modules);
+    negen_put16(&hb, (uint16_t)nonres_len);
+    negen_put16(&hb, (uint16_t)(seg_table - ne));
+    negen_put16(&hb, (uint16_t)(rsrc_table - ne));
+    negen_put16(&hb, (uint16_t)(resident - ne));
+    negen_put16(&hb, (uint16_t)(modref - ne));
+    negen_put16(&hb, (uint16_t)(imports - ne));
+    negen_put32(&hb, (uint32_t)nonres);
+    negen_put16(&hb, 0);                                // movable entries
+    negen_put16(&hb, (uint16_t)shift);
+    negen_put16(&hb, (uint16_t)ntypes);
+    negen_put8(&hb, 2);                                 // Windows
+    negen_put8(&hb, 0x08);
+    negen_put16(&hb, 0);
+    negen_put16(&hb, 0);
+    negen_put16(&hb, 0);
+    negen_put8(&hb, 10);                                // Windows 3.10
+    negen_put8(&hb, 3);
+
+    uint32_t crc = NE_crc32(0, b.data, b.len);
+    h[8] = (uint8_t)crc;
+    h[9] = (uint8_t)(crc >> 8);
+    h[10] = (uint8_t)(crc >> 16);
+    h[11] = (uint8_t)(crc >> 24);
+
+    *size = b.len;
+    return b.data;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Deterministic generator of synthetic NE executables for benchmarks.
+// The same parameters and seed always give the same bytes. Every table
+// the parser reads is filled in: segments with relocations, resources,
+// resident and non-resident names, the entry table, module references
+// and imported names.
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+struct negen_params {
+    uint32_t seed;
+    unsigned segments;          // at least 1
+    unsigned seg_size;          // bytes of data per segment, up to 0xFFFF
+    unsigned relocs;            // relocation records per segment
+    unsigned modules;           // imported modules
+    unsigned import_names;      // distinct procedures imported by name
+    unsigned resources;         // spread over up to 8 types
+    unsigned rsrc_size;         // average bytes per resource
+    unsigned names;             // exported names, half resident
+};
+
+void negen_defaults(struct negen_params *p);
+
+// malloc'ed image of the executable, NULL if the parameters make a table
+// too big for its 16-bit offsets (`error` says which)
+uint8_t *negen_build(const struct negen_params *p, size_t *size, const char **error);
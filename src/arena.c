@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NE_ARENA_ALIGN 16
+#define NE_ARENA_HEADER \
+    ((sizeof(struct NE_arenaChunk) + NE_ARENA_ALIGN - 1) & ~(size_t)(NE_ARENA_ALIGN - 1))
+
+// After a reset, chunks beyond this much memory are given back so one
+// giant file doesn't pin its memory for the rest of a batch
+#define NE_ARENA_KEEP (4 * 1024 * 1024)
+
+void NE_arenaInit(struct NE_arena *arena, size_t chunk_size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->chunk_size = chunk_size ? chunk_size : NE_ARENA_DEFAULT_CHUNK;
+}
+
+static struct NE_arenaChunk *NE_arenaNewChunk(struct NE_arena *arena, size_t size) {
+    size_t data = size > arena->chunk_size ? size : arena->chunk_size;
+
+    if (data > SIZE_MAX - NE_ARENA_HEADER)
+        return NULL;
+
+    struct NE_arenaChunk *chunk = malloc(NE_ARENA_HEADER + data);
+    if (!chunk)
+        return NULL;
+
+    chunk->next = NULL;
+    chunk->size = data;
+    chunk->used = 0;
+    arena->chunk_allocs++;
+    return chunk;
+}
+
+void *NE_arenaAlloc(struct NE_arena *arena, size_t size) {
+    if (size > SIZE_MAX - NE_ARENA_ALIGN)
+        return NULL;
+
+    size = (size + NE_ARENA_ALIGN - 1) & ~(size_t)(NE_ARENA_ALIGN - 1);
+    if (size == 0)
+        size = NE_ARENA_ALIGN;
+
+    arena->allocs++;
+
+    // reuse chunks left over from before the last reset
+    struct NE_arenaChunk *chunk = arena->cur;
+    while (chunk && chunk->size - chunk->used < size)
+        chunk = chunk->next;
+
+    if (!chunk) {
+        chunk = NE_arenaNewChunk(arena, size);
+        if (!chunk)
+            return NULL;
+
+        if (arena->cur) {
+            chunk->next = arena->cur->next;
+            arena->cur->next = chunk;
+        } else {
+            chunk->next = arena->head;
+            arena->head = chunk;
+        }
+    }
+
+    // small allocations keep filling the chunk we were on, a big one that
+    // went elsewhere doesn't strand the space left in it
+    if (!arena->cur || arena->cur->size - arena->cur->used < NE_ARENA_ALIGN * 4)
+        arena->cur = chunk;
+
+    void *ptr = (char *)chunk + NE_ARENA_HEADER + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void *NE_arenaCalloc(struct NE_arena *arena, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size)
+        return NULL;
+
+    void *ptr = NE_arenaAlloc(arena, count * size);
+    if (ptr)
+        memset(ptr, 0, count * size);
+
+    return ptr;
+}
+
+void NE_arenaReset(struct NE_arena *arena) {
+    size_t kept = 0;
+    struct NE_arenaChunk **link = &arena->head;
+
+    while (*link) {
+        struct NE_arenaChunk *chunk = *link;
+
+        if (kept + chunk->size > NE_ARENA_KEEP && kept > 0) {
+            *link = chunk->next;
+            free(chunk);
+            continue;
+        }
+
+        kept += chunk->size;
+        chunk->used = 0;
+        link = &chunk->next;
+    }
+
+    arena->cur = arena->head;
+}
+
+void NE_arenaFree(struct NE_arena *arena) {
+    struct NE_arenaChunk *chunk = arena->head;
+
+    while (chunk) {
+        struct NE_arenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    arena->head = NULL;
+    arena->cur = NULL;
+}
+
+void NE_arenaAdopt(struct NE_arena *dst, struct NE_arena *src) {
+    if (!src->head)
+        return;
+
+    // append so dst->cur keeps pointing at the chunk it was filling
+    struct NE_arenaChunk **tail = &dst->head;
+    while (*tail)
+        tail = &(*tail)->next;
+
+    *tail = src->head;
+    if (!dst->cur)
+        dst->cur = dst->head;
+
+    dst->chunk_allocs += src->chunk_allocs;
+    dst->allocs += src->allocs;
+
+    src->head = NULL;
+    src->cur = NULL;
+    src->chunk_allocs = 0;
+    src->allocs = 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Bump allocator that owns every table of a parsed NE_exe. Nothing is ever
+// freed on its own: NE_arenaReset rewinds the whole thing in one go and
+// keeps the chunks around for the next file.
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define NE_ARENA_DEFAULT_CHUNK (64 * 1024)
+
+struct NE_arenaChunk {
+    struct NE_arenaChunk *next;
+    size_t size;
+    size_t used;
+};
+
+struct NE_arena {
+    struct NE_arenaChunk *head;
+    struct NE_arenaChunk *cur;  // chunk allocations are coming from
+    size_t chunk_size;
+
+    uint64_t chunk_allocs;      // times malloc was actually called
+    uint64_t allocs;            // NE_arenaAlloc calls
+};
+
+void NE_arenaInit(struct NE_arena *arena, size_t chunk_size);
+void *NE_arenaAlloc(struct NE_arena *arena, size_t size);
+void *NE_arenaCalloc(struct NE_arena *arena, size_t count, size_t size);
+void NE_arenaReset(struct NE_arena *arena);
+void NE_arenaFree(struct NE_arena *arena);
+
+// Move every chunk of `src` into `dst`, leaving `src` empty. Lets a
+// subtask allocate from its own arena and hand the result to the parent.
+void NE_arenaAdopt(struct NE_arena *dst, struct NE_arena *src);
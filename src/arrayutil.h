@@ -9,23 +9,102 @@
  *
  */
 
+//
+// Typed growable arrays. Any struct with `len`, `cap` and `items` members
+// works, ArrayUtil_type declares one:
+//
+//     ArrayUtil_type(NE_SegArr, NE_SegEnt);
+//     NE_SegArr segs;
+//     ArrayUtil_create(segs);
+//     if (ArrayUtil_add(segs, ent) < 0) ...
+//
+// Capacity grows geometrically, so building an n element array costs O(n)
+// copies. The macros that can fail evaluate to 0 or -1 (out of memory, the
+// array is left as it was).
+//
 #pragma once
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#define ArrayUtil_free(array) \
-    if (array.items) { \
-    array.len = 0; \
-    free(array.items); \
-    array.items = NULL; \
+#define ArrayUtil_type(name, type) \
+    typedef struct { \
+    size_t len; \
+    size_t cap; \
+    type *items; \
+    } name
+
+// Make room for at least `need` items in total
+static inline int ArrayUtil_grow(void **items, size_t *cap, size_t need, size_t size) {
+    if (need <= *cap)
+        return 0;
+
+    size_t new_cap = *cap ? *cap : 8;
+    while (new_cap < need) {
+        if (new_cap > SIZE_MAX / 2)
+            return -1;
+        new_cap *= 2;
     }
 
+    if (new_cap > SIZE_MAX / size)
+        return -1;
+
+    void *grown = realloc(*items, new_cap * size);
+    if (!grown)
+        return -1;
+
+    *items = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+#define ArrayUtil_free(array) \
+    do { \
+    free((array).items); \
+    (array).len = 0; \
+    (array).cap = 0; \
+    (array).items = NULL; \
+    } while (0)
 
 #define ArrayUtil_create(array) \
-    array.len = 0; \
-    array.items = malloc(sizeof(*array.items))
+    ((array).len = 0, (array).cap = 0, (array).items = NULL)
+
+#define ArrayUtil_reserve(array, n) \
+    ArrayUtil_grow((void **)&(array).items, &(array).cap, (n), sizeof(*(array).items))
 
 #define ArrayUtil_add(array, item) \
-    array.len++; \
-    array.items = realloc(array.items, sizeof(*array.items) * array.len); \
-    array.items[array.len] = item
+    (((array).len < (array).cap || ArrayUtil_reserve(array, (array).len + 1) == 0) \
+        ? ((array).items[(array).len++] = (item), 0) \
+        : -1)
+
+// Append `n` items copied from `src`
+#define ArrayUtil_append(array, src, n) \
+    (ArrayUtil_reserve(array, (array).len + (n)) == 0 \
+        ? (memcpy((array).items + (array).len, (src), (n) * sizeof(*(array).items)), \
+           (array).len += (n), 0) \
+        : -1)
+
+// Give back unused capacity, e.g. once a table is fully built
+#define ArrayUtil_shrink(array) \
+    ArrayUtil_shrinkTo((void **)&(array).items, &(array).cap, (array).len, sizeof(*(array).items))
+
+static inline int ArrayUtil_shrinkTo(void **items, size_t *cap, size_t len, size_t size) {
+    if (len == *cap)
+        return 0;
+
+    if (len == 0) {
+        free(*items);
+        *items = NULL;
+        *cap = 0;
+        return 0;
+    }
+
+    void *shrunk = realloc(*items, len * size);
+    if (!shrunk)
+        return -1;
+
+    *items = shrunk;
+    *cap = len;
+    return 0;
+}
@@ -0,0 +1,866 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+#include "batch.h"
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stb_ds.h"
+
+// How far the feeder may run ahead of the slot being printed. Keeps memory
+// bounded when one huge file holds up the output of everything behind it.
+#define NE_BATCH_WINDOW_PER_THREAD 64
+
+struct NE_batchTask {
+    void (*fn)(void *arg); // NULL for a whole-file task
+    void *arg;
+    struct NE_batchJob *job;
+    size_t slot;
+};
+
+// Mutex protected ring buffer. Tasks are whole files or whole tables so
+// the lock is never the bottleneck, and it keeps stealing trivially safe.
+struct NE_deque {
+    pthread_mutex_t lock;
+    struct NE_batchTask *items;
+    size_t cap;
+    size_t head;
+    size_t len;
+};
+
+struct NE_batchSlot {
+    char *out;
+    size_t out_len;
+    char *err;
+    size_t err_len;
+    int ret;
+    int done;
+
+    // the callback returned, `done` waits for the holds (NE_batchHold)
+    int finished;
+    int holds;
+    char *late_err;     // what the holders added to `err`
+    size_t late_err_len;
+    int late_failed;
+
+    // streaming only, see NE_batchSubmit
+    char *path;
+    struct NE_ingestFile file;
+    int has_file;
+};
+
+struct NE_batchRun;
+
+struct NE_batchWorker {
+    struct NE_batchRun *run;
+    int id;
+    unsigned seed;
+    pthread_t tid;
+    struct NE_deque files;
+    struct NE_deque subs;
+    struct NE_arena arena;
+    struct NE_batchStats stats;
+};
+
+struct NE_batchJob {
+    struct NE_batchWorker *worker;
+    size_t index;
+    atomic_size_t pending;
+};
+
+struct NE_batchHold {
+    struct NE_batchRun *run;
+    size_t index;
+};
+
+struct NE_batchRun {
+    struct NE_batch *batch;
+    NE_batchFn fn;
+    void *ctx;
+
+    struct NE_batchSlot *slots; // ring, file i is in slots[i % cap]
+    size_t cap;
+    size_t count;
+
+    // streaming only (NE_batchStart): files queued and results handed back
+    // so far, and `submitted` as of NE_batchEndInput or SIZE_MAX
+    size_t submitted;
+    size_t collected;
+    size_t end;
+
+    struct NE_batchWorker *workers;
+    int nworkers;
+    struct NE_ingest *ingest; // files are fed as they finish loading, or NULL
+    int running; // workers whose thread actually started, only they get fed
+
+    atomic_size_t queued; // tasks sitting in any deque
+    int done;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready; // a slot finished
+    pthread_cond_t work;  // a task was queued or the run is over
+    pthread_cond_t room;  // a result was collected, its slot is free
+};
+
+static uint64_t NE_batchNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void NE_dequeInit(struct NE_deque *dq) {
+    pthread_mutex_init(&dq->lock, NULL);
+    dq->items = NULL;
+    dq->cap = dq->head = dq->len = 0;
+}
+
+static void NE_dequeFree(struct NE_deque *dq) {
+    pthread_mutex_destroy(&dq->lock);
+    free(dq->items);
+}
+
+static int NE_dequePush(struct NE_deque *dq, struct NE_batchTask task) {
+    pthread_mutex_lock(&dq->lock);
+
+    if (dq->len == dq->cap) {
+        size_t cap = dq->cap ? dq->cap * 2 : 64;
+        struct NE_batchTask *items = malloc(cap * sizeof(*items));
+        if (!items) {
+            pthread_mutex_unlock(&dq->lock);
+            return -1;
+        }
+
+        // unwrap the ring into the new buffer
+        for (size_t i = 0; i < dq->len; i++)
+            items[i] = dq->items[(dq->head + i) % dq->cap];
+
+        free(dq->items);
+        dq->items = items;
+        dq->cap = cap;
+        dq->head = 0;
+    }
+
+    dq->items[(dq->head + dq->len) % dq->cap] = task;
+    dq->len++;
+
+    pthread_mutex_unlock(&dq->lock);
+    return 0;
+}
+
+// Newest task, the owner's end
+static int NE_dequePopBottom(struct NE_deque *dq, struct NE_batchTask *task) {
+    int got = 0;
+
+    pthread_mutex_lock(&dq->lock);
+    if (dq->len) {
+        dq->len--;
+        *task = dq->items[(dq->head + dq->len) % dq->cap];
+        got = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+
+    return got;
+}
+
+// Oldest task, the thieves' end
+static int NE_dequePopTop(struct NE_deque *dq, struct NE_batchTask *task) {
+    int got = 0;
+
+    pthread_mutex_lock(&dq->lock);
+    if (dq->len) {
+        *task = dq->items[dq->head];
+        dq->head = (dq->head + 1) % dq->cap;
+        dq->len--;
+        got = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+
+    return got;
+}
+
+// Count the task before it becomes visible so a thief can never take
+// `queued` below zero.
+static int NE_batchPush(
+    struct NE_batchRun *run,
+    struct NE_deque *dq,
+    struct NE_batchTask task
+) {
+    atomic_fetch_add(&run->queued, 1);
+
+    if (NE_dequePush(dq, task) < 0) {
+        atomic_fetch_sub(&run->queued, 1);
+        return -1;
+    }
+
+    pthread_mutex_lock(&run->lock);
+    pthread_cond_signal(&run->work);
+    pthread_mutex_unlock(&run->lock);
+    return 0;
+}
+
+static int NE_batchSteal(
+    struct NE_batchWorker *self,
+    struct NE_batchTask *task,
+    int subs_only
+) {
+    struct NE_batchRun *run = self->run;
+    int start = (int)(rand_r(&self->seed) % (unsigned)run->nworkers);
+
+    for (int i = 0; i < run->nworkers; i++) {
+        struct NE_batchWorker *victim = &run->workers[(start + i) % run->nworkers];
+        if (victim == self)
+            continue;
+
+        if (NE_dequePopTop(&victim->subs, task) ||
+            (!subs_only && NE_dequePopTop(&victim->files, task))) {
+            self->stats.steals++;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Own subtasks first (LIFO, they share the file that is still hot in
+// cache), then own files oldest first so output drains in order, then
+// anybody else's work.
+static int NE_batchNextTask(struct NE_batchWorker *self, struct NE_batchTask *task) {
+    if (NE_dequePopBottom(&self->subs, task) ||
+        NE_dequePopTop(&self->files, task) ||
+        NE_batchSteal(self, task, 0)) {
+        atomic_fetch_sub(&self->run->queued, 1);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void NE_batchRunSub(struct NE_batchWorker *self, struct NE_batchTask *task) {
+    task->fn(task->arg);
+    self->stats.subtasks++;
+    atomic_fetch_sub(&task->job->pending, 1);
+}
+
+static struct NE_batchSlot *NE_batchSlotAt(struct NE_batchRun *run, size_t index) {
+    return &run->slots[index % run->cap];
+}
+
+// With run->lock held: the slot is done once its callback returned and
+// every hold was released
+static void NE_batchSettle(struct NE_batchRun *run, struct NE_batchSlot *slot) {
+    if (!slot->finished || slot->holds || slot->done)
+        return;
+
+    if (slot->late_err_len) {
+        char *err = realloc(slot->err, slot->err_len + slot->late_err_len + 1);
+        if (err) {
+            memcpy(err + slot->err_len, slot->late_err, slot->late_err_len);
+            slot->err_len += slot->late_err_len;
+            err[slot->err_len] = '\0';
+            slot->err = err;
+        }
+    }
+    free(slot->late_err);
+    slot->late_err = NULL;
+    slot->late_err_len = 0;
+
+    if (slot->late_failed)
+        slot->ret = -1;
+
+    slot->done = 1;
+    pthread_cond_broadcast(&run->ready);
+}
+
+static void NE_batchRunFile(struct NE_batchWorker *self, struct NE_batchTask *task) {
+    struct NE_batchRun *run = self->run;
+    struct NE_batchSlot *slot = NE_batchSlotAt(run, task->slot);
+    struct NE_batchJob job = { .worker = self, .index = task->slot };
+    const char *path = slot->path ? slot->path : run->batch->paths[task->slot];
+
+    atomic_init(&job.pending, 0);
+
+    FILE *out = open_memstream(&slot->out, &slot->out_len);
+    FILE *err = open_memstream(&slot->err, &slot->err_len);
+
+    if (out && err) {
+        slot->ret = run->fn(&job, path, out, err, run->ctx);
+        NE_batchJoin(&job);
+    } else {
+        slot->ret = -1;
+    }
+
+    if (out)
+        fclose(out);
+    if (err)
+        fclose(err);
+
+    self->stats.files++;
+
+    pthread_mutex_lock(&run->lock);
+    slot->finished = 1;
+    NE_batchSettle(run, slot);
+    pthread_mutex_unlock(&run->lock);
+}
+
+static void *NE_batchWorkerMain(void *arg) {
+    struct NE_batchWorker *self = arg;
+    struct NE_batchRun *run = self->run;
+    struct NE_batchTask task;
+
+    while (1) {
+        if (NE_batchNextTask(self, &task)) {
+            if (task.fn)
+                NE_batchRunSub(self, &task);
+            else
+                NE_batchRunFile(self, &task);
+            continue;
+        }
+
+        uint64_t idle_start = NE_batchNow();
+
+        pthread_mutex_lock(&run->lock);
+        while (!run->done && atomic_load(&run->queued) == 0)
+            pthread_cond_wait(&run->work, &run->lock);
+        int done = run->done && atomic_load(&run->queued) == 0;
+        pthread_mutex_unlock(&run->lock);
+
+        self->stats.idle_ns += NE_batchNow() - idle_start;
+
+        if (done)
+            break;
+    }
+
+    return NULL;
+}
+
+void NE_batchSpawn(struct NE_batchJob *job, void (*fn)(void *arg), void *arg) {
+    struct NE_batchTask task = { .fn = fn, .arg = arg, .job = job };
+
+    atomic_fetch_add(&job->pending, 1);
+    if (NE_batchPush(job->worker->run, &job->worker->subs, task) < 0) {
+        // out of memory for the queue, just do it here
+        NE_batchRunSub(job->worker, &task);
+    }
+}
+
+// Help instead of blocking: run our own subtasks, or steal other files'
+// subtasks, until every subtask of this job has finished somewhere.
+void NE_batchJoin(struct NE_batchJob *job) {
+    struct NE_batchWorker *self = job->worker;
+    struct NE_batchTask task;
+
+    while (atomic_load(&job->pending) > 0) {
+        if (NE_dequePopBottom(&self->subs, &task) ||
+            NE_batchSteal(self, &task, 1)) {
+            atomic_fetch_sub(&self->run->queued, 1);
+            NE_batchRunSub(self, &task);
+            continue;
+        }
+
+        // the rest is running on other workers
+        uint64_t idle_start = NE_batchNow();
+        sched_yield();
+        self->stats.idle_ns += NE_batchNow() - idle_start;
+    }
+}
+
+struct NE_batchHold *NE_batchHold(struct NE_batchJob *job) {
+    struct NE_batchRun *run = job->worker->run;
+    struct NE_batchHold *hold = malloc(sizeof(*hold));
+    if (!hold)
+        return NULL;
+
+    hold->run = run;
+    hold->index = job->index;
+
+    pthread_mutex_lock(&run->lock);
+    NE_batchSlotAt(run, job->index)->holds++;
+    pthread_mutex_unlock(&run->lock);
+    return hold;
+}
+
+void NE_batchRelease(struct NE_batchHold *hold, const char *err, size_t len, int failed) {
+    struct NE_batchRun *run = hold->run;
+
+    pthread_mutex_lock(&run->lock);
+    struct NE_batchSlot *slot = NE_batchSlotAt(run, hold->index);
+
+    // the callback may still be writing `err`, keep this aside until then
+    if (len) {
+        char *late = realloc(slot->late_err, slot->late_err_len + len);
+        if (late) {
+            memcpy(late + slot->late_err_len, err, len);
+            slot->late_err = late;
+            slot->late_err_len += len;
+        }
+    }
+
+    slot->late_failed |= failed;
+    slot->holds--;
+    NE_batchSettle(run, slot);
+    pthread_mutex_unlock(&run->lock);
+    free(hold);
+}
+
+size_t NE_batchIndex(const struct NE_batchJob *job) {
+    return job->index;
+}
+
+int NE_batchTakeFile(struct NE_batchJob *job, struct NE_ingestFile *file) {
+    struct NE_batchRun *run = job->worker->run;
+    struct NE_batchSlot *slot = NE_batchSlotAt(run, job->index);
+
+    // only the job's own worker touches its slot until it's done
+    if (slot->has_file) {
+        *file = slot->file;
+        slot->has_file = 0;
+        return 1;
+    }
+
+    if (!run->ingest)
+        return 0;
+
+    return NE_ingestTake(run->ingest, job->index, file);
+}
+
+struct NE_arena *NE_batchArena(struct NE_batchJob *job) {
+    return &job->worker->arena;
+}
+
+static void NE_batchFeed(struct NE_batchRun *run, size_t slot) {
+    struct NE_batchWorker *w = &run->workers[slot % (size_t)run->running];
+    struct NE_batchTask task = { .slot = slot };
+
+    if (NE_batchPush(run, &w->files, task) < 0) {
+        // can't run it here, the worker's arena isn't ours to use
+        struct NE_batchSlot *s = NE_batchSlotAt(run, slot);
+
+        pthread_mutex_lock(&run->lock);
+        s->ret = -1;
+        s->err = strdup("ned: out of memory queueing file\n");
+        s->err_len = s->err ? strlen(s->err) : 0;
+        s->finished = 1;
+        NE_batchSettle(run, s);
+        pthread_mutex_unlock(&run->lock);
+    }
+}
+
+static void NE_batchIngested(void *ctx, size_t slot) {
+    NE_batchFeed(ctx, slot);
+}
+
+static int NE_batchAddEntry(struct NE_batch *batch, const char *path, int top);
+
+// Every entry of `dir` is added even if some fail, -1 if any did
+static int NE_batchWalkDir(struct NE_batch *batch, const char *dir) {
+    struct dirent **list = NULL;
+    int n = scandir(dir, &list, NULL, alphasort);
+    if (n < 0) {
+        fprintf(stderr, "ned: %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    size_t dir_len = strlen(dir);
+    int ret = 0;
+
+    for (int i = 0; i < n; i++) {
+        const char *name = list[i]->d_name;
+        if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0) {
+            size_t len = dir_len + 1 + strlen(name) + 1;
+            char *child = malloc(len);
+            if (child) {
+                snprintf(child, len, "%s%s%s", dir,
+                    (dir_len && dir[dir_len - 1] == '/') ? "" : "/", name);
+                if (NE_batchAddEntry(batch, child, 0) < 0)
+                    ret = -1;
+                free(child);
+            } else {
+                fprintf(stderr, "ned: %s/%s: %s\n", dir, name, strerror(ENOMEM));
+                ret = -1;
+            }
+        }
+        free(list[i]);
+    }
+
+    free(list);
+    return ret;
+}
+
+// Paths named by the user are followed wherever they point. Symlinked
+// directories found in a walk are skipped, they make cycles too easy.
+static int NE_batchAddEntry(struct NE_batch *batch, const char *path, int top) {
+    struct stat st;
+
+    if ((top ? stat(path, &st) : lstat(path, &st)) != 0) {
+        fprintf(stderr, "ned: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode))
+        return NE_batchWalkDir(batch, path);
+
+    if (S_ISLNK(st.st_mode) && stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+        return 0;
+
+    char *copy = strdup(path);
+    if (!copy) {
+        fprintf(stderr, "ned: %s: %s\n", path, strerror(ENOMEM));
+        return -1;
+    }
+
+    arrput(batch->paths, copy);
+    return 0;
+}
+
+int NE_batchAddPath(struct NE_batch *batch, const char *path) {
+    return NE_batchAddEntry(batch, path, 1);
+}
+
+int NE_batchCPUCount(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+// Allocates `cap` slots and `threads` workers and starts them. The run
+// may have no thread at all, files are then run by whoever queues them.
+static int NE_batchSetup(
+    struct NE_batchRun *run,
+    struct NE_batch *batch,
+    NE_batchFn fn,
+    void *ctx,
+    size_t cap,
+    int threads
+) {
+    run->batch = batch;
+    run->fn = fn;
+    run->ctx = ctx;
+    run->cap = cap;
+    run->end = SIZE_MAX;
+
+    run->slots = calloc(cap, sizeof(*run->slots));
+    run->workers = calloc((size_t)threads, sizeof(*run->workers));
+    if (!run->slots || !run->workers) {
+        free(run->slots);
+        free(run->workers);
+        return -1;
+    }
+
+    atomic_init(&run->queued, 0);
+    pthread_mutex_init(&run->lock, NULL);
+    pthread_cond_init(&run->ready, NULL);
+    pthread_cond_init(&run->work, NULL);
+    pthread_cond_init(&run->room, NULL);
+
+    run->nworkers = threads;
+    for (int t = 0; t < threads; t++) {
+        struct NE_batchWorker *w = &run->workers[t];
+        w->run = run;
+        w->id = t;
+        w->seed = 0x9e3779b9u * (unsigned)(t + 1);
+        NE_dequeInit(&w->files);
+        NE_dequeInit(&w->subs);
+        NE_arenaInit(&w->arena, 0);
+    }
+
+    int started = 0;
+    for (; started < threads; started++) {
+        struct NE_batchWorker *w = &run->workers[started];
+        if (pthread_create(&w->tid, NULL, NE_batchWorkerMain, w) != 0)
+            break;
+    }
+
+    run->running = started;
+    return 0;
+}
+
+static void NE_batchDropFile(struct NE_ingestFile *file) {
+    free(file->data);
+    if (file->fd >= 0)
+        close(file->fd);
+}
+
+// Stops the workers once the queues are empty and keeps their counters in
+// batch->stats
+static void NE_batchTeardown(struct NE_batchRun *run) {
+    struct NE_batch *batch = run->batch;
+    int threads = run->nworkers;
+
+    pthread_mutex_lock(&run->lock);
+    run->done = 1;
+    pthread_cond_broadcast(&run->work);
+    pthread_mutex_unlock(&run->lock);
+
+    for (int t = 0; t < run->running; t++)
+        pthread_join(run->workers[t].tid, NULL);
+
+    // holders still to come back would write to freed slots
+    pthread_mutex_lock(&run->lock);
+    for (size_t i = run->collected; i < run->submitted; i++) {
+        while (NE_batchSlotAt(run, i)->holds)
+            pthread_cond_wait(&run->ready, &run->lock);
+    }
+    pthread_mutex_unlock(&run->lock);
+
+    // results nobody collected
+    for (size_t i = run->collected; i < run->submitted; i++) {
+        struct NE_batchSlot *slot = NE_batchSlotAt(run, i);
+        free(slot->out);
+        free(slot->err);
+        free(slot->path);
+        if (slot->has_file)
+            NE_batchDropFile(&slot->file);
+    }
+
+    free(batch->stats);
+    batch->stats = calloc((size_t)threads, sizeof(*batch->stats));
+    batch->stats_count = batch->stats ? threads : 0;
+
+    for (int t = 0; t < threads; t++) {
+        if (batch->stats)
+            batch->stats[t] = run->workers[t].stats;
+        NE_dequeFree(&run->workers[t].files);
+        NE_dequeFree(&run->workers[t].subs);
+        NE_arenaFree(&run->workers[t].arena);
+    }
+
+    pthread_cond_destroy(&run->room);
+    pthread_cond_destroy(&run->work);
+    pthread_cond_destroy(&run->ready);
+    pthread_mutex_destroy(&run->lock);
+    free(run->workers);
+    free(run->slots);
+}
+
+// Returns the number of files whose callback failed, or -1 if the run
+// couldn't be started at all.
+int NE_runBatch(struct NE_batch *batch, NE_batchFn fn, void *ctx) {
+    struct NE_batchRun run = {0};
+    int failed = 0;
+
+    run.count = arrlenu(batch->paths);
+
+    if (run.count == 0)
+        return 0;
+
+    int threads = batch->threads > 0 ? batch->threads : NE_batchCPUCount();
+    if ((size_t)threads > run.count)
+        threads = (int)run.count;
+
+    if (NE_batchSetup(&run, batch, fn, ctx, run.count, threads) < 0)
+        return -1;
+
+    int started = run.running;
+    size_t window = (size_t)(started ? started : 1) * NE_BATCH_WINDOW_PER_THREAD;
+    size_t fed = 0;
+    int printed = 0;
+
+    struct NE_ingest ingest;
+    memset(&batch->io_stats, 0, sizeof(batch->io_stats));
+
+    if (batch->io_depth > 0 && started > 0) {
+        if (NE_ingestStart(
+            &ingest,
+            batch->paths,
+            run.count,
+            batch->io_depth,
+            batch->io_backend,
+            NE_batchIngested,
+            &run
+        ) == 0) {
+            run.ingest = &ingest;
+            if (window < (size_t)batch->io_depth)
+                window = (size_t)batch->io_depth;
+        } else {
+            fprintf(stderr, "ned: Failed to start %s file loading: %s\n",
+                NE_ingestBackendName(batch->io_backend), strerror(errno));
+        }
+    }
+
+    for (size_t i = 0; i < run.count; i++) {
+        struct NE_batchSlot *slot = NE_batchSlotAt(&run, i);
+
+        // the loader feeds each file to the workers once it's in memory
+        if (run.ingest)
+            NE_ingestAllow(run.ingest, i + window);
+
+        for (; !run.ingest && fed < run.count && fed < i + window; fed++) {
+            if (started == 0) {
+                // no threads at all, do it inline
+                struct NE_batchTask task = { .slot = fed };
+                NE_batchRunFile(&run.workers[0], &task);
+            } else {
+                NE_batchFeed(&run, fed);
+            }
+        }
+
+        pthread_mutex_lock(&run.lock);
+        while (!slot->done)
+            pthread_cond_wait(&run.ready, &run.lock);
+        pthread_mutex_unlock(&run.lock);
+
+        if (slot->out_len) {
+            if (printed && batch->separator)
+                fputs(batch->separator, stdout);
+            fwrite(slot->out, 1, slot->out_len, stdout);
+            printed = 1;
+        }
+        if (slot->err_len)
+            fwrite(slot->err, 1, slot->err_len, stderr);
+
+        free(slot->out);
+        free(slot->err);
+
+        if (slot->ret < 0)
+            failed++;
+    }
+
+    if (run.ingest) {
+        NE_ingestStop(&ingest);
+        batch->io_stats = ingest.stats;
+    }
+
+    NE_batchTeardown(&run);
+    return failed;
+}
+
+struct NE_batchRun *NE_batchStart(struct NE_batch *batch, NE_batchFn fn, void *ctx) {
+    struct NE_batchRun *run = calloc(1, sizeof(*run));
+    if (!run)
+        return NULL;
+
+    int threads = batch->threads > 0 ? batch->threads : NE_batchCPUCount();
+
+    memset(&batch->io_stats, 0, sizeof(batch->io_stats));
+    if (NE_batchSetup(run, batch, fn, ctx, (size_t)threads * NE_BATCH_WINDOW_PER_THREAD, threads) < 0) {
+        free(run);
+        return NULL;
+    }
+
+    return run;
+}
+
+int NE_batchSubmit(struct NE_batchRun *run, const char *path, const struct NE_ingestFile *file) {
+    char *copy = strdup(path);
+    if (!copy)
+        return -1;
+
+    pthread_mutex_lock(&run->lock);
+    while (run->submitted - run->collected >= run->cap)
+        pthread_cond_wait(&run->room, &run->lock);
+
+    size_t index = run->submitted++;
+    struct NE_batchSlot *slot = NE_batchSlotAt(run, index);
+    slot->path = copy;
+    if (file) {
+        slot->file = *file;
+        slot->has_file = 1;
+    }
+    pthread_mutex_unlock(&run->lock);
+
+    if (run->running == 0) {
+        struct NE_batchTask task = { .slot = index };
+        NE_batchRunFile(&run->workers[0], &task);
+    } else {
+        NE_batchFeed(run, index);
+    }
+
+    return 0;
+}
+
+void NE_batchEndInput(struct NE_batchRun *run) {
+    pthread_mutex_lock(&run->lock);
+    run->end = run->submitted;
+    pthread_cond_broadcast(&run->ready);
+    pthread_mutex_unlock(&run->lock);
+}
+
+int NE_batchCollect(struct NE_batchRun *run, struct NE_batchResult *res) {
+    pthread_mutex_lock(&run->lock);
+
+    while (run->collected != run->end &&
+           (run->collected == run->submitted || !NE_batchSlotAt(run, run->collected)->done))
+        pthread_cond_wait(&run->ready, &run->lock);
+
+    if (run->collected == run->end) {
+        run->end = SIZE_MAX;
+        pthread_mutex_unlock(&run->lock);
+        return 0;
+    }
+
+    struct NE_batchSlot *slot = NE_batchSlotAt(run, run->collected);
+    res->out = slot->out;
+    res->out_len = slot->out_len;
+    res->err = slot->err;
+    res->err_len = slot->err_len;
+    res->ret = slot->ret;
+
+    free(slot->path);
+    if (slot->has_file)
+        NE_batchDropFile(&slot->file);
+    memset(slot, 0, sizeof(*slot));
+
+    run->collected++;
+    pthread_cond_signal(&run->room);
+    pthread_mutex_unlock(&run->lock);
+    return 1;
+}
+
+void NE_batchStop(struct NE_batchRun *run) {
+    NE_batchTeardown(run);
+    free(run);
+}
+
+void NE_printBatchStats(const struct NE_batch *batch, FILE *out) {
+    const struct NE_ingestStats *io = &batch->io_stats;
+
+    if (io->files || io->skipped) {
+        fprintf(
+            out,
+            "loader (%s): %llu files, %llu bytes, %llu left to the workers\n",
+            NE_ingestBackendName(io->backend),
+            (unsigned long long)io->files,
+            (unsigned long long)io->bytes,
+            (unsigned long long)io->skipped
+        );
+    }
+
+    for (int t = 0; t < batch->stats_count; t++) {
+        const struct NE_batchStats *st = &batch->stats[t];
+        fprintf(
+            out,
+            "worker %d: %llu files, %llu subtasks, %llu steals, %.3f ms idle\n",
+            t,
+            (unsigned long long)st->files,
+            (unsigned long long)st->subtasks,
+            (unsigned long long)st->steals,
+            st->idle_ns / 1e6
+        );
+    }
+}
+
+void NE_freeBatch(struct NE_batch *batch) {
+    for (size_t i = 0; i < arrlenu(batch->paths); i++)
+        free(batch->paths[i]);
+
+    arrfree(batch->paths);
+    free(batch->stats);
+    batch->stats = NULL;
+    batch->stats_count = 0;
+}
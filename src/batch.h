@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Batch scanning: run one callback per file on a pool of worker threads.
+// Each callback writes into its own memory streams which are copied to the
+// real stdout/stderr strictly in input order, so the output of a batch run
+// doesn't depend on how the threads were scheduled.
+//
+// Every worker owns two deques, one of whole-file tasks and one of
+// subtasks spawned by a running file (e.g. one per table of a big exe).
+// A worker that runs dry steals from the other workers before sleeping,
+// so a few huge files don't leave the rest of the pool idle.
+//
+#pragma once
+#include "arena.h"
+#include "ingest.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct NE_batchJob;
+
+// Returns <0 if the file failed. `out` and `err` are private to the call.
+typedef int (*NE_batchFn)(
+    struct NE_batchJob *job,
+    const char *path,
+    FILE *out,
+    FILE *err,
+    void *ctx
+);
+
+// Per-worker scheduler counters
+struct NE_batchStats {
+    uint64_t files;
+    uint64_t subtasks;
+    uint64_t steals;  // tasks taken from another worker's deque
+    uint64_t idle_ns; // time spent with nothing to run
+};
+
+struct NE_batch {
+    char **paths;   // stb_ds array
+    int threads;    // 0 = one per online core
+    const char *separator; // printed between non-empty outputs, or NULL
+
+    // >0: load up to io_depth files ahead of the workers (see ingest.h)
+    int io_depth;
+    enum NE_ingestBackend io_backend;
+    struct NE_ingestStats io_stats; // after NE_runBatch
+
+    struct NE_batchStats *stats; // one per worker after NE_runBatch
+    int stats_count;
+};
+
+// Output of one file of a streaming run, malloc'd, the caller frees it
+struct NE_batchResult {
+    char *out;
+    size_t out_len;
+    char *err;
+    size_t err_len;
+    int ret;
+};
+
+struct NE_batchRun;
+struct NE_batchHold;
+
+// Add the file, or every file under the directory. What can't be read is
+// reported on stderr and the rest is still added, -1 if anything failed.
+int NE_batchAddPath(struct NE_batch *batch, const char *path);
+int NE_batchCPUCount(void);
+int NE_runBatch(struct NE_batch *batch, NE_batchFn fn, void *ctx);
+void NE_printBatchStats(const struct NE_batch *batch, FILE *out);
+void NE_freeBatch(struct NE_batch *batch);
+
+// Streaming runs, for callers that don't know their files up front: the
+// workers and their arenas stay up until NE_batchStop and results come
+// back in submission order. batch->paths and io_depth aren't used.
+struct NE_batchRun *NE_batchStart(struct NE_batch *batch, NE_batchFn fn, void *ctx);
+
+// Queue `path`, or with `file` set a file that is already in memory; the
+// run takes it over and hands it to the callback through NE_batchTakeFile,
+// `path` only names it then. Blocks while a window of results is waiting to
+// be collected, so it must not run on the collecting thread.
+int NE_batchSubmit(struct NE_batchRun *run, const char *path, const struct NE_ingestFile *file);
+
+// NE_batchCollect returns 0 once everything submitted so far was collected.
+// Submitting after that starts over.
+void NE_batchEndInput(struct NE_batchRun *run);
+
+// Waits for the oldest result not collected yet. Returns 1, or 0 at the
+// end of the input.
+int NE_batchCollect(struct NE_batchRun *run, struct NE_batchResult *res);
+
+// Waits for the files still queued and stops the workers, their counters
+// end up in batch->stats
+void NE_batchStop(struct NE_batchRun *run);
+
+// Queue `fn(arg)` as a subtask of the file being processed. Any worker may
+// run it; NE_batchJoin waits for all of them, running subtasks meanwhile.
+void NE_batchSpawn(struct NE_batchJob *job, void (*fn)(void *arg), void *arg);
+void NE_batchJoin(struct NE_batchJob *job);
+
+// Keep the job's output back after the callback returns, until
+// NE_batchRelease, for work it handed to threads of its own. The worker
+// goes on with the next file meanwhile. NULL if out of memory.
+struct NE_batchHold *NE_batchHold(struct NE_batchJob *job);
+
+// `len` bytes of `err` are appended to the file's error output, and
+// `failed` makes the file count as failed. Any thread may release.
+void NE_batchRelease(struct NE_batchHold *hold, const char *err, size_t len, int failed);
+
+// Position of the job's file in batch->paths
+size_t NE_batchIndex(const struct NE_batchJob *job);
+
+// The job's file as loaded ahead by the ingest backend. The caller owns
+// the fd and buffer. Returns 0 if it wasn't, the file is to be opened as
+// usual then.
+int NE_batchTakeFile(struct NE_batchJob *job, struct NE_ingestFile *file);
+
+// Arena of the worker running the job. It is reset by whoever frees what
+// was allocated from it (NE_freeExe), so it's recycled from file to file.
+struct NE_arena *NE_batchArena(struct NE_batchJob *job);
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include "blobstore.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum {
+    NE_BLOB_CLAIMED = 1,        // stored, or being stored by some worker
+    NE_BLOB_FAILED              // the write failed, the next put retries
+};
+
+int NE_blobstoreInit(struct NE_blobstore *store, const char *dir) {
+    memset(store, 0, sizeof(*store));
+
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+        return -1;
+
+    store->dir = dir;
+    pthread_mutex_init(&store->lock, NULL);
+    return 0;
+}
+
+void NE_blobstoreFree(struct NE_blobstore *store) {
+    free(store->slots);
+    pthread_mutex_destroy(&store->lock);
+    memset(store, 0, sizeof(*store));
+}
+
+void NE_blobstorePath(const struct NE_blobstore *store, uint64_t hash, const char *ext, char *path, size_t len) {
+    snprintf(
+        path,
+        len,
+        "%s/%02x/%016llx%s%s",
+        store->dir,
+        (unsigned)(hash >> 56),
+        (unsigned long long)hash,
+        ext ? "." : "",
+        ext ? ext : ""
+    );
+}
+
+static int NE_blobstoreWriteAll(int fd, const uint8_t *p, size_t left) {
+    while (left) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (n == 0)
+                errno = EIO;
+            return -1;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+
+    return 0;
+}
+
+// 1 if the blob was written, 0 if it was already on disk
+static int NE_blobstoreWrite(
+    const struct NE_blobstore *store,
+    uint64_t hash,
+    const char *ext,
+    const void *data,
+    size_t size
+) {
+    char path[PATH_MAX];
+    char tmp[PATH_MAX];
+
+    snprintf(tmp, sizeof(tmp), "%s/%02x", store->dir, (unsigned)(hash >> 56));
+    if (mkdir(tmp, 0777) != 0 && errno != EEXIST)
+        return -1;
+
+    NE_blobstorePath(store, hash, ext, path, sizeof(path));
+
+    // left by an earlier run
+    struct stat st;
+    if (stat(path, &st) == 0 && (size_t)st.st_size == size)
+        return 0;
+
+    // same as the cache: a temp file renamed into place, so a blob that
+    // exists is always complete
+    snprintf(tmp, sizeof(tmp), "%s/%02x/.blob-XXXXXX", store->dir, (unsigned)(hash >> 56));
+    int fd = mkstemp(tmp);
+    if (fd < 0)
+        return -1;
+
+    fchmod(fd, 0644);
+
+    int ret = NE_blobstoreWriteAll(fd, data, size);
+    if (close(fd) != 0)
+        ret = -1;
+    if (ret == 0 && rename(tmp, path) != 0)
+        ret = -1;
+
+    if (ret < 0) {
+        int saved = errno;
+        unlink(tmp);
+        errno = saved;
+        return -1;
+    }
+
+    return 1;
+}
+
+int NE_blobstoreWriteFile(const struct NE_blobstore *store, uint64_t hash, const char *ext, const void *data, size_t size) {
+    return NE_blobstoreWrite(store, hash, ext, data, size);
+}
+
+static int NE_blobstoreGrow(struct NE_blobstore *store) {
+    size_t buckets = store->slots ? (store->mask + 1) * 2 : 1024;
+    struct NE_blobSlot *slots = calloc(buckets, sizeof(*slots));
+    if (!slots)
+        return -1;
+
+    size_t mask = buckets - 1;
+    if (store->slots) {
+        for (size_t i = 0; i <= store->mask; i++) {
+            if (!store->slots[i].state)
+                continue;
+
+            size_t slot = store->slots[i].hash & mask;
+            while (slots[slot].state)
+                slot = (slot + 1) & mask;
+            slots[slot] = store->slots[i];
+        }
+        free(store->slots);
+    }
+
+    store->slots = slots;
+    store->mask = mask;
+    return 0;
+}
+
+static struct NE_blobSlot *NE_blobstoreProbe(const struct NE_blobstore *store, uint64_t hash, size_t size) {
+    size_t slot = hash & store->mask;
+
+    while (store->slots[slot].state) {
+        struct NE_blobSlot *s = &store->slots[slot];
+        if (s->hash == hash && s->size == size)
+            break;
+        slot = (slot + 1) & store->mask;
+    }
+
+    return &store->slots[slot];
+}
+
+// Slot of the blob, added if new. NULL if out of memory.
+static struct NE_blobSlot *NE_blobstoreSlot(struct NE_blobstore *store, uint64_t hash, size_t size) {
+    struct NE_blobSlot *s = store->slots ? NE_blobstoreProbe(store, hash, size) : NULL;
+    if (s && s->state)
+        return s;
+
+    // keep the load factor under 1/2
+    if (!store->slots || (store->count + 1) * 2 > store->mask + 1) {
+        if (NE_blobstoreGrow(store) < 0)
+            return NULL;
+        s = NE_blobstoreProbe(store, hash, size);
+    }
+
+    s->hash = hash;
+    s->size = size;
+    s->state = NE_BLOB_FAILED;  // nobody has written it yet
+    store->count++;
+    return s;
+}
+
+int NE_blobstorePut(struct NE_blobstore *store, const void *data, size_t size, uint64_t *hash) {
+    uint64_t h = NE_hash64(data, size, 0);
+    int seen = 0;
+
+    *hash = h;
+    __atomic_fetch_add(&store->total, 1, __ATOMIC_RELAXED);
+
+    // claim the blob before writing, so only one worker writes it
+    pthread_mutex_lock(&store->lock);
+    struct NE_blobSlot *slot = NE_blobstoreSlot(store, h, size);
+    if (slot) {
+        seen = slot->state == NE_BLOB_CLAIMED;
+        slot->state = NE_BLOB_CLAIMED;
+    }
+    pthread_mutex_unlock(&store->lock);
+
+    if (!slot) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int written = seen ? 0 : NE_blobstoreWrite(store, h, NULL, data, size);
+
+    if (written < 0) {
+        int saved = errno;
+
+        // the table may have grown meanwhile, look the slot up again
+        pthread_mutex_lock(&store->lock);
+        NE_blobstoreSlot(store, h, size)->state = NE_BLOB_FAILED;
+        pthread_mutex_unlock(&store->lock);
+
+        errno = saved;
+        return -1;
+    }
+
+    if (written) {
+        __atomic_fetch_add(&store->stored, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&store->stored_bytes, size, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&store->dupes, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&store->dupe_bytes, size, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
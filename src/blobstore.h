@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Content addressed blob store. Each distinct blob is written once, as
+// DIR/xx/xxxxxxxxxxxxxxxx where the name is the XXH64 of its bytes in hex
+// and xx its first two digits. A blob already in the directory, from this
+// run or an earlier one, is never written again.
+//
+// Workers share one store: the set of blobs seen so far is kept under a
+// mutex, the writes themselves happen outside it. A blob is identified by
+// its hash and size.
+//
+#pragma once
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One blob seen this run
+struct NE_blobSlot {
+    uint64_t hash;
+    uint64_t size;
+    int state;                  // 0 = empty slot
+};
+
+struct NE_blobstore {
+    const char *dir;
+    pthread_mutex_t lock;
+    struct NE_blobSlot *slots;  // open addressing, by hash
+    size_t mask;
+    size_t count;
+
+    uint64_t total;             // updated atomically
+    uint64_t stored;            // blobs written
+    uint64_t stored_bytes;
+    uint64_t dupes;             // blobs that were already there
+    uint64_t dupe_bytes;
+};
+
+// Create `dir` if needed. -1 with errno set on failure.
+int NE_blobstoreInit(struct NE_blobstore *store, const char *dir);
+void NE_blobstoreFree(struct NE_blobstore *store);
+
+// Store `size` bytes unless a blob with the same hash exists, and return
+// the hash in `hash`. -1 with errno set if the blob couldn't be written.
+int NE_blobstorePut(struct NE_blobstore *store, const void *data, size_t size, uint64_t *hash);
+
+// Path of the blob named `hash`, with `ext` appended unless it's NULL
+void NE_blobstorePath(const struct NE_blobstore *store, uint64_t hash, const char *ext, char *path, size_t len);
+
+// Write a file derived from some blobs, like an image converted from
+// them, as `hash`.`ext` next to the blobs. The caller makes sure only one
+// thread writes a given name. 1 if it was written, 0 if it was already
+// there from an earlier run, -1 with errno set on failure.
+int NE_blobstoreWriteFile(const struct NE_blobstore *store, uint64_t hash, const char *ext, const void *data, size_t size);
@@ -0,0 +1,635 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+#include "cache.h"
+#include "hash.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NE_CACHE_MAGIC   "NEDCACHE"
+#define NE_CACHE_VERSION 1
+#define NE_CACHE_ENDIAN  0x01020304u
+#define NE_CACHE_NOSTR   0xFFFFFFFFu
+#define NE_CACHE_ALIGN   8
+
+enum {
+    NE_CACHE_STRINGS,   // [len:1][text], referenced by byte offset
+    NE_CACHE_TYPES,     // struct NE_cacheType
+    NE_CACHE_NAMEINFO,  // struct NE_ResNameInfo, every type's in order
+    NE_CACHE_RSRCNAMES, // struct NE_cacheRsrcName
+    NE_CACHE_SEGS,      // FileOffset[], FileSize[], MinAlloc[] then Flags[]
+    NE_CACHE_ENTRIES,   // struct NE_Entry
+    NE_CACHE_EXPORTS,   // struct NE_cacheExport
+    NE_CACHE_IMPORTS,   // uint32_t string offsets
+    NE_CACHE_SECTIONS
+};
+
+// Bytes per counted item of each section
+static const size_t NE_cacheItemSize[NE_CACHE_SECTIONS] = {
+    1, 8, 12, 8, 14, 4, 8, 4
+};
+
+struct NE_cacheSection {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct NE_cacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t endian;
+
+    // identity and contents of the source file
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint64_t content_hash;
+
+    uint64_t length;            // of the whole entry
+    uint32_t HeaderOffset;
+    uint16_t AlignmentShift;
+    uint16_t reserved;
+    uint32_t ModuleName;        // string offsets
+    uint32_t Description;
+    struct NE_header header;
+    struct NE_cacheSection sections[NE_CACHE_SECTIONS];
+};
+
+struct NE_cacheType {
+    uint16_t TypeID;
+    uint16_t ResourceCount;
+    uint32_t Reserved;
+};
+
+struct NE_cacheRsrcName {
+    uint32_t Name;
+    uint16_t Offset;
+    uint16_t reserved;
+};
+
+struct NE_cacheExport {
+    uint32_t Name;
+    uint16_t Ordinal;
+    uint8_t  Resident;
+    uint8_t  reserved;
+};
+
+_Static_assert(sizeof(struct NE_cacheType) == 8, "cache record layout");
+_Static_assert(sizeof(struct NE_cacheRsrcName) == 8, "cache record layout");
+_Static_assert(sizeof(struct NE_cacheExport) == 8, "cache record layout");
+_Static_assert(sizeof(struct NE_ResNameInfo) == 12, "cache record layout");
+_Static_assert(sizeof(struct NE_Entry) == 4, "cache record layout");
+
+static int NE_cacheIdentity(int fd, struct NE_cacheHeader *id) {
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return -1;
+
+    memset(id, 0, sizeof(*id));
+    id->dev = (uint64_t)st.st_dev;
+    id->ino = (uint64_t)st.st_ino;
+    id->size = (uint64_t)st.st_size;
+    id->mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    id->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    return 0;
+}
+
+static void NE_cachePath(const struct NE_cache *cache, const struct NE_cacheHeader *id, char *path, size_t len) {
+    uint64_t key[5] = {
+        id->dev, id->ino, id->size, (uint64_t)id->mtime_sec, (uint64_t)id->mtime_nsec
+    };
+
+    snprintf(
+        path,
+        len,
+        "%s/%016llx.nec",
+        cache->dir,
+        (unsigned long long)NE_hash64(key, sizeof(key), 0)
+    );
+}
+
+static int NE_cacheSameFile(const struct NE_cacheHeader *a, const struct NE_cacheHeader *b) {
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+        a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec;
+}
+
+//
+// Loading
+//
+
+struct NE_cacheView {
+    const uint8_t *data;
+    const struct NE_cacheHeader *hdr;
+    const uint8_t *strings;
+    size_t strings_size;
+};
+
+static const void *NE_cacheSectionData(const struct NE_cacheView *view, int section) {
+    return view->data + view->hdr->sections[section].offset;
+}
+
+static size_t NE_cacheSectionCount(const struct NE_cacheView *view, int section) {
+    return (size_t)view->hdr->sections[section].count;
+}
+
+// Intern a string of the entry. Returns 0 and sets *bad if the offset is
+// out of bounds or the pool is full.
+static NE_strid NE_cacheString(
+    const struct NE_cacheView *view,
+    struct NE_exe *exe,
+    uint32_t ofs,
+    int *bad
+) {
+    if (ofs == NE_CACHE_NOSTR)
+        return 0;
+
+    if (ofs >= view->strings_size || view->strings[ofs] >= view->strings_size - ofs) {
+        *bad = 1;
+        return 0;
+    }
+
+    NE_strid id = NE_strpoolIntern(
+        exe->pool,
+        (const char *)view->strings + ofs + 1,
+        view->strings[ofs]
+    );
+
+    if (!id)
+        *bad = 1;
+    return id;
+}
+
+static void *NE_cacheCopy(struct NE_exe *exe, const void *src, size_t size) {
+    void *dst = NE_arenaAlloc(exe->arena, size ? size : 1);
+    if (dst)
+        memcpy(dst, src, size);
+    return dst;
+}
+
+static int NE_cacheLoadRsrc(const struct NE_cacheView *view, struct NE_exe *exe) {
+    struct NE_ResTable *rsrc = &exe->rsrc;
+    size_t type_count = NE_cacheSectionCount(view, NE_CACHE_TYPES);
+    size_t name_count = NE_cacheSectionCount(view, NE_CACHE_NAMEINFO);
+    size_t str_count = NE_cacheSectionCount(view, NE_CACHE_RSRCNAMES);
+    int bad = 0;
+
+    rsrc->AlignmentShift = view->hdr->AlignmentShift;
+    if (rsrc->AlignmentShift >= 32)
+        return -1;
+
+    rsrc->Types = NE_arenaCalloc(exe->arena, type_count ? type_count : 1, sizeof(NE_ResType));
+    rsrc->NameInfoPool = NE_cacheCopy(
+        exe,
+        NE_cacheSectionData(view, NE_CACHE_NAMEINFO),
+        name_count * sizeof(struct NE_ResNameInfo)
+    );
+
+    if (!rsrc->Types || !rsrc->NameInfoPool)
+        return -1;
+
+    const struct NE_cacheType *types = NE_cacheSectionData(view, NE_CACHE_TYPES);
+    size_t used = 0;
+
+    for (size_t i = 0; i < type_count; i++) {
+        struct NE_cacheType type;
+        memcpy(&type, &types[i], sizeof(type));
+
+        if (type.ResourceCount > name_count - used)
+            return -1;
+
+        rsrc->Types[i].TypeID = type.TypeID;
+        rsrc->Types[i].metadata.ResourceCount = type.ResourceCount;
+        rsrc->Types[i].metadata.Reserved = type.Reserved;
+        rsrc->Types[i].NameInfo = rsrc->NameInfoPool + used;
+        used += type.ResourceCount;
+    }
+
+    if (used != name_count)
+        return -1;
+
+    rsrc->TypeCount = type_count;
+    rsrc->NameInfoCount = name_count;
+
+    if (str_count) {
+        const struct NE_cacheRsrcName *names = NE_cacheSectionData(view, NE_CACHE_RSRCNAMES);
+
+        rsrc->Names = NE_arenaCalloc(exe->arena, str_count, sizeof(NE_strid));
+        rsrc->NameOffsets = NE_arenaCalloc(exe->arena, str_count, sizeof(uint16_t));
+        if (!rsrc->Names || !rsrc->NameOffsets)
+            return -1;
+
+        for (size_t i = 0; i < str_count; i++) {
+            struct NE_cacheRsrcName name;
+            memcpy(&name, &names[i], sizeof(name));
+
+            rsrc->Names[i] = NE_cacheString(view, exe, name.Name, &bad);
+            rsrc->NameOffsets[i] = name.Offset;
+        }
+
+        rsrc->NameCount = str_count;
+    }
+
+    return bad ? -1 : 0;
+}
+
+static int NE_cacheLoadSegs(const struct NE_cacheView *view, struct NE_exe *exe) {
+    struct NE_SegTable *segs = &exe->segs;
+    size_t count = NE_cacheSectionCount(view, NE_CACHE_SEGS);
+    const uint8_t *p = NE_cacheSectionData(view, NE_CACHE_SEGS);
+
+    if (count == 0)
+        return 0;
+
+    segs->FileOffset = NE_cacheCopy(exe, p, count * sizeof(uint32_t));
+    segs->FileSize = NE_cacheCopy(exe, p + count * 4, count * sizeof(uint32_t));
+    segs->MinAlloc = NE_cacheCopy(exe, p + count * 8, count * sizeof(uint32_t));
+    segs->Flags = NE_cacheCopy(exe, p + count * 12, count * sizeof(uint16_t));
+
+    if (!segs->FileOffset || !segs->FileSize || !segs->MinAlloc || !segs->Flags)
+        return -1;
+
+    segs->Count = count;
+    return 0;
+}
+
+static int NE_cacheLoadNames(const struct NE_cacheView *view, struct NE_exe *exe) {
+    struct NE_NameTable *names = &exe->names;
+    size_t count = NE_cacheSectionCount(view, NE_CACHE_EXPORTS);
+    const struct NE_cacheExport *exports = NE_cacheSectionData(view, NE_CACHE_EXPORTS);
+    int bad = 0;
+
+    names->ModuleName = NE_cacheString(view, exe, view->hdr->ModuleName, &bad);
+    names->Description = NE_cacheString(view, exe, view->hdr->Description, &bad);
+
+    names->Exports = NE_arenaCalloc(exe->arena, count ? count : 1, sizeof(struct NE_NameEntry));
+    if (!names->Exports)
+        return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        struct NE_cacheExport export;
+        memcpy(&export, &exports[i], sizeof(export));
+
+        names->Exports[i].Name = NE_cacheString(view, exe, export.Name, &bad);
+        names->Exports[i].Ordinal = export.Ordinal;
+        names->Exports[i].Resident = export.Resident;
+    }
+
+    names->ExportCount = count;
+
+    // the index is cheap to rebuild and can't be trusted from disk
+    if (bad || NE_indexNameTable(exe) < 0)
+        return -1;
+
+    return 0;
+}
+
+static int NE_cacheLoadImports(const struct NE_cacheView *view, struct NE_exe *exe) {
+    size_t count = NE_cacheSectionCount(view, NE_CACHE_IMPORTS);
+    const uint32_t *modules = NE_cacheSectionData(view, NE_CACHE_IMPORTS);
+    int bad = 0;
+
+    if (count == 0)
+        return 0;
+
+    exe->imports.Modules = NE_arenaCalloc(exe->arena, count, sizeof(NE_strid));
+    if (!exe->imports.Modules)
+        return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t ofs;
+        memcpy(&ofs, &modules[i], sizeof(ofs));
+        exe->imports.Modules[i] = NE_cacheString(view, exe, ofs, &bad);
+    }
+
+    exe->imports.ModuleCount = count;
+    return bad ? -1 : 0;
+}
+
+static int NE_cacheCheck(
+    const struct NE_cache *cache,
+    const struct NE_cacheView *view,
+    size_t length,
+    const struct NE_cacheHeader *id,
+    const struct NE_exe *exe
+) {
+    const struct NE_cacheHeader *hdr = view->hdr;
+
+    if (memcmp(hdr->magic, NE_CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version != NE_CACHE_VERSION ||
+        hdr->endian != NE_CACHE_ENDIAN ||
+        hdr->length != length)
+        return -1;
+
+    if (!NE_cacheSameFile(hdr, id) ||
+        hdr->HeaderOffset != exe->HeaderOffset ||
+        memcmp(&hdr->header, &exe->header, sizeof(hdr->header)) != 0)
+        return -1;
+
+    for (int i = 0; i < NE_CACHE_SECTIONS; i++) {
+        const struct NE_cacheSection *sec = &hdr->sections[i];
+
+        if (sec->offset % NE_CACHE_ALIGN != 0 || sec->offset > length ||
+            sec->count > (length - sec->offset) / NE_cacheItemSize[i])
+            return -1;
+    }
+
+    if (NE_cacheSectionCount(view, NE_CACHE_ENTRIES) > 0xFFFF ||
+        NE_cacheSectionCount(view, NE_CACHE_SEGS) > 0xFFFF)
+        return -1;
+
+    if (cache->verify &&
+        hdr->content_hash != NE_hash64(exe->reader.data, exe->reader.size, 0))
+        return -1;
+
+    return 0;
+}
+
+static int NE_cacheDecode(const struct NE_cacheView *view, struct NE_exe *exe) {
+    size_t entries = NE_cacheSectionCount(view, NE_CACHE_ENTRIES);
+
+    if (entries) {
+        exe->entries.Entries = NE_cacheCopy(
+            exe,
+            NE_cacheSectionData(view, NE_CACHE_ENTRIES),
+            entries * sizeof(struct NE_Entry)
+        );
+        if (!exe->entries.Entries)
+            return -1;
+        exe->entries.Count = entries;
+    }
+
+    if (NE_cacheLoadRsrc(view, exe) < 0 ||
+        NE_cacheLoadSegs(view, exe) < 0 ||
+        NE_cacheLoadNames(view, exe) < 0 ||
+        NE_cacheLoadImports(view, exe) < 0)
+        return -1;
+
+    return 0;
+}
+
+int NE_cacheLoad(struct NE_cache *cache, int fd, struct NE_exe *exe) {
+    struct NE_cacheHeader id;
+    char path[PATH_MAX];
+    int hit = 0;
+
+    if (!exe->ready || NE_cacheIdentity(fd, &id) < 0 || id.size != exe->reader.size)
+        goto exit_load;
+
+    NE_cachePath(cache, &id, path, sizeof(path));
+
+    int cfd = open(path, O_RDONLY | O_CLOEXEC);
+    if (cfd < 0)
+        goto exit_load;
+
+    struct stat st;
+    if (fstat(cfd, &st) != 0 || (size_t)st.st_size < sizeof(struct NE_cacheHeader)) {
+        close(cfd);
+        goto exit_load;
+    }
+
+    size_t length = (size_t)st.st_size;
+    void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, cfd, 0);
+    close(cfd);
+
+    if (map == MAP_FAILED)
+        goto exit_load;
+
+    struct NE_cacheView view = { .data = map, .hdr = map };
+
+    if (NE_cacheCheck(cache, &view, length, &id, exe) == 0) {
+        view.strings = NE_cacheSectionData(&view, NE_CACHE_STRINGS);
+        view.strings_size = NE_cacheSectionCount(&view, NE_CACHE_STRINGS);
+
+        if (NE_cacheDecode(&view, exe) == 0) {
+            hit = 1;
+        } else {
+            // half-loaded tables point into the arena, just forget them
+            memset(&exe->rsrc, 0, sizeof(exe->rsrc));
+            memset(&exe->segs, 0, sizeof(exe->segs));
+            memset(&exe->entries, 0, sizeof(exe->entries));
+            memset(&exe->names, 0, sizeof(exe->names));
+            memset(&exe->imports, 0, sizeof(exe->imports));
+        }
+    }
+
+    munmap(map, length);
+
+exit_load:
+    __atomic_fetch_add(hit ? &cache->hits : &cache->misses, 1, __ATOMIC_RELAXED);
+    return hit;
+}
+
+//
+// Storing
+//
+
+static int NE_cachePad(FILE *fp) {
+    static const uint8_t zero[NE_CACHE_ALIGN];
+    long pos = ftell(fp);
+
+    if (pos < 0)
+        return -1;
+
+    size_t pad = (NE_CACHE_ALIGN - (size_t)pos % NE_CACHE_ALIGN) % NE_CACHE_ALIGN;
+    return fwrite(zero, 1, pad, fp) == pad ? 0 : -1;
+}
+
+// Start a section at the next aligned offset
+static int NE_cacheBegin(FILE *fp, struct NE_cacheHeader *hdr, int section, size_t count) {
+    if (NE_cachePad(fp) < 0)
+        return -1;
+
+    hdr->sections[section].offset = (uint64_t)ftell(fp);
+    hdr->sections[section].count = count;
+    return 0;
+}
+
+// Append a string to the string section, returning its offset
+static uint32_t NE_cachePutString(FILE *strings, const struct NE_exe *exe, NE_strid id) {
+    if (!id)
+        return NE_CACHE_NOSTR;
+
+    long ofs = ftell(strings);
+    uint8_t len = (uint8_t)NE_strpoolLen(exe->pool, id);
+
+    fputc(len, strings);
+    fwrite(NE_str(exe, id), 1, len, strings);
+    return (uint32_t)ofs;
+}
+
+// An empty table may have no array at all, fwrite wants a pointer anyway
+static void NE_cachePutArray(FILE *fp, const void *data, size_t size, size_t count) {
+    if (count)
+        fwrite(data, size, count, fp);
+}
+
+static int NE_cacheWrite(
+    FILE *fp,
+    FILE *strings,
+    char **strings_buf,
+    size_t *strings_size,
+    struct NE_cacheHeader *hdr,
+    const struct NE_exe *exe
+) {
+    const struct NE_ResTable *rsrc = &exe->rsrc;
+
+    if (fwrite(hdr, sizeof(*hdr), 1, fp) != 1)
+        return -1;
+
+    NE_cacheBegin(fp, hdr, NE_CACHE_TYPES, rsrc->TypeCount);
+    for (size_t i = 0; i < rsrc->TypeCount; i++) {
+        struct NE_cacheType type = {
+            rsrc->Types[i].TypeID,
+            rsrc->Types[i].metadata.ResourceCount,
+            rsrc->Types[i].metadata.Reserved
+        };
+        fwrite(&type, sizeof(type), 1, fp);
+    }
+
+    // every type's NameInfo is a consecutive slice of the pool
+    NE_cacheBegin(fp, hdr, NE_CACHE_NAMEINFO, rsrc->NameInfoCount);
+    NE_cachePutArray(fp, rsrc->NameInfoPool, sizeof(struct NE_ResNameInfo), rsrc->NameInfoCount);
+
+    NE_cacheBegin(fp, hdr, NE_CACHE_RSRCNAMES, rsrc->NameCount);
+    for (size_t i = 0; i < rsrc->NameCount; i++) {
+        struct NE_cacheRsrcName name = {
+            NE_cachePutString(strings, exe, rsrc->Names[i]),
+            rsrc->NameOffsets[i],
+            0
+        };
+        fwrite(&name, sizeof(name), 1, fp);
+    }
+
+    size_t segs = exe->segs.Count;
+    NE_cacheBegin(fp, hdr, NE_CACHE_SEGS, segs);
+    NE_cachePutArray(fp, exe->segs.FileOffset, sizeof(uint32_t), segs);
+    NE_cachePutArray(fp, exe->segs.FileSize, sizeof(uint32_t), segs);
+    NE_cachePutArray(fp, exe->segs.MinAlloc, sizeof(uint32_t), segs);
+    NE_cachePutArray(fp, exe->segs.Flags, sizeof(uint16_t), segs);
+
+    NE_cacheBegin(fp, hdr, NE_CACHE_ENTRIES, exe->entries.Count);
+    NE_cachePutArray(fp, exe->entries.Entries, sizeof(struct NE_Entry), exe->entries.Count);
+
+    NE_cacheBegin(fp, hdr, NE_CACHE_EXPORTS, exe->names.ExportCount);
+    for (size_t i = 0; i < exe->names.ExportCount; i++) {
+        const struct NE_NameEntry *name = &exe->names.Exports[i];
+        struct NE_cacheExport export = {
+            NE_cachePutString(strings, exe, name->Name),
+            name->Ordinal,
+            name->Resident,
+            0
+        };
+        fwrite(&export, sizeof(export), 1, fp);
+    }
+
+    NE_cacheBegin(fp, hdr, NE_CACHE_IMPORTS, exe->imports.ModuleCount);
+    for (size_t i = 0; i < exe->imports.ModuleCount; i++) {
+        uint32_t ofs = NE_cachePutString(strings, exe, exe->imports.Modules[i]);
+        fwrite(&ofs, sizeof(ofs), 1, fp);
+    }
+
+    hdr->ModuleName = NE_cachePutString(strings, exe, exe->names.ModuleName);
+    hdr->Description = NE_cachePutString(strings, exe, exe->names.Description);
+
+    // the strings go last, once every reference to them is known
+    if (fflush(strings) != 0 || ferror(strings))
+        return -1;
+
+    if (NE_cacheBegin(fp, hdr, NE_CACHE_STRINGS, *strings_size) < 0 ||
+        fwrite(*strings_buf, 1, *strings_size, fp) != *strings_size)
+        return -1;
+
+    long length = ftell(fp);
+    if (length < 0 || ferror(fp))
+        return -1;
+
+    hdr->length = (uint64_t)length;
+
+    rewind(fp);
+    if (fwrite(hdr, sizeof(*hdr), 1, fp) != 1)
+        return -1;
+
+    return 0;
+}
+
+int NE_cacheStore(struct NE_cache *cache, int fd, struct NE_exe *exe) {
+    struct NE_cacheHeader hdr;
+    char path[PATH_MAX];
+    char tmp[PATH_MAX];
+
+    if (!exe->ready || NE_cacheIdentity(fd, &hdr) < 0 || hdr.size != exe->reader.size) {
+        NE_setError(exe, NE_ERR_UNSUPPORTED, "Only regular files can be cached");
+        return -1;
+    }
+
+    memcpy(hdr.magic, NE_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = NE_CACHE_VERSION;
+    hdr.endian = NE_CACHE_ENDIAN;
+    hdr.content_hash = NE_hash64(exe->reader.data, exe->reader.size, 0);
+    hdr.HeaderOffset = exe->HeaderOffset;
+    hdr.AlignmentShift = exe->rsrc.AlignmentShift;
+    hdr.header = exe->header;
+
+    NE_cachePath(cache, &hdr, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s/.nec-XXXXXX", cache->dir);
+
+    // write a private temp file and rename it over the entry, so readers
+    // only ever see complete entries
+    int tfd = mkstemp(tmp);
+    if (tfd < 0) {
+        NE_setError(exe, NE_ERR_IO, "Failed to create cache entry");
+        return -1;
+    }
+
+    fchmod(tfd, 0644);
+
+    char *strings_buf = NULL;
+    size_t strings_size = 0;
+    FILE *strings = open_memstream(&strings_buf, &strings_size);
+    FILE *fp = fdopen(tfd, "wb");
+    int ret = -1;
+
+    if (fp && strings &&
+        NE_cacheWrite(fp, strings, &strings_buf, &strings_size, &hdr, exe) == 0 &&
+        fflush(fp) == 0)
+        ret = 0;
+
+    if (strings)
+        fclose(strings);
+    free(strings_buf);
+    if (fp)
+        fclose(fp);
+    else
+        close(tfd);
+
+    if (ret == 0 && rename(tmp, path) != 0)
+        ret = -1;
+
+    if (ret < 0) {
+        unlink(tmp);
+        NE_setError(exe, NE_ERR_IO, "Failed to write cache entry");
+        return -1;
+    }
+
+    __atomic_fetch_add(&cache->stores, 1, __ATOMIC_RELAXED);
+    return 0;
+}
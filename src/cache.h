@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Optional on-disk cache of parsed tables. Each entry is one file in the
+// cache directory, named after a hash of the source file's identity
+// (device, inode, size, mtime). It records that identity and a hash of the
+// file's contents, followed by the parsed header, resource index,
+// segments, entries, names and imports in a flat, offset-based layout.
+//
+// A hit maps the entry once, checks it and copies the tables into the
+// exe's arena; the source file is still mapped for anything read lazily
+// (relocations, resource data) but none of its tables are parsed.
+//
+#pragma once
+#include "ne.h"
+#include <stdint.h>
+
+struct NE_cache {
+    const char *dir;
+    int verify;          // also check the content hash on every hit
+
+    uint64_t hits;       // updated atomically, workers share one cache
+    uint64_t misses;
+    uint64_t stores;
+};
+
+// Load the tables of `exe` (already NE_openExe'd from `fd`) from the
+// cache. Returns 1 on a hit, 0 on a miss or a stale/corrupt entry.
+int NE_cacheLoad(struct NE_cache *cache, int fd, struct NE_exe *exe);
+
+// Write the parsed tables of `exe` to the cache, replacing any older
+// entry for the same file. Returns -1 and sets exe->error on failure.
+int NE_cacheStore(struct NE_cache *cache, int fd, struct NE_exe *exe);
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "crc32.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NE_CRC32_CLMUL 1
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#define NE_CRC32_POLY 0xEDB88320u
+
+static uint32_t NE_crc32Table[8][256];
+static pthread_once_t NE_crc32Once = PTHREAD_ONCE_INIT;
+static uint32_t (*NE_crc32Impl)(uint32_t, const uint8_t *, size_t);
+static const char *NE_crc32ImplName;
+
+static inline uint32_t NE_crc32Load(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Raw (not inverted) CRC state in, raw state out
+static uint32_t NE_crc32Slice8(uint32_t crc, const uint8_t *p, size_t len) {
+    const uint32_t (*t)[256] = (const uint32_t (*)[256])NE_crc32Table;
+
+    for (; len >= 8; len -= 8, p += 8) {
+        uint32_t one = NE_crc32Load(p) ^ crc;
+        uint32_t two = NE_crc32Load(p + 4);
+
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+              t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^
+              t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    }
+
+    while (len--)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+
+    return crc;
+}
+
+#ifdef NE_CRC32_CLMUL
+// Folding with carry-less multiplies, after Intel's "Fast CRC Computation
+// for Generic Polynomials Using PCLMULQDQ Instruction". The constants are
+// x^n mod P(x), bit reflected, for the fold distances used below.
+#define NE_CLMUL_K1 0x154442bd4ull  // fold by 512 bits
+#define NE_CLMUL_K2 0x1c6e41596ull
+#define NE_CLMUL_K3 0x1751997d0ull  // fold by 128 bits
+#define NE_CLMUL_K4 0x0ccaa009eull
+#define NE_CLMUL_K5 0x163cd6124ull  // 64 -> 32 bits
+#define NE_CLMUL_P  0x1db710641ull  // P(x), reflected
+#define NE_CLMUL_U  0x1f7011641ull  // Barrett constant
+
+__attribute__((target("pclmul,sse2")))
+static inline __m128i NE_clmulFold(__m128i acc, __m128i k, __m128i data) {
+    __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(lo, hi), data);
+}
+
+__attribute__((target("pclmul,sse2")))
+static uint32_t NE_crc32Clmul(uint32_t crc, const uint8_t *p, size_t len) {
+    if (len < 64)
+        return NE_crc32Slice8(crc, p, len);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i *)p);
+    __m128i x2 = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i x3 = _mm_loadu_si128((const __m128i *)(p + 32));
+    __m128i x4 = _mm_loadu_si128((const __m128i *)(p + 48));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    p += 64;
+    len -= 64;
+
+    // four independent 128-bit accumulators, 64 bytes per round
+    __m128i k = _mm_set_epi64x((long long)NE_CLMUL_K2, (long long)NE_CLMUL_K1);
+    for (; len >= 64; p += 64, len -= 64) {
+        x1 = NE_clmulFold(x1, k, _mm_loadu_si128((const __m128i *)p));
+        x2 = NE_clmulFold(x2, k, _mm_loadu_si128((const __m128i *)(p + 16)));
+        x3 = NE_clmulFold(x3, k, _mm_loadu_si128((const __m128i *)(p + 32)));
+        x4 = NE_clmulFold(x4, k, _mm_loadu_si128((const __m128i *)(p + 48)));
+    }
+
+    // fold them into one, then any whole 16-byte blocks left
+    k = _mm_set_epi64x((long long)NE_CLMUL_K4, (long long)NE_CLMUL_K3);
+    x1 = NE_clmulFold(x1, k, x2);
+    x1 = NE_clmulFold(x1, k, x3);
+    x1 = NE_clmulFold(x1, k, x4);
+
+    for (; len >= 16; p += 16, len -= 16)
+        x1 = NE_clmulFold(x1, k, _mm_loadu_si128((const __m128i *)p));
+
+    // 128 -> 64 bits, appending the 32 zero bits the reduction expects
+    const __m128i mask32 = _mm_set_epi32(0, 0, 0, -1);
+    __m128i t = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+
+    // 64 -> 32 bits
+    k = _mm_set_epi64x(0, (long long)NE_CLMUL_K5);
+    t = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+
+    // Barrett reduction to the final 32-bit remainder
+    k = _mm_set_epi64x((long long)NE_CLMUL_U, (long long)NE_CLMUL_P);
+    t = x1;
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+
+    crc = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+
+    return NE_crc32Slice8(crc, p, len);
+}
+#endif
+
+static void NE_crc32Init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int b = 0; b < 8; b++)
+            c = (c >> 1) ^ (NE_CRC32_POLY & (0u - (c & 1)));
+        NE_crc32Table[0][i] = c;
+    }
+
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t c = NE_crc32Table[k - 1][i];
+            NE_crc32Table[k][i] = (c >> 8) ^ NE_crc32Table[0][c & 0xFF];
+        }
+    }
+
+    NE_crc32Impl = NE_crc32Slice8;
+    NE_crc32ImplName = "slicing-by-8";
+
+#ifdef NE_CRC32_CLMUL
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2")) {
+        NE_crc32Impl = NE_crc32Clmul;
+        NE_crc32ImplName = "pclmulqdq";
+    }
+#endif
+}
+
+uint32_t NE_crc32(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&NE_crc32Once, NE_crc32Init);
+    return ~NE_crc32Impl(~crc, data, len);
+}
+
+const char *NE_crc32Kernel(void) {
+    pthread_once(&NE_crc32Once, NE_crc32Init);
+    return NE_crc32ImplName;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// CRC-32 (IEEE 802.3, reflected, the one zlib and PKZIP use). The portable
+// kernel is slicing-by-8; on x86 CPUs with PCLMULQDQ large buffers are
+// folded 64 bytes at a time with carry-less multiplies instead. The kernel
+// is picked on first use.
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Continue `crc` (0 to start) over `len` bytes, like zlib's crc32()
+uint32_t NE_crc32(uint32_t crc, const void *data, size_t len);
+
+// Name of the kernel NE_crc32 uses on this CPU
+const char *NE_crc32Kernel(void);
@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "dib.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NE_DIB_X86
+#include <immintrin.h>
+#endif
+
+// Windows 3.x can't make anything bigger, and it bounds what a corrupt
+// header can make us allocate
+#define NE_DIB_MAX_SIDE 0x8000
+
+#define NE_DIB_BI_RGB 0
+
+struct NE_dibPalette {
+    uint32_t rgba[256];     // R, G, B, A in memory, opaque black past the end
+    uint8_t r[16];          // the first 16 entries by channel, 4 bpp lookups
+    uint8_t g[16];          // as byte shuffles
+    uint8_t b[16];
+};
+
+typedef void (*NE_dibRowFn)(
+    const uint8_t *src,
+    uint32_t *dst,
+    size_t width,
+    const struct NE_dibPalette *pal
+);
+
+// Clears the pixels whose AND mask bit is set
+typedef void (*NE_dibMaskFn)(const uint8_t *src, uint32_t *dst, size_t width);
+
+struct NE_dibKernels {
+    enum NE_dibIsa isa;
+    NE_dibRowFn row1;
+    NE_dibRowFn row4;
+    NE_dibRowFn row8;
+    NE_dibRowFn row24;
+    NE_dibMaskFn mask;
+};
+
+struct NE_dibInfo {
+    uint32_t width;
+    uint32_t height;        // without the mask rows
+    uint16_t bpp;
+    uint16_t hotspot_x;
+    uint16_t hotspot_y;
+    int top_down;
+    const uint8_t *bits;
+    size_t stride;
+    const uint8_t *mask;    // icons and cursors, same row order as bits
+    size_t mask_stride;
+    struct NE_dibPalette pal;
+};
+
+// Scalar kernels, also the tails of the vector ones. Rows start on a byte
+// boundary, so a tail does too as long as it's a whole number of bytes in.
+
+static void NE_dibRow1(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    for (size_t x = 0; x < width; x++)
+        dst[x] = pal->rgba[(src[x >> 3] >> (7 - (x & 7))) & 1];
+}
+
+static void NE_dibRow4(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    for (size_t x = 0; x < width; x++)
+        dst[x] = pal->rgba[(src[x >> 1] >> ((x & 1) ? 0 : 4)) & 0xF];
+}
+
+static void NE_dibRow8(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    for (size_t x = 0; x < width; x++)
+        dst[x] = pal->rgba[src[x]];
+}
+
+// BGR triples to RGBA
+static void NE_dibRow24(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    uint8_t *out = (uint8_t *)dst;
+
+    (void)pal;
+    for (size_t x = 0; x < width; x++) {
+        out[4 * x + 0] = src[3 * x + 2];
+        out[4 * x + 1] = src[3 * x + 1];
+        out[4 * x + 2] = src[3 * x + 0];
+        out[4 * x + 3] = 0xFF;
+    }
+}
+
+static void NE_dibMask(const uint8_t *src, uint32_t *dst, size_t width) {
+    for (size_t x = 0; x < width; x++) {
+        if ((src[x >> 3] >> (7 - (x & 7))) & 1)
+            dst[x] = 0;
+    }
+}
+
+#ifdef NE_DIB_X86
+// SSE2 has neither a byte shuffle nor a gather, so only the 1 bpp rows,
+// where a pixel is picked by a bit test, are done 4 pixels at a time. Lane
+// i of `hi`/`lo` tests the bit of pixel i/4 + i of a byte.
+
+__attribute__((target("sse2")))
+static void NE_dibRow1Sse2(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    const __m128i hi = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const __m128i lo = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+    const __m128i c0 = _mm_set1_epi32((int)pal->rgba[0]);
+    const __m128i c1 = _mm_set1_epi32((int)pal->rgba[1]);
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_set1_epi32(src[x >> 3]);
+        __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(v, hi), hi);
+        __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(v, lo), lo);
+
+        _mm_storeu_si128((__m128i *)(dst + x),
+            _mm_or_si128(_mm_and_si128(m0, c1), _mm_andnot_si128(m0, c0)));
+        _mm_storeu_si128((__m128i *)(dst + x + 4),
+            _mm_or_si128(_mm_and_si128(m1, c1), _mm_andnot_si128(m1, c0)));
+    }
+
+    NE_dibRow1(src + (x >> 3), dst + x, width - x, pal);
+}
+
+__attribute__((target("sse2")))
+static void NE_dibMaskSse2(const uint8_t *src, uint32_t *dst, size_t width) {
+    const __m128i hi = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const __m128i lo = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_set1_epi32(src[x >> 3]);
+        __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(v, hi), hi);
+        __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(v, lo), lo);
+        __m128i *p = (__m128i *)(dst + x);
+
+        _mm_storeu_si128(p, _mm_andnot_si128(m0, _mm_loadu_si128(p)));
+        _mm_storeu_si128(p + 1, _mm_andnot_si128(m1, _mm_loadu_si128(p + 1)));
+    }
+
+    NE_dibMask(src + (x >> 3), dst + x, width - x);
+}
+
+// AVX2: bit tests 8 pixels wide, 4 bpp as byte shuffles of the palette
+// split by channel (16 entries are exactly one shuffle table), 8 bpp as
+// gathers and 24 bpp as one shuffle per 8 pixels.
+
+__attribute__((target("avx2")))
+static void NE_dibRow1Avx2(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    const __m256i bits = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+    const __m256i c0 = _mm256_set1_epi32((int)pal->rgba[0]);
+    const __m256i c1 = _mm256_set1_epi32((int)pal->rgba[1]);
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i v = _mm256_set1_epi32(src[x >> 3]);
+        __m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(v, bits), bits);
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_blendv_epi8(c0, c1, m));
+    }
+
+    NE_dibRow1(src + (x >> 3), dst + x, width - x, pal);
+}
+
+__attribute__((target("avx2")))
+static void NE_dibMaskAvx2(const uint8_t *src, uint32_t *dst, size_t width) {
+    const __m256i bits = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i v = _mm256_set1_epi32(src[x >> 3]);
+        __m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(v, bits), bits);
+        __m256i *p = (__m256i *)(dst + x);
+        _mm256_storeu_si256(p, _mm256_andnot_si256(m, _mm256_loadu_si256(p)));
+    }
+
+    NE_dibMask(src + (x >> 3), dst + x, width - x);
+}
+
+// 32 pixels from 16 bytes. Lane 0 works on pixels 0-15, lane 1 on 16-31.
+__attribute__((target("avx2")))
+static void NE_dibRow4Avx2(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m256i r = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)pal->r));
+    const __m256i g = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)pal->g));
+    const __m256i b = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)pal->b));
+    const __m256i a = _mm256_set1_epi8((char)0xFF);
+    size_t x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + (x >> 1)));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(s, 4), nibble);
+        __m128i lo = _mm_and_si128(s, nibble);
+
+        // the high nibble is the left pixel
+        __m256i idx = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_unpacklo_epi8(hi, lo)),
+            _mm_unpackhi_epi8(hi, lo),
+            1
+        );
+
+        __m256i rv = _mm256_shuffle_epi8(r, idx);
+        __m256i gv = _mm256_shuffle_epi8(g, idx);
+        __m256i bv = _mm256_shuffle_epi8(b, idx);
+
+        __m256i rg_lo = _mm256_unpacklo_epi8(rv, gv);
+        __m256i rg_hi = _mm256_unpackhi_epi8(rv, gv);
+        __m256i ba_lo = _mm256_unpacklo_epi8(bv, a);
+        __m256i ba_hi = _mm256_unpackhi_epi8(bv, a);
+
+        // pixels 0-3|16-19, 4-7|20-23, 8-11|24-27, 12-15|28-31
+        __m256i q0 = _mm256_unpacklo_epi16(rg_lo, ba_lo);
+        __m256i q1 = _mm256_unpackhi_epi16(rg_lo, ba_lo);
+        __m256i q2 = _mm256_unpacklo_epi16(rg_hi, ba_hi);
+        __m256i q3 = _mm256_unpackhi_epi16(rg_hi, ba_hi);
+
+        __m256i *p = (__m256i *)(dst + x);
+        _mm256_storeu_si256(p + 0, _mm256_permute2x128_si256(q0, q1, 0x20));
+        _mm256_storeu_si256(p + 1, _mm256_permute2x128_si256(q2, q3, 0x20));
+        _mm256_storeu_si256(p + 2, _mm256_permute2x128_si256(q0, q1, 0x31));
+        _mm256_storeu_si256(p + 3, _mm256_permute2x128_si256(q2, q3, 0x31));
+    }
+
+    NE_dibRow4(src + (x >> 1), dst + x, width - x, pal);
+}
+
+__attribute__((target("avx2")))
+static void NE_dibRow8Avx2(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + x)));
+        _mm256_storeu_si256((__m256i *)(dst + x),
+            _mm256_i32gather_epi32((const int *)pal->rgba, idx, 4));
+    }
+
+    NE_dibRow8(src + x, dst + x, width - x, pal);
+}
+
+// 8 pixels a round, 4 per lane, from two 16 byte loads 12 bytes apart. The
+// second load reads 4 bytes past the 8th pixel, hence the 10 pixel margin.
+__attribute__((target("avx2")))
+static void NE_dibRow24Avx2(const uint8_t *src, uint32_t *dst, size_t width, const struct NE_dibPalette *pal) {
+    const __m256i order = _mm256_setr_epi8(
+        2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+        2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1
+    );
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000u);
+    size_t x = 0;
+
+    for (; width - x >= 10; x += 8) {
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + 3 * x))),
+            _mm_loadu_si128((const __m128i *)(src + 3 * x + 12)),
+            1
+        );
+        _mm256_storeu_si256((__m256i *)(dst + x),
+            _mm256_or_si256(_mm256_shuffle_epi8(v, order), alpha));
+    }
+
+    NE_dibRow24(src + 3 * x, dst + x, width - x, pal);
+}
+#endif
+
+static const struct NE_dibKernels NE_dibScalar = {
+    NE_DIB_SCALAR, NE_dibRow1, NE_dibRow4, NE_dibRow8, NE_dibRow24, NE_dibMask
+};
+
+#ifdef NE_DIB_X86
+static const struct NE_dibKernels NE_dibSse2 = {
+    NE_DIB_SSE2, NE_dibRow1Sse2, NE_dibRow4, NE_dibRow8, NE_dibRow24, NE_dibMaskSse2
+};
+
+static const struct NE_dibKernels NE_dibAvx2 = {
+    NE_DIB_AVX2, NE_dibRow1Avx2, NE_dibRow4Avx2, NE_dibRow8Avx2, NE_dibRow24Avx2, NE_dibMaskAvx2
+};
+#endif
+
+static const struct NE_dibKernels *NE_dibActive;
+
+static enum NE_dibIsa NE_dibBestIsa(void) {
+#ifdef NE_DIB_X86
+    // also checks the OS saves the AVX registers
+    if (__builtin_cpu_supports("avx2"))
+        return NE_DIB_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return NE_DIB_SSE2;
+#endif
+    return NE_DIB_SCALAR;
+}
+
+enum NE_dibIsa NE_dibUseIsa(enum NE_dibIsa isa) {
+    const struct NE_dibKernels *k = &NE_dibScalar;
+    enum NE_dibIsa best = NE_dibBestIsa();
+
+    if (isa > best)
+        isa = best;
+
+#ifdef NE_DIB_X86
+    if (isa == NE_DIB_AVX2)
+        k = &NE_dibAvx2;
+    else if (isa == NE_DIB_SSE2)
+        k = &NE_dibSse2;
+#endif
+
+    __atomic_store_n(&NE_dibActive, k, __ATOMIC_RELEASE);
+    return k->isa;
+}
+
+const char *NE_dibIsaName(enum NE_dibIsa isa) {
+    switch (isa) {
+        case NE_DIB_SSE2: return "sse2";
+        case NE_DIB_AVX2: return "avx2";
+        default:          return "scalar";
+    }
+}
+
+// Threads racing to pick the first time all pick the same
+static const struct NE_dibKernels *NE_dibKernels(void) {
+    const struct NE_dibKernels *k = __atomic_load_n(&NE_dibActive, __ATOMIC_ACQUIRE);
+
+    if (!k) {
+        NE_dibUseIsa(NE_DIB_AVX2);
+        k = __atomic_load_n(&NE_dibActive, __ATOMIC_ACQUIRE);
+    }
+    return k;
+}
+
+static enum NE_status NE_dibParse(
+    const uint8_t *data,
+    size_t size,
+    enum NE_dibKind kind,
+    struct NE_dibInfo *info
+) {
+    int32_t width, height;
+    uint16_t planes;
+    uint32_t colors = 0;    // 0 = as many as the depth has
+    size_t entry;           // palette entry size
+
+    memset(info, 0, sizeof(*info));
+
+    if (kind == NE_DIB_CURSOR) {
+        if (size < 4)
+            return NE_ERR_TRUNCATED;
+        info->hotspot_x = NE_getU16(data);
+        info->hotspot_y = NE_getU16(data + 2);
+        data += 4;
+        size -= 4;
+    }
+
+    if (size < 4)
+        return NE_ERR_TRUNCATED;
+
+    uint32_t hdr = NE_getU32(data);
+    if (hdr == 12) {
+        // BITMAPCOREHEADER, RGBTRIPLE palette
+        if (size < 12)
+            return NE_ERR_TRUNCATED;
+        width = NE_getU16(data + 4);
+        height = NE_getU16(data + 6);
+        planes = NE_getU16(data + 8);
+        info->bpp = NE_getU16(data + 10);
+        entry = 3;
+    } else if (hdr >= 40) {
+        // BITMAPINFOHEADER or a later one starting the same, RGBQUAD palette
+        if (size < hdr)
+            return NE_ERR_TRUNCATED;
+        width = (int32_t)NE_getU32(data + 4);
+        height = (int32_t)NE_getU32(data + 8);
+        planes = NE_getU16(data + 12);
+        info->bpp = NE_getU16(data + 14);
+        if (NE_getU32(data + 16) != NE_DIB_BI_RGB)
+            return NE_ERR_UNSUPPORTED;
+        colors = NE_getU32(data + 32);
+        entry = 4;
+    } else {
+        return NE_ERR_CORRUPT;
+    }
+
+    uint16_t bpp = info->bpp;
+    if (planes != 1 || (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 24))
+        return NE_ERR_UNSUPPORTED;
+
+    // 24 bpp may still come with a palette, for displays that need one
+    size_t depth_colors = bpp <= 8 ? (size_t)1 << bpp : 256;
+    if (colors > depth_colors)
+        return NE_ERR_CORRUPT;
+    size_t pal_count = colors ? colors : (bpp <= 8 ? depth_colors : 0);
+
+    if (height < 0) {
+        if (kind != NE_DIB_BITMAP || height == INT32_MIN)
+            return NE_ERR_CORRUPT;
+        info->top_down = 1;
+        height = -height;
+    }
+
+    // icon and cursor heights count the mask rows too
+    if (kind != NE_DIB_BITMAP)
+        height /= 2;
+
+    if (width <= 0 || height <= 0 || width > NE_DIB_MAX_SIDE || height > NE_DIB_MAX_SIDE)
+        return NE_ERR_CORRUPT;
+
+    info->width = (uint32_t)width;
+    info->height = (uint32_t)height;
+    info->stride = (((size_t)width * bpp + 31) / 32) * 4;
+
+    size_t pal_ofs = hdr;
+    size_t bits_ofs = pal_ofs + pal_count * entry;
+    size_t need = bits_ofs + info->stride * info->height;
+
+    if (kind != NE_DIB_BITMAP) {
+        info->mask_stride = (((size_t)width + 31) / 32) * 4;
+        need += info->mask_stride * info->height;
+    }
+
+    if (need > size)
+        return NE_ERR_TRUNCATED;
+
+    info->bits = data + bits_ofs;
+    if (kind != NE_DIB_BITMAP)
+        info->mask = info->bits + info->stride * info->height;
+
+    // indices past the palette get opaque black
+    for (size_t i = 0; i < 256; i++) {
+        uint8_t px[4] = { 0, 0, 0, 0xFF };
+        if (bpp <= 8 && i < pal_count) {
+            const uint8_t *p = data + pal_ofs + i * entry;
+            px[0] = p[2];
+            px[1] = p[1];
+            px[2] = p[0];
+        }
+        memcpy(&info->pal.rgba[i], px, sizeof(px));
+
+        if (i < 16) {
+            info->pal.r[i] = px[0];
+            info->pal.g[i] = px[1];
+            info->pal.b[i] = px[2];
+        }
+    }
+
+    return NE_OK;
+}
+
+static void NE_dibUnpack(const struct NE_dibInfo *info, uint8_t *rgba) {
+    const struct NE_dibKernels *k = NE_dibKernels();
+    NE_dibRowFn row;
+
+    switch (info->bpp) {
+        case 1:  row = k->row1; break;
+        case 4:  row = k->row4; break;
+        case 8:  row = k->row8; break;
+        default: row = k->row24; break;
+    }
+
+    for (size_t y = 0; y < info->height; y++) {
+        size_t src_y = info->top_down ? y : info->height - 1 - y;
+        uint32_t *dst = (uint32_t *)(rgba + y * info->width * 4);
+
+        row(info->bits + src_y * info->stride, dst, info->width, &info->pal);
+        if (info->mask)
+            k->mask(info->mask + src_y * info->mask_stride, dst, info->width);
+    }
+}
+
+static void NE_dibSetImage(struct NE_image *img, const struct NE_dibInfo *info) {
+    img->width = info->width;
+    img->height = info->height;
+    img->bpp = info->bpp;
+    img->hotspot_x = info->hotspot_x;
+    img->hotspot_y = info->hotspot_y;
+}
+
+enum NE_status NE_dibDecode(
+    const uint8_t *data,
+    size_t size,
+    enum NE_dibKind kind,
+    struct NE_image *img
+) {
+    struct NE_dibInfo info;
+
+    memset(img, 0, sizeof(*img));
+
+    enum NE_status status = NE_dibParse(data, size, kind, &info);
+    if (status != NE_OK)
+        return status;
+
+    img->rgba = malloc((size_t)info.width * info.height * 4);
+    if (!img->rgba)
+        return NE_ERR_NOMEM;
+
+    NE_dibSetImage(img, &info);
+    NE_dibUnpack(&info, img->rgba);
+    return NE_OK;
+}
+
+enum NE_status NE_dibProbe(
+    const uint8_t *data,
+    size_t size,
+    enum NE_dibKind kind,
+    struct NE_image *img
+) {
+    struct NE_dibInfo info;
+
+    memset(img, 0, sizeof(*img));
+
+    enum NE_status status = NE_dibParse(data, size, kind, &info);
+    if (status == NE_OK)
+        NE_dibSetImage(img, &info);
+    return status;
+}
+
+void NE_imageFree(struct NE_image *img) {
+    free(img->rgba);
+    img->rgba = NULL;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Device independent bitmaps, as stored in RT_BITMAP, RT_ICON and
+// RT_CURSOR resources: a BITMAPINFOHEADER or BITMAPCOREHEADER, the
+// palette and uncompressed 1, 4, 8 or 24 bpp rows, bottom-up unless the
+// height is negative. Icons and cursors have twice the height in the
+// header, the color (XOR) rows being followed by a 1 bpp AND mask, and
+// cursors start with their hotspot.
+//
+// Rows are expanded to RGBA with kernels picked once from what the CPU
+// supports: scalar, SSE2 (1 bpp rows and masks) or AVX2 (every depth).
+//
+#pragma once
+#include "ne.h"
+#include <stddef.h>
+#include <stdint.h>
+
+enum NE_dibKind {
+    NE_DIB_BITMAP,
+    NE_DIB_ICON,    // XOR rows, then the AND mask
+    NE_DIB_CURSOR   // hotspot, then the same as an icon
+};
+
+enum NE_dibIsa {
+    NE_DIB_SCALAR,
+    NE_DIB_SSE2,
+    NE_DIB_AVX2
+};
+
+// Top-down rows of `width` pixels, 4 bytes each in R, G, B, A order. What
+// the AND mask hides is transparent black.
+struct NE_image {
+    uint32_t width;
+    uint32_t height;
+    uint16_t bpp;       // of the DIB
+    uint16_t hotspot_x; // cursors only
+    uint16_t hotspot_y;
+    uint8_t *rgba;
+};
+
+// Returns NE_OK, or why the bitmap can't be decoded. img->rgba is
+// malloc'd, free it with NE_imageFree.
+enum NE_status NE_dibDecode(
+    const uint8_t *data,
+    size_t size,
+    enum NE_dibKind kind,
+    struct NE_image *img
+);
+void NE_imageFree(struct NE_image *img);
+
+// Checks the bitmap like NE_dibDecode and fills in everything but the
+// pixels, img->rgba is left NULL
+enum NE_status NE_dibProbe(
+    const uint8_t *data,
+    size_t size,
+    enum NE_dibKind kind,
+    struct NE_image *img
+);
+
+// Use the kernels of `isa`, or the best the CPU has if it lacks them.
+// Returns the ISA now in use. For tests and benchmarks, it's not meant to
+// be switched while decoding.
+enum NE_dibIsa NE_dibUseIsa(enum NE_dibIsa isa);
+const char *NE_dibIsaName(enum NE_dibIsa isa);
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ne.h"
+#include <string.h>
+
+#define NE_BUNDLE_UNUSED  0x00
+#define NE_BUNDLE_MOVABLE 0xFF
+#define NE_FIXED_ENTRY_SIZE   3
+#define NE_MOVABLE_ENTRY_SIZE 6
+
+// Size of one entry in a bundle with this segment indicator
+static size_t NE_bundleEntrySize(uint8_t indicator) {
+    switch (indicator) {
+        case NE_BUNDLE_UNUSED:  return 0;
+        case NE_BUNDLE_MOVABLE: return NE_MOVABLE_ENTRY_SIZE;
+        default:                return NE_FIXED_ENTRY_SIZE;
+    }
+}
+
+int NE_readEntryTable(const struct NE_reader *rd, struct NE_exe *exe) {
+    struct NE_EntryTable *table = &exe->entries;
+
+    if (!exe->ready) {
+        NE_setError(exe, NE_ERR_NOT_READY, "Exe struct isn't setup/ready yet");
+        return -1;
+    }
+
+    memset(table, 0, sizeof(*table));
+
+    size_t len = exe->header.EntryTableLength;
+    if (len == 0)
+        return 0;
+
+    const uint8_t *start = NE_readerView(
+        rd,
+        (size_t)exe->HeaderOffset + exe->header.EntryTableOffset,
+        len
+    );
+
+    if (!start) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Entry table runs past the end of the file");
+        return -1;
+    }
+
+    // first pass: how many ordinals do the bundles cover
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos + 2 <= len && start[pos] != 0) {
+        size_t bundle = start[pos];
+        size_t size = bundle * NE_bundleEntrySize(start[pos + 1]);
+
+        if (pos + 2 + size > len) {
+            NE_setError(exe, NE_ERR_CORRUPT, "Entry table bundle runs past the end of the table");
+            return -1;
+        }
+
+        count += bundle;
+        pos += 2 + size;
+    }
+
+    if (count > 0xFFFF) {
+        NE_setError(exe, NE_ERR_CORRUPT, "Entry table has more than 65535 ordinals");
+        return -1;
+    }
+
+    if (count == 0)
+        return 0;
+
+    table->Entries = NE_arenaCalloc(exe->arena, count, sizeof(struct NE_Entry));
+    if (!table->Entries) {
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc entry table");
+        return -1;
+    }
+
+    // second pass: decode straight into the ordinal slots
+    struct NE_Entry *ent = table->Entries;
+    pos = 0;
+    while (pos + 2 <= len && start[pos] != 0) {
+        uint8_t bundle = start[pos];
+        uint8_t indicator = start[pos + 1];
+        const uint8_t *p = start + pos + 2;
+
+        for (uint8_t i = 0; i < bundle; i++, ent++) {
+            switch (indicator) {
+                case NE_BUNDLE_UNUSED:
+                    break;
+                case NE_BUNDLE_MOVABLE:
+                    // flags, INT 3Fh, segment, offset
+                    ent->Flags = (p[0] & ~NE_ENTRY_MOVABLE) | NE_ENTRY_MOVABLE;
+                    ent->Segment = p[3];
+                    ent->Offset = NE_getU16(p + 4);
+                    p += NE_MOVABLE_ENTRY_SIZE;
+                    break;
+                default:
+                    ent->Flags = p[0] & ~NE_ENTRY_MOVABLE;
+                    ent->Segment = indicator;
+                    ent->Offset = NE_getU16(p + 1);
+                    p += NE_FIXED_ENTRY_SIZE;
+                    break;
+            }
+        }
+
+        pos = (size_t)(p - start);
+    }
+
+    table->Count = count;
+    return 0;
+}
+
+const struct NE_Entry *NE_lookupOrdinal(const struct NE_exe *exe, uint16_t ordinal) {
+    if (ordinal == 0 || ordinal > exe->entries.Count)
+        return NULL;
+
+    const struct NE_Entry *ent = &exe->entries.Entries[ordinal - 1];
+    return ent->Segment ? ent : NULL;
+}
+
+static uint32_t NE_hashOrdinal(uint16_t ordinal) {
+    return ordinal * 2654435761u;
+}
+
+// Count the strings of a name table, stopping at a zero length byte or
+// the end of `len` bytes
+static size_t NE_countNames(const uint8_t *p, size_t len) {
+    size_t count = 0;
+    size_t pos = 0;
+
+    while (pos < len && p[pos] != 0) {
+        size_t next = pos + 1 + p[pos] + 2;
+        if (next > len)
+            break;
+        count++;
+        pos = next;
+    }
+
+    return count;
+}
+
+// Intern the names of one table into `out`. The first string is the
+// module name or description and goes to *first instead.
+static int NE_decodeNames(
+    struct NE_exe *exe,
+    const uint8_t *p,
+    size_t count,
+    int resident,
+    NE_strid *first,
+    struct NE_NameEntry *out,
+    size_t *n
+) {
+    for (size_t i = 0; i < count; i++) {
+        uint8_t len = p[0];
+        NE_strid name = NE_strpoolIntern(exe->pool, (const char *)p + 1, len);
+        if (!name)
+            return -1;
+
+        if (i == 0) {
+            *first = name;
+        } else {
+            out[*n].Name = name;
+            out[*n].Ordinal = NE_getU16(p + 1 + len);
+            out[*n].Resident = (uint8_t)resident;
+            (*n)++;
+        }
+
+        p += 1 + len + 2;
+    }
+
+    return 0;
+}
+
+// (Re)build the by-ordinal and by-name indexes over names->Exports
+int NE_indexNameTable(struct NE_exe *exe) {
+    struct NE_NameTable *names = &exe->names;
+
+    size_t buckets = 16;
+    while (buckets < names->ExportCount * 2)
+        buckets *= 2;
+
+    names->ByOrdinal = NE_arenaCalloc(exe->arena, buckets, sizeof(uint32_t));
+    names->ByName = NE_arenaCalloc(exe->arena, buckets, sizeof(uint32_t));
+    names->HashMask = buckets - 1;
+
+    if (!names->ByOrdinal || !names->ByName) {
+        names->ByOrdinal = names->ByName = NULL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < names->ExportCount; i++) {
+        const struct NE_NameEntry *name = &names->Exports[i];
+
+        size_t slot = NE_strpoolHash(exe->pool, name->Name) & names->HashMask;
+        while (names->ByName[slot])
+            slot = (slot + 1) & names->HashMask;
+        names->ByName[slot] = (uint32_t)i + 1;
+
+        // an ordinal named in both tables keeps its resident name
+        slot = NE_hashOrdinal(name->Ordinal) & names->HashMask;
+        while (names->ByOrdinal[slot] &&
+               names->Exports[names->ByOrdinal[slot] - 1].Ordinal != name->Ordinal)
+            slot = (slot + 1) & names->HashMask;
+        if (!names->ByOrdinal[slot])
+            names->ByOrdinal[slot] = (uint32_t)i + 1;
+    }
+
+    return 0;
+}
+
+int NE_readNameTables(const struct NE_reader *rd, struct NE_exe *exe) {
+    struct NE_NameTable *names = &exe->names;
+
+    if (!exe->ready) {
+        NE_setError(exe, NE_ERR_NOT_READY, "Exe struct isn't setup/ready yet");
+        return -1;
+    }
+
+    memset(names, 0, sizeof(*names));
+
+    // the resident table ends at the module reference table
+    size_t res_ofs = (size_t)exe->HeaderOffset + exe->header.ResidNamTable;
+    size_t res_len = 0;
+    if (exe->header.ModRefTable > exe->header.ResidNamTable)
+        res_len = exe->header.ModRefTable - exe->header.ResidNamTable;
+    if (res_ofs > rd->size)
+        res_len = 0;
+    else if (res_len > rd->size - res_ofs)
+        res_len = rd->size - res_ofs;
+
+    size_t nonres_ofs = exe->header.OffStartNonResTab;
+    size_t nonres_len = exe->header.NoResNamesTabSiz;
+    const uint8_t *nonres = nonres_len ? NE_readerView(rd, nonres_ofs, nonres_len) : NULL;
+    if (nonres_len && !nonres) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Nonresident name table runs past the end of the file");
+        return -1;
+    }
+
+    const uint8_t *res = res_len ? rd->data + res_ofs : NULL;
+    size_t res_count = res_len ? NE_countNames(res, res_len) : 0;
+    size_t nonres_count = nonres ? NE_countNames(nonres, nonres_len) : 0;
+    size_t total = (res_count ? res_count - 1 : 0) + (nonres_count ? nonres_count - 1 : 0);
+
+    names->Exports = NE_arenaCalloc(exe->arena, total ? total : 1, sizeof(struct NE_NameEntry));
+
+    if (!names->Exports) {
+        memset(names, 0, sizeof(*names));
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc name tables");
+        return -1;
+    }
+
+    size_t n = 0;
+    if (NE_decodeNames(exe, res, res_count, 1, &names->ModuleName, names->Exports, &n) < 0 ||
+        (nonres && NE_decodeNames(exe, nonres, nonres_count, 0, &names->Description, names->Exports, &n) < 0)) {
+        memset(names, 0, sizeof(*names));
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to intern names");
+        return -1;
+    }
+
+    names->ExportCount = n;
+    if (NE_indexNameTable(exe) < 0) {
+        memset(names, 0, sizeof(*names));
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc name tables");
+        return -1;
+    }
+
+    return 0;
+}
+
+const char *NE_exportName(const struct NE_exe *exe, uint16_t ordinal) {
+    const struct NE_NameTable *names = &exe->names;
+    if (!names->ByOrdinal)
+        return NULL;
+
+    size_t slot = NE_hashOrdinal(ordinal) & names->HashMask;
+    while (names->ByOrdinal[slot]) {
+        const struct NE_NameEntry *name = &names->Exports[names->ByOrdinal[slot] - 1];
+        if (name->Ordinal == ordinal)
+            return NE_str(exe, name->Name);
+        slot = (slot + 1) & names->HashMask;
+    }
+
+    return NULL;
+}
+
+// Returns the ordinal exported under `name`, or -1
+int NE_exportOrdinal(const struct NE_exe *exe, const char *name, size_t len) {
+    const struct NE_NameTable *names = &exe->names;
+    if (!names->ByName)
+        return -1;
+
+    // a name that was never interned can't be exported
+    NE_strid id = NE_strpoolFind(exe->pool, name, len);
+    if (!id)
+        return -1;
+
+    size_t slot = NE_strpoolHash(exe->pool, id) & names->HashMask;
+
+    while (names->ByName[slot]) {
+        const struct NE_NameEntry *entry = &names->Exports[names->ByName[slot] - 1];
+        if (entry->Name == id)
+            return entry->Ordinal;
+
+        slot = (slot + 1) & names->HashMask;
+    }
+
+    return -1;
+}
+
+// Intern the counted string at `offset` in the imported names table, 0 if
+// it's out of bounds
+static NE_strid NE_internImportName(
+    const struct NE_reader *rd,
+    const struct NE_exe *exe,
+    uint16_t offset
+) {
+    size_t ofs = (size_t)exe->HeaderOffset + exe->header.ImportNameTable + offset;
+
+    const uint8_t *len = NE_readerView(rd, ofs, 1);
+    if (!len)
+        return 0;
+
+    const uint8_t *text = NE_readerView(rd, ofs + 1, *len);
+    if (!text)
+        return 0;
+
+    return NE_strpoolIntern(exe->pool, (const char *)text, *len);
+}
+
+int NE_readImportTable(const struct NE_reader *rd, struct NE_exe *exe) {
+    struct NE_ImportTable *imports = &exe->imports;
+
+    if (!exe->ready) {
+        NE_setError(exe, NE_ERR_NOT_READY, "Exe struct isn't setup/ready yet");
+        return -1;
+    }
+
+    memset(imports, 0, sizeof(*imports));
+
+    size_t count = exe->header.ModRefs;
+    if (count == 0)
+        return 0;
+
+    const uint8_t *refs = NE_readerView(
+        rd,
+        (size_t)exe->HeaderOffset + exe->header.ModRefTable,
+        count * 2
+    );
+
+    if (!refs) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Module reference table runs past the end of the file");
+        return -1;
+    }
+
+    imports->Modules = NE_arenaCalloc(exe->arena, count, sizeof(NE_strid));
+    if (!imports->Modules) {
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc module reference table");
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        imports->Modules[i] = NE_internImportName(rd, exe, NE_getU16(refs + i * 2));
+        if (!imports->Modules[i]) {
+            memset(imports, 0, sizeof(*imports));
+            NE_setError(exe, NE_ERR_CORRUPT, "Bad module reference");
+            return -1;
+        }
+    }
+
+    imports->ModuleCount = count;
+    return 0;
+}
+
+NE_strid NE_importedName(const struct NE_exe *exe, uint16_t offset) {
+    return NE_internImportName(&exe->reader, exe, offset);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "hash.h"
+#include <string.h>
+
+#define NE_P1 11400714785074694791ULL
+#define NE_P2 14029467366897019727ULL
+#define NE_P3  1609587929392839161ULL
+#define NE_P4  9650029242287828579ULL
+#define NE_P5  2870177450012600261ULL
+
+static inline uint64_t NE_rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t NE_read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline uint32_t NE_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t NE_hashRound(uint64_t acc, uint64_t input) {
+    acc += input * NE_P2;
+    acc = NE_rotl64(acc, 31);
+    return acc * NE_P1;
+}
+
+static inline uint64_t NE_hashMerge(uint64_t acc, uint64_t val) {
+    acc ^= NE_hashRound(0, val);
+    return acc * NE_P1 + NE_P4;
+}
+
+uint64_t NE_hash64(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = data;
+    const uint8_t *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        // four independent lanes keep the multipliers busy
+        uint64_t v1 = seed + NE_P1 + NE_P2;
+        uint64_t v2 = seed + NE_P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - NE_P1;
+
+        do {
+            v1 = NE_hashRound(v1, NE_read64(p));
+            v2 = NE_hashRound(v2, NE_read64(p + 8));
+            v3 = NE_hashRound(v3, NE_read64(p + 16));
+            v4 = NE_hashRound(v4, NE_read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+
+        h = NE_rotl64(v1, 1) + NE_rotl64(v2, 7) + NE_rotl64(v3, 12) + NE_rotl64(v4, 18);
+        h = NE_hashMerge(h, v1);
+        h = NE_hashMerge(h, v2);
+        h = NE_hashMerge(h, v3);
+        h = NE_hashMerge(h, v4);
+    } else {
+        h = seed + NE_P5;
+    }
+
+    h += (uint64_t)len;
+
+    for (; end - p >= 8; p += 8) {
+        h ^= NE_hashRound(0, NE_read64(p));
+        h = NE_rotl64(h, 27) * NE_P1 + NE_P4;
+    }
+
+    if (end - p >= 4) {
+        h ^= (uint64_t)NE_read32(p) * NE_P1;
+        h = NE_rotl64(h, 23) * NE_P2 + NE_P3;
+        p += 4;
+    }
+
+    for (; p < end; p++) {
+        h ^= (uint64_t)*p * NE_P5;
+        h = NE_rotl64(h, 11) * NE_P1;
+    }
+
+    h ^= h >> 33;
+    h *= NE_P2;
+    h ^= h >> 29;
+    h *= NE_P3;
+    h ^= h >> 32;
+    return h;
+}
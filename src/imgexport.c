@@ -0,0 +1,599 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "imgexport.h"
+#include "batch.h"
+#include "dib.h"
+#include "hash.h"
+#include "png.h"
+#include "reader.h"
+#include "stb_ds.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+struct NE_imgExportItem {
+    uint64_t hash;
+    const char *ext;
+    char key[32];           // in `seen`
+    struct NE_image img;    // pixels for the encoders, PNGs only
+    uint8_t *data;          // the file
+    size_t size;
+    struct NE_imgExportFile **files; // stb_ds array, waiting for it, under ex->lock
+};
+
+// What's left to do for one batch file, everything under ex->lock
+struct NE_imgExportFile {
+    struct NE_batchJob *job;
+    struct NE_batchHold *hold;  // taken with the file's first image
+    char *path;
+    char *err;                  // messages for the file's error output
+    size_t err_len;
+    int failed;
+    size_t refs;                // the worker until NE_imgExportEnd, and every item
+};
+
+static int NE_imgExportQueueInit(struct NE_imgExportQueue *q, size_t cap) {
+    memset(q, 0, sizeof(*q));
+
+    q->items = calloc(cap, sizeof(*q->items));
+    if (!q->items)
+        return -1;
+
+    q->cap = cap;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->more, NULL);
+    pthread_cond_init(&q->room, NULL);
+    return 0;
+}
+
+static void NE_imgExportQueueFree(struct NE_imgExportQueue *q) {
+    free(q->items);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->more);
+    pthread_cond_destroy(&q->room);
+}
+
+// Blocks while the queue is full
+static void NE_imgExportQueuePush(struct NE_imgExportQueue *q, struct NE_imgExportItem *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->cap)
+        pthread_cond_wait(&q->room, &q->lock);
+
+    q->items[(q->head + q->count) % q->cap] = item;
+    q->count++;
+    pthread_cond_signal(&q->more);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Blocks while the queue is empty. NULL once it's closed and drained.
+static struct NE_imgExportItem *NE_imgExportQueuePop(struct NE_imgExportQueue *q) {
+    struct NE_imgExportItem *item = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->count && !q->closed)
+        pthread_cond_wait(&q->more, &q->lock);
+
+    if (q->count) {
+        item = q->items[q->head];
+        q->head = (q->head + 1) % q->cap;
+        q->count--;
+        pthread_cond_signal(&q->room);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+static void NE_imgExportQueueClose(struct NE_imgExportQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->more);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void NE_imgExportItemFree(struct NE_imgExportItem *item) {
+    NE_imageFree(&item->img);
+    free(item->data);
+    free(item);
+}
+
+// With ex->lock held. The last reference lets the file's output go.
+static struct NE_imgExportFile *NE_imgExportUnref(struct NE_imgExportFile *file) {
+    return --file->refs ? NULL : file;
+}
+
+static void NE_imgExportFinish(struct NE_imgExportFile *file) {
+    if (file->hold)
+        NE_batchRelease(file->hold, file->err, file->err_len, file->failed);
+    free(file->err);
+    free(file->path);
+    free(file);
+}
+
+// With ex->lock held
+static void NE_imgExportAttach(struct NE_imgExportItem *item, struct NE_imgExportFile *file) {
+    arrput(item->files, file);
+    file->refs++;
+}
+
+// The item is finished, `what` failed with `err` unless it's NULL. Files
+// waiting for it hear about a failure, and the name is given up so the
+// next resource with it tries again.
+static void NE_imgExportDone(struct NE_imgExport *ex, struct NE_imgExportItem *item, const char *what, int err) {
+    char name[64];
+
+    if (what) {
+        snprintf(name, sizeof(name), "%02x/%s", (unsigned)(item->hash >> 56), item->key);
+        __atomic_fetch_add(&ex->failed, 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_lock(&ex->lock);
+    if (what)
+        (void)shdel(ex->seen, item->key);
+    else
+        shput(ex->seen, item->key, NULL);
+
+    struct NE_imgExportFile **files = item->files;
+    item->files = NULL;
+
+    for (ptrdiff_t i = 0; i < arrlen(files); i++) {
+        struct NE_imgExportFile *file = files[i];
+
+        if (what) {
+            int n = snprintf(NULL, 0, "ned: %s: Failed to %s image %s: %s\n", file->path, what, name, strerror(err));
+            char *grown = n > 0 ? realloc(file->err, file->err_len + (size_t)n + 1) : NULL;
+            if (grown) {
+                snprintf(grown + file->err_len, (size_t)n + 1, "ned: %s: Failed to %s image %s: %s\n",
+                    file->path, what, name, strerror(err));
+                file->err = grown;
+                file->err_len += (size_t)n;
+            }
+            file->failed = 1;
+        }
+
+        files[i] = NE_imgExportUnref(file);
+    }
+    pthread_mutex_unlock(&ex->lock);
+
+    for (ptrdiff_t i = 0; i < arrlen(files); i++) {
+        if (files[i])
+            NE_imgExportFinish(files[i]);
+    }
+    arrfree(files);
+}
+
+static void *NE_imgExportEncoder(void *arg) {
+    struct NE_imgExport *ex = arg;
+    struct NE_imgExportItem *item;
+
+    while ((item = NE_imgExportQueuePop(&ex->encode))) {
+        int ret = NE_pngEncode(item->img.rgba, item->img.width, item->img.height, &item->data, &item->size);
+        NE_imageFree(&item->img);
+
+        if (ret < 0) {
+            NE_imgExportDone(ex, item, "encode", errno);
+            NE_imgExportItemFree(item);
+            continue;
+        }
+
+        NE_imgExportQueuePush(&ex->write, item);
+    }
+
+    return NULL;
+}
+
+static void *NE_imgExportWriter(void *arg) {
+    struct NE_imgExport *ex = arg;
+    struct NE_imgExportItem *item;
+
+    while ((item = NE_imgExportQueuePop(&ex->write))) {
+        int ret = NE_blobstoreWriteFile(ex->store, item->hash, item->ext, item->data, item->size);
+
+        if (ret < 0) {
+            NE_imgExportDone(ex, item, "write", errno);
+        } else {
+            __atomic_fetch_add(ret ? &ex->written : &ex->existing, 1, __ATOMIC_RELAXED);
+            NE_imgExportDone(ex, item, NULL, 0);
+        }
+
+        NE_imgExportItemFree(item);
+    }
+
+    return NULL;
+}
+
+int NE_imgExportStart(struct NE_imgExport *ex, struct NE_blobstore *store, size_t encoders, size_t depth) {
+    memset(ex, 0, sizeof(*ex));
+    ex->store = store;
+
+    if (!encoders)
+        encoders = 1;
+    if (!depth)
+        depth = 1;
+
+    ex->encoders = calloc(encoders, sizeof(*ex->encoders));
+    if (!ex->encoders)
+        return -1;
+
+    if (NE_imgExportQueueInit(&ex->encode, depth) < 0) {
+        free(ex->encoders);
+        return -1;
+    }
+
+    if (NE_imgExportQueueInit(&ex->write, depth) < 0) {
+        NE_imgExportQueueFree(&ex->encode);
+        free(ex->encoders);
+        return -1;
+    }
+
+    pthread_mutex_init(&ex->lock, NULL);
+    sh_new_strdup(ex->seen);
+
+    int err = pthread_create(&ex->writer, NULL, NE_imgExportWriter, ex);
+    if (!err) {
+        // fewer encoders than asked for still work
+        for (size_t i = 0; i < encoders; i++) {
+            if (pthread_create(&ex->encoders[i], NULL, NE_imgExportEncoder, ex) != 0)
+                break;
+            ex->encoder_count++;
+        }
+
+        if (!ex->encoder_count) {
+            NE_imgExportQueueClose(&ex->write);
+            pthread_join(ex->writer, NULL);
+            err = EAGAIN;
+        }
+    }
+
+    if (err) {
+        shfree(ex->seen);
+        pthread_mutex_destroy(&ex->lock);
+        NE_imgExportQueueFree(&ex->write);
+        NE_imgExportQueueFree(&ex->encode);
+        free(ex->encoders);
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+
+void NE_imgExportStop(struct NE_imgExport *ex) {
+    // the encoders feed the writer, they have to be done first
+    NE_imgExportQueueClose(&ex->encode);
+    for (size_t i = 0; i < ex->encoder_count; i++)
+        pthread_join(ex->encoders[i], NULL);
+
+    NE_imgExportQueueClose(&ex->write);
+    pthread_join(ex->writer, NULL);
+
+    shfree(ex->seen);
+    pthread_mutex_destroy(&ex->lock);
+    NE_imgExportQueueFree(&ex->write);
+    NE_imgExportQueueFree(&ex->encode);
+    free(ex->encoders);
+    ex->encoders = NULL;
+    ex->encoder_count = 0;
+}
+
+// 1 if `item` is the one to make its file. 0 if another resource of this
+// run does, `file` waits for that one then, or an earlier run stored it
+// already.
+static int NE_imgExportClaim(struct NE_imgExport *ex, struct NE_imgExportFile *file, struct NE_imgExportItem *item) {
+    char path[PATH_MAX];
+    struct stat st;
+
+    snprintf(item->key, sizeof(item->key), "%016llx.%s", (unsigned long long)item->hash, item->ext);
+
+    pthread_mutex_lock(&ex->lock);
+    ptrdiff_t i = shgeti(ex->seen, item->key);
+    if (i >= 0) {
+        // NULL once it's stored
+        if (ex->seen[i].value)
+            NE_imgExportAttach(ex->seen[i].value, file);
+        pthread_mutex_unlock(&ex->lock);
+        __atomic_fetch_add(&ex->existing, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    shput(ex->seen, item->key, item);
+    NE_imgExportAttach(item, file);
+    pthread_mutex_unlock(&ex->lock);
+
+    // files are renamed into place, one that exists is complete
+    NE_blobstorePath(ex->store, item->hash, item->ext, path, sizeof(path));
+    if (stat(path, &st) == 0 && st.st_size > 0) {
+        __atomic_fetch_add(&ex->existing, 1, __ATOMIC_RELAXED);
+        NE_imgExportDone(ex, item, NULL, 0);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void NE_imgExportPutU16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void NE_imgExportPutU32(uint8_t *p, uint32_t v) {
+    NE_imgExportPutU16(p, (uint16_t)v);
+    NE_imgExportPutU16(p + 2, (uint16_t)(v >> 16));
+}
+
+struct NE_imgExportMember {
+    const uint8_t *entry;   // in the group
+    const uint8_t *data;
+    size_t size;
+};
+
+// Rebuild the .ico or .cur file an RT_GROUP_ICON or RT_GROUP_CURSOR was
+// made from. The group is the file's directory with resource ids where
+// the file has offsets: a 6 byte header, then 14 byte entries ending in
+// the id of an RT_ICON or RT_CURSOR. Members that aren't there are left
+// out. Returns the malloc'd file, or NULL with `error` set.
+static uint8_t *NE_imgExportGroup(
+    const struct NE_exe *exe,
+    const uint8_t *data,
+    size_t size,
+    int cursor,
+    size_t *out_size,
+    const char **error
+) {
+    if (size < 6) {
+        *error = "Resource group is truncated";
+        return NULL;
+    }
+
+    uint16_t count = NE_getU16(data + 4);
+    if (size < 6 + (size_t)count * 14) {
+        *error = "Resource group is truncated";
+        return NULL;
+    }
+
+    struct NE_imgExportMember *members = calloc(count ? count : 1, sizeof(*members));
+    if (!members) {
+        *error = "Out of memory";
+        return NULL;
+    }
+
+    // a cursor's hotspot moves from its bytes into the directory
+    size_t skip = cursor ? 4 : 0;
+    size_t found = 0;
+    size_t total = 6;
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *entry = data + 6 + i * 14;
+        struct NE_imgExportMember *m = &members[found];
+        struct NE_rsrc r;
+
+        if (!NE_rsrcFind(exe, cursor ? rt_cursor : rt_icon, NE_getU16(entry + 12), &r))
+            continue;
+
+        m->data = NE_rsrcData(exe, &r, &m->size);
+        if (!m->data || m->size <= skip || m->size - skip > UINT32_MAX)
+            continue;
+
+        m->entry = entry;
+        total += 16 + m->size - skip;
+        found++;
+    }
+
+    if (!found || total > UINT32_MAX) {
+        free(members);
+        *error = found ? "Resource group is too big" : "None of the group's images are in the file";
+        return NULL;
+    }
+
+    uint8_t *out = malloc(total);
+    if (!out) {
+        free(members);
+        *error = "Out of memory";
+        return NULL;
+    }
+
+    NE_imgExportPutU16(out, 0);
+    NE_imgExportPutU16(out + 2, cursor ? 2 : 1);
+    NE_imgExportPutU16(out + 4, (uint16_t)found);
+
+    size_t offset = 6 + found * 16;
+    for (size_t i = 0; i < found; i++) {
+        const struct NE_imgExportMember *m = &members[i];
+        uint8_t *dir = out + 6 + i * 16;
+        size_t len = m->size - skip;
+
+        if (cursor) {
+            // the group has 16 bit sizes, twice the height for the mask
+            // rows, and no hotspot
+            uint16_t width = NE_getU16(m->entry);
+            uint16_t height = NE_getU16(m->entry + 2) / 2;
+
+            dir[0] = width < 256 ? (uint8_t)width : 0;
+            dir[1] = height < 256 ? (uint8_t)height : 0;
+            dir[2] = 0;
+            dir[3] = 0;
+            NE_imgExportPutU16(dir + 4, NE_getU16(m->data));
+            NE_imgExportPutU16(dir + 6, NE_getU16(m->data + 2));
+        } else {
+            // size, colors, planes and depth are the same as in the file
+            memcpy(dir, m->entry, 8);
+        }
+
+        // the real size rather than the group's, which may be off
+        NE_imgExportPutU32(dir + 8, (uint32_t)len);
+        NE_imgExportPutU32(dir + 12, (uint32_t)offset);
+        memcpy(out + offset, m->data + skip, len);
+        offset += len;
+    }
+
+    free(members);
+    *out_size = total;
+    return out;
+}
+
+static void NE_imgExportName(uint64_t hash, const char *ext, char *name, size_t len) {
+    snprintf(name, len, "%02x/%016llx.%s", (unsigned)(hash >> 56), (unsigned long long)hash, ext);
+}
+
+static const char *NE_imgExportDibError(enum NE_status status) {
+    switch (status) {
+        case NE_ERR_TRUNCATED:   return "Bitmap data is truncated";
+        case NE_ERR_UNSUPPORTED: return "Unsupported bitmap format";
+        default:                 return "Bitmap is corrupt";
+    }
+}
+
+struct NE_imgExportFile *NE_imgExportBegin(struct NE_batchJob *job, const char *path) {
+    struct NE_imgExportFile *file = calloc(1, sizeof(*file));
+    if (!file)
+        return NULL;
+
+    file->path = strdup(path);
+    if (!file->path) {
+        free(file);
+        return NULL;
+    }
+
+    file->job = job;
+    file->refs = 1;
+    return file;
+}
+
+void NE_imgExportEnd(struct NE_imgExport *ex, struct NE_imgExportFile *file) {
+    pthread_mutex_lock(&ex->lock);
+    file = NE_imgExportUnref(file);
+    pthread_mutex_unlock(&ex->lock);
+
+    if (file)
+        NE_imgExportFinish(file);
+}
+
+// Claim the name of `item` for `file`, and decode and queue it if it's
+// the one to make it. Takes `item`.
+static int NE_imgExportQueue(
+    struct NE_imgExport *ex,
+    struct NE_imgExportFile *file,
+    struct NE_imgExportItem *item,
+    enum NE_dibKind kind,
+    const uint8_t *data,
+    size_t size,
+    const char **error
+) {
+    // the file's output waits for its images, and their errors
+    if (!file->hold && !(file->hold = NE_batchHold(file->job))) {
+        NE_imgExportItemFree(item);
+        *error = "Out of memory";
+        return -1;
+    }
+
+    if (!NE_imgExportClaim(ex, file, item)) {
+        NE_imgExportItemFree(item);
+        return 1;
+    }
+
+    // nothing to encode, straight to the writer
+    if (item->data) {
+        NE_imgExportQueuePush(&ex->write, item);
+        return 1;
+    }
+
+    if (NE_dibDecode(data, size, kind, &item->img) != NE_OK) {
+        NE_imgExportDone(ex, item, "decode", ENOMEM);
+        NE_imgExportItemFree(item);
+        *error = "Out of memory";
+        return -1;
+    }
+
+    NE_imgExportQueuePush(&ex->encode, item);
+    return 1;
+}
+
+int NE_imgExportRsrc(
+    struct NE_imgExport *ex,
+    struct NE_imgExportFile *file,
+    const struct NE_exe *exe,
+    const struct NE_rsrc *r,
+    const uint8_t *data,
+    size_t size,
+    char *name,
+    size_t len,
+    const char **error
+) {
+    struct NE_imgExportItem *item;
+    enum NE_dibKind kind;
+
+    if (!(r->type->TypeID & NE_RSRC_INTEGER_ID))
+        return 0;
+
+    switch (r->type->TypeID & ~NE_RSRC_INTEGER_ID) {
+        case rt_bitmap:
+            kind = NE_DIB_BITMAP;
+            break;
+        case rt_icon:
+            kind = NE_DIB_ICON;
+            break;
+        case rt_cursor:
+            kind = NE_DIB_CURSOR;
+            break;
+        case rt_group_icon:
+        case rt_group_cursor: {
+            int cursor = (r->type->TypeID & ~NE_RSRC_INTEGER_ID) == rt_group_cursor;
+            size_t file_size;
+
+            uint8_t *bytes = NE_imgExportGroup(exe, data, size, cursor, &file_size, error);
+            if (!bytes)
+                return -1;
+
+            item = calloc(1, sizeof(*item));
+            if (!item) {
+                free(bytes);
+                *error = "Out of memory";
+                return -1;
+            }
+
+            item->hash = NE_hash64(bytes, file_size, 0);
+            item->ext = cursor ? "cur" : "ico";
+            item->data = bytes;
+            item->size = file_size;
+            NE_imgExportName(item->hash, item->ext, name, len);
+            __atomic_fetch_add(&ex->images, 1, __ATOMIC_RELAXED);
+            return NE_imgExportQueue(ex, file, item, NE_DIB_BITMAP, data, size, error);
+        }
+        default:
+            return 0;
+    }
+
+    // check it before claiming the name: a bitmap that can't be decoded
+    // must not leave a name behind that no file will have
+    struct NE_image img;
+    enum NE_status status = NE_dibProbe(data, size, kind, &img);
+    if (status != NE_OK) {
+        *error = NE_imgExportDibError(status);
+        return -1;
+    }
+
+    item = calloc(1, sizeof(*item));
+    if (!item) {
+        *error = "Out of memory";
+        return -1;
+    }
+
+    // the kind goes in too, the same bytes make another image as an icon
+    item->hash = NE_hash64(data, size, kind);
+    item->ext = "png";
+    NE_imgExportName(item->hash, item->ext, name, len);
+    __atomic_fetch_add(&ex->images, 1, __ATOMIC_RELAXED);
+    return NE_imgExportQueue(ex, file, item, kind, data, size, error);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Image export for `ned extract --images`: bitmaps, icons and cursors
+// are written as PNGs, and icon and cursor groups are put back together
+// as the .ico and .cur files they were made from.
+//
+// It's a pipeline. The batch workers find the resources and decode the
+// DIBs, a pool of encoder threads turns the pixels into PNGs, and one
+// writer thread stores the files, with a bounded queue between each
+// stage: a worker only waits when the encoders are `depth` images behind,
+// and otherwise moves on to its next file while the last one is encoded.
+//
+// The files land next to the blobs, named by content like them. A PNG is
+// named by the hash of the DIB it comes from, so the same bitmap is only
+// decoded and encoded once, and not at all if an earlier run stored it.
+//
+#pragma once
+#include "blobstore.h"
+#include "ne.h"
+#include "rsrc.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct NE_batchJob;
+struct NE_imgExportItem;
+struct NE_imgExportFile;
+
+struct NE_imgExportQueue {
+    struct NE_imgExportItem **items;   // ring of `cap`
+    size_t cap;
+    size_t head;
+    size_t count;
+    int closed;                        // no more pushes, drain and stop
+    pthread_mutex_t lock;
+    pthread_cond_t more;               // items came in or it was closed
+    pthread_cond_t room;               // items were taken out
+};
+
+// Names claimed this run, "hash.ext", with the item making it or NULL
+// once it's stored
+struct NE_imgExportSeen {
+    char *key;
+    struct NE_imgExportItem *value;
+};
+
+struct NE_imgExport {
+    struct NE_blobstore *store;
+    pthread_mutex_t lock;              // of `seen` and the files waiting
+    struct NE_imgExportSeen *seen;     // stb_ds string map
+    struct NE_imgExportQueue encode;   // decoded images for the encoders
+    struct NE_imgExportQueue write;    // finished files for the writer
+    pthread_t *encoders;
+    size_t encoder_count;
+    pthread_t writer;
+
+    uint64_t images;                   // updated atomically
+    uint64_t written;                  // files written
+    uint64_t existing;                 // already stored, or taken care of by another resource
+    uint64_t failed;                   // couldn't be encoded or written
+};
+
+// Start `encoders` encoder threads and the writer, with queues of `depth`
+// items. -1 with errno set on failure.
+int NE_imgExportStart(struct NE_imgExport *ex, struct NE_blobstore *store, size_t encoders, size_t depth);
+
+// Wait for the queued images to be written, then stop the threads
+void NE_imgExportStop(struct NE_imgExport *ex);
+
+// The images of the batch file `path`, NULL if out of memory. Once it has
+// any, the file's output waits until they're all written, and their
+// failures to encode or write go to its error output and fail it.
+struct NE_imgExportFile *NE_imgExportBegin(struct NE_batchJob *job, const char *path);
+
+// The file has no more images, let its output go once they're done
+void NE_imgExportEnd(struct NE_imgExport *ex, struct NE_imgExportFile *file);
+
+// Queue the image made of resource `r` with bytes `data`, for `file`.
+// Returns 1 with its file name (relative to the blob directory) in
+// `name`, 0 if `r` isn't an image, or -1 with the reason in `error`.
+// Failures to encode or write come later, see NE_imgExportBegin, and are
+// counted in `failed`. A name that failed is tried again by the next
+// resource with it.
+int NE_imgExportRsrc(
+    struct NE_imgExport *ex,
+    struct NE_imgExportFile *file,
+    const struct NE_exe *exe,
+    const struct NE_rsrc *r,
+    const uint8_t *data,
+    size_t size,
+    char *name,
+    size_t len,
+    const char **error
+);
@@ -0,0 +1,937 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE
+#include "index.h"
+#include "reloc.h"
+#include "stb_ds.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NE_INDEX_ENDIAN 0x01020304u
+#define NE_INDEX_ALIGN  8
+
+// Module names are matched without regard to case
+static size_t NE_indexUpper(char *dst, const char *src, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        dst[i] = (char)toupper((unsigned char)src[i]);
+    return len;
+}
+
+// Resource type key: "#N" for integer types, the name otherwise
+static size_t NE_indexRsrcKey(char *dst, size_t size, const struct NE_exe *exe, uint16_t type) {
+    if (type & NE_RSRC_INTEGER_ID)
+        return (size_t)snprintf(dst, size, "#%u", type & ~NE_RSRC_INTEGER_ID);
+
+    const char *name = NE_getRsrcName(exe, type);
+    if (!name)
+        return 0;
+
+    size_t len = strlen(name);
+    if (len >= size)
+        len = size - 1;
+    memcpy(dst, name, len);
+    return len;
+}
+
+//
+// Building
+//
+
+static int NE_indexSetInit(struct NE_indexSet *set) {
+    set->bitmaps = NULL;
+    return NE_strpoolInit(&set->keys, NULL, NE_STRPOOL_MAX_CHUNKS);
+}
+
+static void NE_indexSetFree(struct NE_indexSet *set) {
+    for (ptrdiff_t i = 0; i < hmlen(set->bitmaps); i++)
+        free(set->bitmaps[i].value);
+
+    hmfree(set->bitmaps);
+    NE_strpoolFree(&set->keys);
+}
+
+static int NE_indexSetAdd(
+    struct NE_indexSet *set,
+    size_t words,
+    const char *key,
+    size_t len,
+    size_t file
+) {
+    NE_strid id = NE_strpoolIntern(&set->keys, key, len);
+    if (!id)
+        return -1;
+
+    uint64_t *bits = hmget(set->bitmaps, id);
+    if (!bits) {
+        bits = calloc(words, sizeof(uint64_t));
+        if (!bits)
+            return -1;
+        hmput(set->bitmaps, id, bits);
+    }
+
+    bits[file / 64] |= (uint64_t)1 << (file % 64);
+    return 0;
+}
+
+static int NE_indexPostingSetInit(struct NE_indexPostingSet *set) {
+    set->lists = NULL;
+    return NE_strpoolInit(&set->keys, NULL, NE_STRPOOL_MAX_CHUNKS);
+}
+
+static void NE_indexPostingSetFree(struct NE_indexPostingSet *set) {
+    for (ptrdiff_t i = 0; i < hmlen(set->lists); i++)
+        arrfree(set->lists[i].value);
+
+    hmfree(set->lists);
+    NE_strpoolFree(&set->keys);
+}
+
+static int NE_indexPostingSetAdd(
+    struct NE_indexPostingSet *set,
+    const char *key,
+    size_t len,
+    size_t file
+) {
+    NE_strid id = NE_strpoolIntern(&set->keys, key, len);
+    if (!id)
+        return -1;
+
+    ptrdiff_t i = hmgeti(set->lists, id);
+    if (i < 0) {
+        hmput(set->lists, id, NULL);
+        i = hmgeti(set->lists, id);
+    }
+
+    // files arrive in any order, lists are sorted when written
+    arrput(set->lists[i].value, (uint32_t)file);
+    return 0;
+}
+
+// "MODULE!NAME" or "MODULE!#ORDINAL", 0 if the import can't be named
+static size_t NE_indexProcKey(char *dst, size_t size, const struct NE_exe *exe, const struct NE_ImportRef *ref) {
+    if (ref->Module == 0 || ref->Module > exe->imports.ModuleCount)
+        return 0;
+
+    NE_strid mod = exe->imports.Modules[ref->Module - 1];
+    if (!mod || (ref->ByName && !ref->Name))
+        return 0;
+
+    size_t len = NE_indexUpper(dst, NE_str(exe, mod), NE_strpoolLen(exe->pool, mod));
+    dst[len++] = '!';
+
+    if (!ref->ByName)
+        len += (size_t)snprintf(dst + len, size - len, "#%u", ref->Proc);
+    else
+        len += NE_indexUpper(dst + len, NE_str(exe, ref->Name), NE_strpoolLen(exe->pool, ref->Name));
+
+    // longer than a pool string: can't be a real import anyway
+    return len <= 0xFF ? len : 0;
+}
+
+int NE_indexBuilderInit(struct NE_indexBuilder *b, size_t file_count) {
+    memset(b, 0, sizeof(*b));
+    pthread_mutex_init(&b->lock, NULL);
+
+    size_t n = file_count ? file_count : 1;
+    b->file_count = file_count;
+    b->bitmap_words = (file_count + 63) / 64;
+
+    b->paths = calloc(n, sizeof(char *));
+    b->Status = calloc(n, sizeof(uint8_t));
+    b->TargetOS = calloc(n, sizeof(uint8_t));
+    b->Linker = calloc(n, sizeof(uint16_t));
+    b->WinVer = calloc(n, sizeof(uint16_t));
+    b->Flags = calloc(n, sizeof(uint16_t));
+    b->SegCount = calloc(n, sizeof(uint16_t));
+
+    if (!b->paths || !b->Status || !b->TargetOS || !b->Linker || !b->WinVer ||
+        !b->Flags || !b->SegCount ||
+        NE_indexSetInit(&b->modules) < 0 || NE_indexSetInit(&b->rsrc_types) < 0 ||
+        NE_indexPostingSetInit(&b->procs) < 0) {
+        NE_indexBuilderFree(b);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void NE_indexRecordKey(struct NE_indexRecord *rec, const char *key, size_t len) {
+    char *dst = arraddnptr(rec->keys, len + 1);
+    dst[0] = (char)(uint8_t)len;
+    memcpy(dst + 1, key, len);
+}
+
+int NE_indexRecordFill(struct NE_indexRecord *rec, const char *path, struct NE_exe *exe) {
+    struct NE_ImportRef *refs = NULL;
+    size_t ref_count = 0;
+    char key[2 * 256 + 8];
+
+    memset(rec, 0, sizeof(*rec));
+    rec->path = strdup(path);
+    if (!rec->path)
+        return -1;
+
+    if (!exe || !exe->ready)
+        return 0;
+
+    // A file with broken relocations is still indexed, just without procs
+    if (NE_collectImports(exe, &refs, &ref_count) < 0)
+        ref_count = 0;
+
+    const struct NE_header *hdr = &exe->header;
+    rec->Status = 1;
+    rec->TargetOS = hdr->targOS;
+    rec->Linker = (uint16_t)(hdr->MajLinkerVersion << 8 | hdr->MinLinkerVersion);
+    rec->WinVer = (uint16_t)(hdr->expctwinver[1] << 8 | hdr->expctwinver[0]);
+    rec->Flags = (uint16_t)(hdr->FlagWord | hdr->ApplFlags << 8);
+    rec->SegCount = (uint16_t)exe->segs.Count;
+
+    for (size_t i = 0; i < exe->imports.ModuleCount; i++) {
+        NE_strid mod = exe->imports.Modules[i];
+        size_t len = NE_indexUpper(key, NE_str(exe, mod), NE_strpoolLen(exe->pool, mod));
+
+        NE_indexRecordKey(rec, key, len);
+        rec->module_count++;
+    }
+
+    for (size_t i = 0; i < exe->rsrc.TypeCount; i++) {
+        size_t len = NE_indexRsrcKey(key, sizeof(key), exe, exe->rsrc.Types[i].TypeID);
+
+        if (len) {
+            NE_indexRecordKey(rec, key, len);
+            rec->rsrc_count++;
+        }
+    }
+
+    for (size_t i = 0; i < ref_count; i++) {
+        size_t len = NE_indexProcKey(key, sizeof(key), exe, &refs[i]);
+
+        if (len) {
+            NE_indexRecordKey(rec, key, len);
+            rec->proc_count++;
+        }
+    }
+
+    return 0;
+}
+
+void NE_indexRecordFree(struct NE_indexRecord *rec) {
+    free(rec->path);
+    arrfree(rec->keys);
+    memset(rec, 0, sizeof(*rec));
+}
+
+int NE_indexBuilderAddRecord(
+    struct NE_indexBuilder *b,
+    size_t file,
+    const struct NE_indexRecord *rec
+) {
+    int ret = 0;
+
+    if (file >= b->file_count)
+        return -1;
+
+    pthread_mutex_lock(&b->lock);
+
+    free(b->paths[file]);
+    b->paths[file] = rec->path ? strdup(rec->path) : NULL;
+    if (!b->paths[file])
+        ret = -1;
+
+    if (!rec->Status)
+        goto exit_add;
+
+    b->Status[file] = rec->Status;
+    b->TargetOS[file] = rec->TargetOS;
+    b->Linker[file] = rec->Linker;
+    b->WinVer[file] = rec->WinVer;
+    b->Flags[file] = rec->Flags;
+    b->SegCount[file] = rec->SegCount;
+
+    const char *key = rec->keys;
+    uint32_t n = rec->module_count + rec->rsrc_count + rec->proc_count;
+
+    for (uint32_t i = 0; i < n; i++) {
+        size_t len = (uint8_t)key[0];
+        int added;
+
+        if (i < rec->module_count)
+            added = NE_indexSetAdd(&b->modules, b->bitmap_words, key + 1, len, file);
+        else if (i < rec->module_count + rec->rsrc_count)
+            added = NE_indexSetAdd(&b->rsrc_types, b->bitmap_words, key + 1, len, file);
+        else
+            added = NE_indexPostingSetAdd(&b->procs, key + 1, len, file);
+
+        if (added < 0)
+            ret = -1;
+        key += 1 + len;
+    }
+
+exit_add:
+    pthread_mutex_unlock(&b->lock);
+    return ret;
+}
+
+int NE_indexBuilderAdd(
+    struct NE_indexBuilder *b,
+    size_t file,
+    const char *path,
+    struct NE_exe *exe
+) {
+    struct NE_indexRecord rec;
+
+    // decoding relocations is the slow part, it happens before the
+    // builder's lock is taken
+    int ret = NE_indexRecordFill(&rec, path, exe);
+
+    if (NE_indexBuilderAddRecord(b, file, &rec) < 0)
+        ret = -1;
+
+    NE_indexRecordFree(&rec);
+    return ret;
+}
+
+struct NE_indexSortKey {
+    const char *name;
+    uint32_t len;
+    const uint64_t *bits;
+};
+
+static int NE_indexCompareBytes(const char *a, size_t alen, const char *b, size_t blen) {
+    int cmp = memcmp(a, b, alen < blen ? alen : blen);
+    if (cmp)
+        return cmp;
+    return alen < blen ? -1 : alen > blen;
+}
+
+static int NE_indexCompareKeys(const void *a, const void *b) {
+    const struct NE_indexSortKey *x = a;
+    const struct NE_indexSortKey *y = b;
+    return NE_indexCompareBytes(x->name, x->len, y->name, y->len);
+}
+
+static int NE_indexPad(FILE *fp) {
+    static const uint8_t zero[NE_INDEX_ALIGN];
+    long pos = ftell(fp);
+
+    if (pos < 0)
+        return -1;
+
+    size_t pad = (NE_INDEX_ALIGN - (size_t)pos % NE_INDEX_ALIGN) % NE_INDEX_ALIGN;
+    return fwrite(zero, 1, pad, fp) == pad ? 0 : -1;
+}
+
+static int NE_indexWriteColumn(
+    FILE *fp,
+    struct NE_indexHeader *hdr,
+    int column,
+    const void *data,
+    size_t size
+) {
+    if (NE_indexPad(fp) < 0)
+        return -1;
+
+    hdr->columns[column].offset = (uint64_t)ftell(fp);
+    hdr->columns[column].size = size;
+    return fwrite(data, 1, size, fp) == size ? 0 : -1;
+}
+
+// Key table and bitmaps of one set, names appended to `strings`
+static int NE_indexWriteSet(
+    FILE *fp,
+    FILE *strings,
+    struct NE_indexHeader *hdr,
+    const struct NE_indexSet *set,
+    size_t words,
+    int keys_column,
+    uint64_t *count
+) {
+    size_t n = (size_t)hmlen(set->bitmaps);
+    struct NE_indexSortKey *sorted = calloc(n ? n : 1, sizeof(*sorted));
+    struct NE_indexKey *keys = calloc(n ? n : 1, sizeof(*keys));
+    int ret = -1;
+
+    if (!sorted || !keys)
+        goto exit_set;
+
+    for (size_t i = 0; i < n; i++) {
+        sorted[i].name = NE_strpoolGet(&set->keys, set->bitmaps[i].key);
+        sorted[i].len = (uint32_t)NE_strpoolLen(&set->keys, set->bitmaps[i].key);
+        sorted[i].bits = set->bitmaps[i].value;
+    }
+
+    qsort(sorted, n, sizeof(*sorted), NE_indexCompareKeys);
+
+    for (size_t i = 0; i < n; i++) {
+        keys[i].name = (uint32_t)ftell(strings);
+        keys[i].len = sorted[i].len;
+        fwrite(sorted[i].name, 1, sorted[i].len + 1, strings);
+    }
+
+    if (NE_indexWriteColumn(fp, hdr, keys_column, keys, n * sizeof(*keys)) < 0)
+        goto exit_set;
+
+    // bitmaps follow their key table, in key order
+    if (NE_indexPad(fp) < 0)
+        goto exit_set;
+
+    hdr->columns[keys_column + 1].offset = (uint64_t)ftell(fp);
+    hdr->columns[keys_column + 1].size = (uint64_t)n * words * sizeof(uint64_t);
+
+    for (size_t i = 0; i < n; i++) {
+        if (fwrite(sorted[i].bits, sizeof(uint64_t), words, fp) != words)
+            goto exit_set;
+    }
+
+    *count = n;
+    ret = 0;
+
+exit_set:
+    free(sorted);
+    free(keys);
+    return ret;
+}
+
+struct NE_indexSortList {
+    const char *name;
+    uint32_t len;
+    uint32_t *ids;
+};
+
+static int NE_indexCompareLists(const void *a, const void *b) {
+    const struct NE_indexSortList *x = a;
+    const struct NE_indexSortList *y = b;
+    return NE_indexCompareBytes(x->name, x->len, y->name, y->len);
+}
+
+static int NE_indexCompareIds(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Key table and encoded lists of the procs, names appended to `strings`
+static int NE_indexWritePostings(
+    FILE *fp,
+    FILE *strings,
+    struct NE_indexHeader *hdr,
+    const struct NE_indexPostingSet *set
+) {
+    size_t n = (size_t)hmlen(set->lists);
+    struct NE_indexSortList *sorted = calloc(n ? n : 1, sizeof(*sorted));
+    struct NE_indexPostingKey *keys = calloc(n ? n : 1, sizeof(*keys));
+    uint8_t *postings = NULL;
+    size_t postings_size = 0;
+    int ret = -1;
+
+    if (!sorted || !keys)
+        goto exit_postings;
+
+    size_t bound = 0;
+    for (size_t i = 0; i < n; i++) {
+        sorted[i].name = NE_strpoolGet(&set->keys, set->lists[i].key);
+        sorted[i].len = (uint32_t)NE_strpoolLen(&set->keys, set->lists[i].key);
+        sorted[i].ids = set->lists[i].value;
+        bound += NE_postingsBound((size_t)arrlen(sorted[i].ids));
+    }
+
+    qsort(sorted, n, sizeof(*sorted), NE_indexCompareLists);
+
+    postings = malloc(bound ? bound : 1);
+    if (!postings)
+        goto exit_postings;
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t *ids = sorted[i].ids;
+        size_t count = (size_t)arrlen(ids);
+        size_t unique = 0;
+
+        qsort(ids, count, sizeof(*ids), NE_indexCompareIds);
+        for (size_t j = 0; j < count; j++) {
+            if (!unique || ids[unique - 1] != ids[j])
+                ids[unique++] = ids[j];
+        }
+
+        size_t size = NE_postingsEncode(ids, unique, postings + postings_size);
+
+        keys[i].name = (uint32_t)ftell(strings);
+        keys[i].len = sorted[i].len;
+        keys[i].count = (uint32_t)unique;
+        keys[i].size = (uint32_t)size;
+        keys[i].offset = postings_size;
+        fwrite(sorted[i].name, 1, sorted[i].len + 1, strings);
+
+        postings_size += size;
+    }
+
+    if (NE_indexWriteColumn(fp, hdr, NE_INDEX_PROC_KEYS, keys, n * sizeof(*keys)) < 0 ||
+        NE_indexWriteColumn(fp, hdr, NE_INDEX_PROC_POSTINGS, postings, postings_size) < 0)
+        goto exit_postings;
+
+    hdr->proc_count = n;
+    ret = 0;
+
+exit_postings:
+    free(sorted);
+    free(keys);
+    free(postings);
+    return ret;
+}
+
+static int NE_indexWrite(FILE *fp, FILE *strings, char **strings_buf, size_t *strings_size, struct NE_indexBuilder *b) {
+    struct NE_indexHeader hdr = {0};
+    size_t n = b->file_count;
+
+    memcpy(hdr.magic, NE_INDEX_MAGIC, sizeof(hdr.magic));
+    hdr.version = NE_INDEX_VERSION;
+    hdr.endian = NE_INDEX_ENDIAN;
+    hdr.file_count = n;
+    hdr.bitmap_words = b->bitmap_words;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+        return -1;
+
+    uint32_t *path_offsets = calloc(n ? n : 1, sizeof(uint32_t));
+    if (!path_offsets)
+        return -1;
+
+    for (size_t i = 0; i < n; i++) {
+        const char *path = b->paths[i] ? b->paths[i] : "";
+        path_offsets[i] = (uint32_t)ftell(strings);
+        fwrite(path, 1, strlen(path) + 1, strings);
+    }
+
+    int ret = NE_indexWriteColumn(fp, &hdr, NE_INDEX_PATH_OFFSETS, path_offsets, n * sizeof(uint32_t));
+    free(path_offsets);
+
+    if (ret < 0 ||
+        NE_indexWriteColumn(fp, &hdr, NE_INDEX_STATUS, b->Status, n) < 0 ||
+        NE_indexWriteColumn(fp, &hdr, NE_INDEX_TARGET_OS, b->TargetOS, n) < 0 ||
+        NE_indexWriteColumn(fp, &hdr, NE_INDEX_LINKER, b->Linker, n * sizeof(uint16_t)) < 0 ||
+        NE_indexWriteColumn(fp, &hdr, NE_INDEX_WINVER, b->WinVer, n * sizeof(uint16_t)) < 0 ||
+        NE_indexWriteColumn(fp, &hdr, NE_INDEX_FLAGS, b->Flags, n * sizeof(uint16_t)) < 0 ||
+        NE_indexWriteColumn(fp, &hdr, NE_INDEX_SEG_COUNT, b->SegCount, n * sizeof(uint16_t)) < 0)
+        return -1;
+
+    if (NE_indexWriteSet(fp, strings, &hdr, &b->modules, b->bitmap_words,
+                         NE_INDEX_MODULE_KEYS, &hdr.module_count) < 0 ||
+        NE_indexWriteSet(fp, strings, &hdr, &b->rsrc_types, b->bitmap_words,
+                         NE_INDEX_RSRC_KEYS, &hdr.rsrc_count) < 0 ||
+        NE_indexWritePostings(fp, strings, &hdr, &b->procs) < 0)
+        return -1;
+
+    if (fflush(strings) != 0 || ferror(strings) ||
+        NE_indexWriteColumn(fp, &hdr, NE_INDEX_STRINGS, *strings_buf, *strings_size) < 0)
+        return -1;
+
+    rewind(fp);
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fflush(fp) != 0)
+        return -1;
+
+    return 0;
+}
+
+int NE_indexBuilderWrite(struct NE_indexBuilder *b, const char *path) {
+    char *strings_buf = NULL;
+    size_t strings_size = 0;
+    FILE *fp = NULL;
+    int ret = -1;
+
+    // a temp file next to the index renamed over it, so `ned query` (or a
+    // rewrite by `ned watch`) never sees half an index
+    size_t tmp_len = strlen(path) + sizeof(".XXXXXX");
+    char *tmp = malloc(tmp_len);
+    if (!tmp)
+        return -1;
+
+    snprintf(tmp, tmp_len, "%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    if (fd >= 0) {
+        fchmod(fd, 0644);
+        fp = fdopen(fd, "wb");
+        if (!fp)
+            close(fd);
+    }
+
+    FILE *strings = open_memstream(&strings_buf, &strings_size);
+
+    if (fp && strings && NE_indexWrite(fp, strings, &strings_buf, &strings_size, b) == 0)
+        ret = 0;
+
+    int saved = errno;
+    if (strings)
+        fclose(strings);
+    free(strings_buf);
+    if (fp && fclose(fp) != 0) {
+        saved = errno;
+        ret = -1;
+    }
+    if (ret == 0 && rename(tmp, path) != 0) {
+        saved = errno;
+        ret = -1;
+    }
+    if (ret < 0 && fd >= 0)
+        unlink(tmp);
+    errno = saved;
+
+    free(tmp);
+    return ret;
+}
+
+void NE_indexBuilderFree(struct NE_indexBuilder *b) {
+    if (b->paths) {
+        for (size_t i = 0; i < b->file_count; i++)
+            free(b->paths[i]);
+    }
+
+    free(b->paths);
+    free(b->Status);
+    free(b->TargetOS);
+    free(b->Linker);
+    free(b->WinVer);
+    free(b->Flags);
+    free(b->SegCount);
+
+    if (b->modules.keys.chunks)
+        NE_indexSetFree(&b->modules);
+    if (b->rsrc_types.keys.chunks)
+        NE_indexSetFree(&b->rsrc_types);
+    if (b->procs.keys.chunks)
+        NE_indexPostingSetFree(&b->procs);
+
+    pthread_mutex_destroy(&b->lock);
+    memset(b, 0, sizeof(*b));
+}
+
+//
+// Querying
+//
+
+static const void *NE_indexColumnData(const struct NE_index *idx, int column) {
+    return idx->data + idx->hdr->columns[column].offset;
+}
+
+static int NE_indexCheck(struct NE_index *idx) {
+    const struct NE_indexHeader *hdr = idx->hdr;
+
+    if (idx->size < sizeof(*hdr) ||
+        memcmp(hdr->magic, NE_INDEX_MAGIC, sizeof(hdr->magic)) != 0) {
+        idx->error = "Not a ned index";
+        return -1;
+    }
+
+    if (hdr->version != NE_INDEX_VERSION || hdr->endian != NE_INDEX_ENDIAN) {
+        idx->error = "Index was written by an incompatible version";
+        return -1;
+    }
+
+    uint64_t n = hdr->file_count;
+    uint64_t words = hdr->bitmap_words;
+    if (n > UINT32_MAX || words != (n + 63) / 64 ||
+        hdr->module_count > UINT32_MAX || hdr->rsrc_count > UINT32_MAX ||
+        hdr->proc_count > UINT32_MAX) {
+        idx->error = "Index header is corrupt";
+        return -1;
+    }
+
+    const uint64_t expect[NE_INDEX_COLUMNS] = {
+        [NE_INDEX_PATH_OFFSETS]   = n * 4,
+        [NE_INDEX_STATUS]         = n,
+        [NE_INDEX_TARGET_OS]      = n,
+        [NE_INDEX_LINKER]         = n * 2,
+        [NE_INDEX_WINVER]         = n * 2,
+        [NE_INDEX_FLAGS]          = n * 2,
+        [NE_INDEX_SEG_COUNT]      = n * 2,
+        [NE_INDEX_MODULE_KEYS]    = hdr->module_count * sizeof(struct NE_indexKey),
+        [NE_INDEX_MODULE_BITMAPS] = hdr->module_count * words * 8,
+        [NE_INDEX_RSRC_KEYS]      = hdr->rsrc_count * sizeof(struct NE_indexKey),
+        [NE_INDEX_RSRC_BITMAPS]   = hdr->rsrc_count * words * 8,
+        [NE_INDEX_PROC_KEYS]      = hdr->proc_count * sizeof(struct NE_indexPostingKey),
+        [NE_INDEX_PROC_POSTINGS]  = hdr->columns[NE_INDEX_PROC_POSTINGS].size,
+        [NE_INDEX_STRINGS]        = hdr->columns[NE_INDEX_STRINGS].size,
+    };
+
+    for (int i = 0; i < NE_INDEX_COLUMNS; i++) {
+        const struct NE_indexSection *col = &hdr->columns[i];
+
+        if (col->size != expect[i] || col->offset % NE_INDEX_ALIGN != 0 ||
+            col->offset > idx->size || col->size > idx->size - col->offset) {
+            idx->error = "Index column is out of bounds";
+            return -1;
+        }
+    }
+
+    // every string lookup stops at a NUL inside the column
+    const struct NE_indexSection *strings = &hdr->columns[NE_INDEX_STRINGS];
+    if (strings->size && idx->data[strings->offset + strings->size - 1] != '\0') {
+        idx->error = "Index string table is corrupt";
+        return -1;
+    }
+
+    return 0;
+}
+
+int NE_indexOpen(struct NE_index *idx, const char *path) {
+    memset(idx, 0, sizeof(*idx));
+    idx->error = "Unknown";
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        idx->error = "Failed to open index";
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct NE_indexHeader)) {
+        close(fd);
+        idx->error = "Not a ned index";
+        return -1;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        idx->error = "Failed to map index";
+        return -1;
+    }
+
+    idx->data = map;
+    idx->size = (size_t)st.st_size;
+    idx->hdr = map;
+
+    if (NE_indexCheck(idx) < 0) {
+        const char *error = idx->error;
+        NE_indexClose(idx);
+        idx->error = error;
+        return -1;
+    }
+
+    idx->file_count = (size_t)idx->hdr->file_count;
+    idx->bitmap_words = (size_t)idx->hdr->bitmap_words;
+    idx->PathOffsets = NE_indexColumnData(idx, NE_INDEX_PATH_OFFSETS);
+    idx->Status = NE_indexColumnData(idx, NE_INDEX_STATUS);
+    idx->TargetOS = NE_indexColumnData(idx, NE_INDEX_TARGET_OS);
+    idx->Linker = NE_indexColumnData(idx, NE_INDEX_LINKER);
+    idx->WinVer = NE_indexColumnData(idx, NE_INDEX_WINVER);
+    idx->Flags = NE_indexColumnData(idx, NE_INDEX_FLAGS);
+    idx->SegCount = NE_indexColumnData(idx, NE_INDEX_SEG_COUNT);
+    idx->strings = NE_indexColumnData(idx, NE_INDEX_STRINGS);
+    idx->strings_size = (size_t)idx->hdr->columns[NE_INDEX_STRINGS].size;
+
+    idx->error = "Success";
+    return 0;
+}
+
+void NE_indexClose(struct NE_index *idx) {
+    if (idx->data)
+        munmap((void *)idx->data, idx->size);
+
+    memset(idx, 0, sizeof(*idx));
+}
+
+const char *NE_indexPath(const struct NE_index *idx, size_t file) {
+    if (file >= idx->file_count || idx->PathOffsets[file] >= idx->strings_size)
+        return "";
+
+    return idx->strings + idx->PathOffsets[file];
+}
+
+// Position of `key` in a sorted key table, -1 if missing. Both key structs
+// start with the name and length.
+static ptrdiff_t NE_indexSearch(
+    const struct NE_index *idx,
+    int keys_column,
+    size_t stride,
+    size_t count,
+    const char *key,
+    size_t len
+) {
+    const uint8_t *keys = NE_indexColumnData(idx, keys_column);
+    size_t lo = 0, hi = count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct NE_indexKey *k = (const struct NE_indexKey *)(keys + mid * stride);
+
+        if (k->name >= idx->strings_size || k->len > idx->strings_size - k->name)
+            return -1;
+
+        int cmp = NE_indexCompareBytes(idx->strings + k->name, k->len, key, len);
+        if (cmp == 0)
+            return (ptrdiff_t)mid;
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return -1;
+}
+
+static const uint64_t *NE_indexFindKey(
+    const struct NE_index *idx,
+    int keys_column,
+    size_t count,
+    const char *key,
+    size_t len
+) {
+    const uint64_t *bitmaps = NE_indexColumnData(idx, keys_column + 1);
+    ptrdiff_t i = NE_indexSearch(idx, keys_column, sizeof(struct NE_indexKey), count, key, len);
+
+    return i < 0 ? NULL : bitmaps + (size_t)i * idx->bitmap_words;
+}
+
+const uint64_t *NE_indexModuleBitmap(const struct NE_index *idx, const char *module) {
+    char key[256];
+    size_t len = strlen(module);
+
+    if (len >= sizeof(key))
+        return NULL;
+
+    NE_indexUpper(key, module, len);
+    return NE_indexFindKey(idx, NE_INDEX_MODULE_KEYS, (size_t)idx->hdr->module_count, key, len);
+}
+
+const uint64_t *NE_indexRsrcBitmap(const struct NE_index *idx, const char *type) {
+    return NE_indexFindKey(idx, NE_INDEX_RSRC_KEYS, (size_t)idx->hdr->rsrc_count, type, strlen(type));
+}
+
+int NE_indexProcPostings(
+    const struct NE_index *idx,
+    const char *proc,
+    struct NE_postingsCursor *cur
+) {
+    char key[256];
+    const char *bang = strchr(proc, '!');
+    size_t len = strlen(proc);
+
+    if (!bang || len >= sizeof(key))
+        return -1;
+
+    // "GDI.EXE!BitBlt" -> "GDI!BITBLT": the table only has module names
+    size_t mod_len = (size_t)(bang - proc);
+    const char *dot = memchr(proc, '.', mod_len);
+    if (dot)
+        mod_len = (size_t)(dot - proc);
+
+    NE_indexUpper(key, proc, mod_len);
+    len = mod_len + NE_indexUpper(key + mod_len, bang, len - (size_t)(bang - proc));
+
+    ptrdiff_t i = NE_indexSearch(idx, NE_INDEX_PROC_KEYS, sizeof(struct NE_indexPostingKey),
+                                 (size_t)idx->hdr->proc_count, key, len);
+    if (i < 0)
+        return -1;
+
+    const struct NE_indexPostingKey *keys = NE_indexColumnData(idx, NE_INDEX_PROC_KEYS);
+    const struct NE_indexPostingKey *k = &keys[i];
+    const struct NE_indexSection *col = &idx->hdr->columns[NE_INDEX_PROC_POSTINGS];
+
+    if (k->offset > col->size || k->size > col->size - k->offset)
+        return -1;
+
+    return NE_postingsOpen(cur, idx->data + col->offset + k->offset, k->size, k->count);
+}
+
+void NE_indexFilterInit(struct NE_indexFilter *filter) {
+    memset(filter, 0, sizeof(*filter));
+    filter->target_os = -1;
+    filter->linker = -1;
+    filter->winver = -1;
+    filter->min_segs = -1;
+}
+
+static int NE_indexMatchScalars(
+    const struct NE_index *idx,
+    const struct NE_indexFilter *filter,
+    size_t i
+) {
+    return idx->Status[i] &&
+        (filter->target_os < 0 || idx->TargetOS[i] == filter->target_os) &&
+        (filter->linker < 0 || idx->Linker[i] == filter->linker) &&
+        (filter->winver < 0 || idx->WinVer[i] == filter->winver) &&
+        (idx->Flags[i] & filter->flags_mask) == filter->flags_value &&
+        (filter->min_segs < 0 || idx->SegCount[i] >= filter->min_segs);
+}
+
+size_t NE_indexQuery(
+    const struct NE_index *idx,
+    const struct NE_indexFilter *filter,
+    uint64_t *result
+) {
+    size_t words = idx->bitmap_words;
+    size_t count = 0;
+
+    if (filter->proc_count) {
+        // the posting lists pick the first candidates, bits are only set
+        // for files in all of them
+        struct NE_postingsCursor *lists = calloc(filter->proc_count, sizeof(*lists));
+        size_t found = 0;
+
+        memset(result, 0, words * sizeof(uint64_t));
+        if (!lists)
+            return 0;
+
+        for (size_t p = 0; p < filter->proc_count; p++) {
+            if (NE_indexProcPostings(idx, filter->procs[p], &lists[p]) < 0) {
+                free(lists);
+                return 0;
+            }
+        }
+
+        found = NE_postingsIntersect(lists, filter->proc_count, result, idx->file_count);
+        free(lists);
+        if (found == 0)
+            return 0;
+    } else {
+        for (size_t w = 0; w < words; w++)
+            result[w] = ~(uint64_t)0;
+        if (idx->file_count % 64)
+            result[words - 1] = ((uint64_t)1 << (idx->file_count % 64)) - 1;
+    }
+
+    // set filters first: they narrow things down a word at a time
+    for (size_t m = 0; m < filter->module_count; m++) {
+        const uint64_t *bits = NE_indexModuleBitmap(idx, filter->modules[m]);
+        for (size_t w = 0; w < words; w++)
+            result[w] &= bits ? bits[w] : 0;
+    }
+
+    for (size_t r = 0; r < filter->rsrc_count; r++) {
+        const uint64_t *bits = NE_indexRsrcBitmap(idx, filter->rsrc_types[r]);
+        for (size_t w = 0; w < words; w++)
+            result[w] &= bits ? bits[w] : 0;
+    }
+
+    // then the scalar columns, only for the files still in
+    for (size_t w = 0; w < words; w++) {
+        uint64_t bits = result[w];
+
+        for (uint64_t left = bits; left; left &= left - 1) {
+            size_t i = w * 64 + (size_t)__builtin_ctzll(left);
+            if (!NE_indexMatchScalars(idx, filter, i))
+                bits &= ~((uint64_t)1 << (i % 64));
+        }
+
+        result[w] = bits;
+        count += (size_t)__builtin_popcountll(bits);
+    }
+
+    return count;
+}
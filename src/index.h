@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Corpus index: one file describing a whole batch of executables, laid out
+// column by column so a query only touches the columns it filters on.
+//
+// Scalars from the header (linker and Windows versions, target OS, flags,
+// segment count) are one array per field, indexed by file id. Imported
+// modules and resource types are sets: a sorted key table plus, for every
+// key, a bitmap with one bit per file. "Targets Windows 3.0 and imports
+// COMMDLG" is then one bitmap AND followed by a scan of one column.
+//
+// Imported procedures are far too many for a bitmap each. They map from
+// "MODULE!NAME" (or "MODULE!#ORDINAL") to a compressed posting list of
+// file ids instead, see postings.h.
+//
+// Every column is 8-byte aligned so the file is used in place after a
+// single mmap.
+//
+#pragma once
+#include "ne.h"
+#include "postings.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NE_INDEX_MAGIC   "NEDINDEX"
+#define NE_INDEX_VERSION 2
+
+enum NE_indexColumn {
+    NE_INDEX_PATH_OFFSETS,      // uint32_t per file, into NE_INDEX_STRINGS
+    NE_INDEX_STATUS,            // uint8_t per file, 1 = parsed
+    NE_INDEX_TARGET_OS,         // uint8_t
+    NE_INDEX_LINKER,            // uint16_t, major << 8 | minor
+    NE_INDEX_WINVER,            // uint16_t, major << 8 | minor
+    NE_INDEX_FLAGS,             // uint16_t, FlagWord | ApplFlags << 8
+    NE_INDEX_SEG_COUNT,         // uint16_t
+    NE_INDEX_MODULE_KEYS,       // struct NE_indexKey, sorted
+    NE_INDEX_MODULE_BITMAPS,    // bitmap_words uint64_t per key
+    NE_INDEX_RSRC_KEYS,
+    NE_INDEX_RSRC_BITMAPS,
+    NE_INDEX_PROC_KEYS,         // struct NE_indexPostingKey, sorted
+    NE_INDEX_PROC_POSTINGS,     // encoded posting lists
+    NE_INDEX_STRINGS,           // NUL terminated
+    NE_INDEX_COLUMNS
+};
+
+struct NE_indexSection {
+    uint64_t offset;
+    uint64_t size;              // bytes
+};
+
+struct NE_indexHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t file_count;
+    uint64_t bitmap_words;      // (file_count + 63) / 64
+    uint64_t module_count;
+    uint64_t rsrc_count;
+    uint64_t proc_count;
+    struct NE_indexSection columns[NE_INDEX_COLUMNS];
+};
+
+struct NE_indexKey {
+    uint32_t name;              // offset into NE_INDEX_STRINGS
+    uint32_t len;
+};
+
+struct NE_indexPostingKey {
+    uint32_t name;              // offset into NE_INDEX_STRINGS
+    uint32_t len;
+    uint32_t count;             // files in the list
+    uint32_t size;              // bytes
+    uint64_t offset;            // into NE_INDEX_PROC_POSTINGS
+};
+
+// An index opened for querying. The arrays point into the mapping.
+struct NE_index {
+    const char *error;
+    const uint8_t *data;
+    size_t size;
+    const struct NE_indexHeader *hdr;
+
+    size_t file_count;
+    size_t bitmap_words;
+    const uint32_t *PathOffsets;
+    const uint8_t  *Status;
+    const uint8_t  *TargetOS;
+    const uint16_t *Linker;
+    const uint16_t *WinVer;
+    const uint16_t *Flags;
+    const uint16_t *SegCount;
+    const char *strings;
+    size_t strings_size;
+};
+
+int NE_indexOpen(struct NE_index *idx, const char *path);
+void NE_indexClose(struct NE_index *idx);
+const char *NE_indexPath(const struct NE_index *idx, size_t file);
+
+// Bitmap of the files importing `module` (any case) or having resources
+// of `type` ("#3" for integer type 3, else the type's name). NULL if no
+// file has it.
+const uint64_t *NE_indexModuleBitmap(const struct NE_index *idx, const char *module);
+const uint64_t *NE_indexRsrcBitmap(const struct NE_index *idx, const char *type);
+
+// Cursor over the files importing `proc`, written "MODULE!NAME" or
+// "MODULE!#ORDINAL" in any case. A module extension is ignored, so
+// "gdi.exe!BitBlt" works too. -1 if no file imports it.
+int NE_indexProcPostings(
+    const struct NE_index *idx,
+    const char *proc,
+    struct NE_postingsCursor *cur
+);
+
+// Query filter, -1/NULL/0 fields match anything
+struct NE_indexFilter {
+    int target_os;
+    int linker;                 // major << 8 | minor
+    int winver;
+    uint16_t flags_mask;        // (flags & mask) == value
+    uint16_t flags_value;
+    int min_segs;
+    const char **modules;       // all of them must be imported
+    size_t module_count;
+    const char **rsrc_types;    // all of them must be present
+    size_t rsrc_count;
+    const char **procs;         // all of them must be imported
+    size_t proc_count;
+};
+
+void NE_indexFilterInit(struct NE_indexFilter *filter);
+
+// Fill `result` (bitmap_words words) with the files matching `filter`.
+// Returns the number of matches.
+size_t NE_indexQuery(
+    const struct NE_index *idx,
+    const struct NE_indexFilter *filter,
+    uint64_t *result
+);
+
+// Building an index from a batch. Files can be added from any thread, in
+// any order; file ids are the positions given to NE_indexBuilderAdd.
+struct NE_indexSet {
+    struct NE_strpool keys;
+    struct { NE_strid key; uint64_t *value; } *bitmaps; // stb_ds hashmap
+};
+
+// Same, but with an stb_ds array of file ids per key
+struct NE_indexPostingSet {
+    struct NE_strpool keys;
+    struct { NE_strid key; uint32_t *value; } *lists;
+};
+
+struct NE_indexBuilder {
+    pthread_mutex_t lock;
+    size_t file_count;
+    size_t bitmap_words;
+
+    char    **paths;
+    uint8_t  *Status;
+    uint8_t  *TargetOS;
+    uint16_t *Linker;
+    uint16_t *WinVer;
+    uint16_t *Flags;
+    uint16_t *SegCount;
+
+    struct NE_indexSet modules;
+    struct NE_indexSet rsrc_types;
+    struct NE_indexPostingSet procs;
+};
+
+// What the index keeps of one file, without a file id. `ned watch` holds
+// one per file so the index can be rebuilt without parsing them again.
+struct NE_indexRecord {
+    char *path;
+    uint8_t  Status;
+    uint8_t  TargetOS;
+    uint16_t Linker;
+    uint16_t WinVer;
+    uint16_t Flags;
+    uint16_t SegCount;
+
+    // length prefixed keys: modules, then resource types, then procs
+    char *keys;                 // stb_ds array
+    uint32_t module_count;
+    uint32_t rsrc_count;
+    uint32_t proc_count;
+};
+
+// `exe` is NULL if the file couldn't be parsed
+int NE_indexRecordFill(struct NE_indexRecord *rec, const char *path, struct NE_exe *exe);
+void NE_indexRecordFree(struct NE_indexRecord *rec);
+
+int NE_indexBuilderInit(struct NE_indexBuilder *b, size_t file_count);
+
+// Record file `file`. `exe` is NULL if it couldn't be parsed. Its
+// relocations are read to find the imported procedures.
+int NE_indexBuilderAdd(
+    struct NE_indexBuilder *b,
+    size_t file,
+    const char *path,
+    struct NE_exe *exe
+);
+
+int NE_indexBuilderAddRecord(
+    struct NE_indexBuilder *b,
+    size_t file,
+    const struct NE_indexRecord *rec
+);
+
+// Replaces `path` atomically, readers see the old or the new index
+int NE_indexBuilderWrite(struct NE_indexBuilder *b, const char *path);
+void NE_indexBuilderFree(struct NE_indexBuilder *b);
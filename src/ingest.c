@@ -0,0 +1,664 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include "ingest.h"
+#include "stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define NE_HAVE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#define NE_INGEST_MAX_DEPTH 4096
+#define NE_INGEST_MAX_THREADS 256
+#define NE_INGEST_STACK (64 * 1024)    // the loaders barely touch their stacks
+#define NE_INGEST_READ_MAX (1u << 30)   // io_uring lengths are 32 bit
+
+const char *NE_ingestBackendName(enum NE_ingestBackend backend) {
+    switch (backend) {
+        case NE_INGEST_URING:
+            return "io_uring";
+        case NE_INGEST_THREADS:
+            return "threads";
+        default:
+            return "auto";
+    }
+}
+
+// Hand a file on to the parser, loaded or not
+static void NE_ingestDone(struct NE_ingest *in, size_t slot, int fd, uint8_t *data, size_t size) {
+    struct NE_ingestFile *file = &in->files[slot];
+
+    // no bytes at all looks the same as from NE_openReader
+    if (size == 0) {
+        free(data);
+        data = NULL;
+    }
+
+    file->fd = fd;
+    file->data = data;
+    file->size = size;
+
+    if (fd >= 0) {
+        __atomic_fetch_add(&in->stats.files, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&in->stats.bytes, size, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&in->stats.skipped, 1, __ATOMIC_RELAXED);
+    }
+
+    in->ready(in->ctx, slot);
+}
+
+// Next file to start, SIZE_MAX once all are started or we're stopping.
+// With `wait` it sleeps while the parser is too far behind.
+static size_t NE_ingestClaim(struct NE_ingest *in, int wait) {
+    size_t slot = SIZE_MAX;
+
+    pthread_mutex_lock(&in->lock);
+    while (wait && !in->stop && in->next < in->count && in->next >= in->limit)
+        pthread_cond_wait(&in->more, &in->lock);
+
+    if (!in->stop && in->next < in->count && in->next < in->limit)
+        slot = in->next++;
+    pthread_mutex_unlock(&in->lock);
+
+    return slot;
+}
+
+// Blocking load of one file, for the thread backend
+static void NE_ingestLoad(struct NE_ingest *in, size_t slot) {
+    uint64_t start = NE_statsBegin();
+    uint64_t calls = 1;
+    uint8_t *data = NULL;
+    size_t len = 0;
+    struct stat st;
+
+    int fd = open(in->paths[slot], O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        goto skip;
+
+    calls++;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        goto skip;
+
+    size_t size = (size_t)st.st_size;
+    data = malloc(size ? size : 1);
+    if (!data)
+        goto skip;
+
+    while (len < size) {
+        ssize_t got = pread(fd, data + len, size - len, (off_t)len);
+        calls++;
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            goto skip;
+        }
+        if (got == 0)
+            break; // file shrank under us, keep what we have
+        len += (size_t)got;
+    }
+
+    NE_statsEnd(NE_PHASE_IO, start, len, calls, 1);
+    NE_ingestDone(in, slot, fd, data, len);
+    return;
+
+skip:
+    free(data);
+    if (fd >= 0)
+        close(fd);
+
+    NE_statsEnd(NE_PHASE_IO, start, 0, calls, 0);
+    NE_ingestDone(in, slot, -1, NULL, 0);
+}
+
+static void *NE_ingestThreadMain(void *arg) {
+    struct NE_ingest *in = arg;
+    size_t slot;
+
+    while ((slot = NE_ingestClaim(in, 1)) != SIZE_MAX)
+        NE_ingestLoad(in, slot);
+
+    return NULL;
+}
+
+#ifdef NE_HAVE_URING
+// One file going through open -> statx -> read(s), one SQE at a time
+struct NE_uringOp {
+    size_t slot;
+    int stage;
+    int fd;
+    struct statx stx;
+    uint8_t *data;
+    size_t size;
+    size_t len;
+    uint64_t start;
+};
+
+enum {
+    NE_URING_OPEN,
+    NE_URING_STAT,
+    NE_URING_READ
+};
+
+struct NE_uring {
+    int fd;
+    void *sq_map;
+    size_t sq_len;
+    void *cq_map;
+    size_t cq_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned to_submit;
+
+    struct NE_uringOp *ops;
+    struct NE_uringOp **free_ops;
+    int nfree;
+};
+
+static int NE_uringEnter(struct NE_uring *ring, unsigned submit, unsigned wait) {
+    return (int)syscall(__NR_io_uring_enter, ring->fd, submit, wait, IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+// Every opcode we use, checked up front so an old kernel falls back to
+// threads instead of failing each file
+static int NE_uringProbe(struct NE_uring *ring) {
+    static const uint8_t needed[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ };
+    size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+    int ret = 0;
+
+    if (!probe)
+        return -1;
+
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        free(probe);
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(needed); i++) {
+        if (needed[i] > probe->last_op || !(probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED)) {
+            errno = ENOSYS;
+            ret = -1;
+        }
+    }
+
+    free(probe);
+    return ret;
+}
+
+static void NE_uringFree(struct NE_uring *ring) {
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_map && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_len);
+    if (ring->sq_map)
+        munmap(ring->sq_map, ring->sq_len);
+    if (ring->fd >= 0)
+        close(ring->fd);
+
+    free(ring->ops);
+    free(ring->free_ops);
+}
+
+static void *NE_uringMap(int fd, size_t len, off_t offset) {
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return map == MAP_FAILED ? NULL : map;
+}
+
+static int NE_uringInit(struct NE_uring *ring, int depth) {
+    struct io_uring_params p;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, (unsigned)depth, &p);
+    if (ring->fd < 0)
+        return -1;
+
+    if (NE_uringProbe(ring) < 0)
+        goto fail;
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len)
+            ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_map = NE_uringMap(ring->fd, ring->sq_len, IORING_OFF_SQ_RING);
+    if (!ring->sq_map)
+        goto fail;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cq_map = ring->sq_map;
+    else if (!(ring->cq_map = NE_uringMap(ring->fd, ring->cq_len, IORING_OFF_CQ_RING)))
+        goto fail;
+
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = NE_uringMap(ring->fd, ring->sqes_len, IORING_OFF_SQES);
+    if (!ring->sqes)
+        goto fail;
+
+    uint8_t *sq = ring->sq_map;
+    uint8_t *cq = ring->cq_map;
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // at most one SQE per op in flight, so the rings can never fill up
+    ring->ops = calloc((size_t)depth, sizeof(*ring->ops));
+    ring->free_ops = malloc((size_t)depth * sizeof(*ring->free_ops));
+    if (!ring->ops || !ring->free_ops)
+        goto fail;
+
+    for (int i = 0; i < depth; i++)
+        ring->free_ops[ring->nfree++] = &ring->ops[i];
+
+    return 0;
+
+fail:
+    NE_uringFree(ring);
+    return -1;
+}
+
+// Fill in the returned SQE, then NE_uringCommit it
+static struct io_uring_sqe *NE_uringSqe(struct NE_uring *ring, struct NE_uringOp *op) {
+    unsigned tail = *ring->sq_tail;
+    struct io_uring_sqe *sqe = &ring->sqes[tail & ring->sq_mask];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+    return sqe;
+}
+
+static void NE_uringCommit(struct NE_uring *ring) {
+    unsigned tail = *ring->sq_tail;
+
+    ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+}
+
+static void NE_uringOpen(struct NE_uring *ring, struct NE_uringOp *op, const char *path) {
+    struct io_uring_sqe *sqe = NE_uringSqe(ring, op);
+
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)path;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    NE_uringCommit(ring);
+}
+
+static void NE_uringStat(struct NE_uring *ring, struct NE_uringOp *op) {
+    struct io_uring_sqe *sqe = NE_uringSqe(ring, op);
+
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = op->fd;
+    sqe->addr = (uint64_t)(uintptr_t)"";
+    sqe->len = STATX_TYPE | STATX_SIZE;
+    sqe->statx_flags = AT_EMPTY_PATH;
+    sqe->off = (uint64_t)(uintptr_t)&op->stx;
+    NE_uringCommit(ring);
+}
+
+static void NE_uringRead(struct NE_uring *ring, struct NE_uringOp *op) {
+    struct io_uring_sqe *sqe = NE_uringSqe(ring, op);
+    size_t want = op->size - op->len;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = op->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(op->data + op->len);
+    sqe->len = want > NE_INGEST_READ_MAX ? NE_INGEST_READ_MAX : (unsigned)want;
+    sqe->off = op->len;
+    NE_uringCommit(ring);
+}
+
+static void NE_uringFinish(struct NE_ingest *in, struct NE_uringOp *op, int loaded) {
+    struct NE_uring *ring = in->ring;
+
+    if (loaded) {
+        NE_statsEnd(NE_PHASE_IO, op->start, op->len, 0, 1);
+        NE_ingestDone(in, op->slot, op->fd, op->data, op->len);
+    } else {
+        free(op->data);
+        if (op->fd >= 0)
+            close(op->fd);
+
+        NE_statsEnd(NE_PHASE_IO, op->start, 0, 0, 0);
+        NE_ingestDone(in, op->slot, -1, NULL, 0);
+    }
+
+    ring->free_ops[ring->nfree++] = op;
+}
+
+// Next step of `op` after a completion. Returns 1 once the file is done.
+static int NE_uringStep(struct NE_ingest *in, struct NE_uringOp *op, int res) {
+    struct NE_uring *ring = in->ring;
+
+    if (res == -EINTR || res == -EAGAIN) {
+        // try the same step again
+        if (op->stage == NE_URING_OPEN)
+            NE_uringOpen(ring, op, in->paths[op->slot]);
+        else if (op->stage == NE_URING_STAT)
+            NE_uringStat(ring, op);
+        else
+            NE_uringRead(ring, op);
+        return 0;
+    }
+
+    if (res < 0) {
+        NE_uringFinish(in, op, 0);
+        return 1;
+    }
+
+    switch (op->stage) {
+        case NE_URING_OPEN:
+            op->fd = res;
+            op->stage = NE_URING_STAT;
+            NE_uringStat(ring, op);
+            return 0;
+
+        case NE_URING_STAT:
+            if (!S_ISREG(op->stx.stx_mode) || op->stx.stx_size > SIZE_MAX) {
+                NE_uringFinish(in, op, 0);
+                return 1;
+            }
+
+            op->size = (size_t)op->stx.stx_size;
+            op->data = malloc(op->size ? op->size : 1);
+            if (!op->data) {
+                NE_uringFinish(in, op, 0);
+                return 1;
+            }
+            break;
+
+        default:
+            if (res == 0) {
+                op->size = op->len; // file shrank under us, keep what we have
+                break;
+            }
+            op->len += (size_t)res;
+            break;
+    }
+
+    if (op->len < op->size) {
+        op->stage = NE_URING_READ;
+        NE_uringRead(ring, op);
+        return 0;
+    }
+
+    NE_uringFinish(in, op, 1);
+    return 1;
+}
+
+static void *NE_ingestUringMain(void *arg) {
+    struct NE_ingest *in = arg;
+    struct NE_uring *ring = in->ring;
+    int inflight = 0;
+    size_t slot;
+
+    while (1) {
+        // only sleep for more work with nothing in flight, otherwise the
+        // completions are what we wait for
+        while (ring->nfree > 0 && (slot = NE_ingestClaim(in, inflight == 0)) != SIZE_MAX) {
+            struct NE_uringOp *op = ring->free_ops[--ring->nfree];
+
+            memset(op, 0, sizeof(*op));
+            op->slot = slot;
+            op->fd = -1;
+            op->stage = NE_URING_OPEN;
+            op->start = NE_statsBegin();
+            NE_uringOpen(ring, op, in->paths[slot]);
+            inflight++;
+        }
+
+        if (inflight == 0)
+            break;
+
+        int ret = NE_uringEnter(ring, ring->to_submit, 1);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+            break;
+        }
+        ring->to_submit -= (unsigned)ret;
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        while (head != tail) {
+            const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+            struct NE_uringOp *op = (struct NE_uringOp *)(uintptr_t)cqe->user_data;
+            int res = cqe->res;
+
+            __atomic_store_n(ring->cq_head, ++head, __ATOMIC_RELEASE);
+            inflight -= NE_uringStep(in, op, res);
+        }
+    }
+
+    if (inflight == 0)
+        return NULL;
+
+    // The ring itself broke. Whatever is in flight may still be written
+    // by the kernel, so those buffers are abandoned (leaked), their files
+    // go to the parser unloaded and the rest is loaded the blocking way.
+    for (int i = 0; i < in->depth; i++) {
+        struct NE_uringOp *op = &ring->ops[i];
+        int idle = 0;
+
+        for (int j = 0; j < ring->nfree; j++)
+            idle |= ring->free_ops[j] == op;
+
+        if (!idle)
+            NE_ingestDone(in, op->slot, -1, NULL, 0);
+    }
+
+    while ((slot = NE_ingestClaim(in, 1)) != SIZE_MAX)
+        NE_ingestLoad(in, slot);
+
+    return NULL;
+}
+#endif
+
+static int NE_ingestSpawn(struct NE_ingest *in, int count, void *(*fn)(void *)) {
+    pthread_attr_t attr;
+
+    in->threads = calloc((size_t)count, sizeof(*in->threads));
+    if (!in->threads)
+        return -1;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, NE_INGEST_STACK);
+
+    for (in->nthreads = 0; in->nthreads < count; in->nthreads++) {
+        if (pthread_create(&in->threads[in->nthreads], &attr, fn, in) != 0)
+            break;
+    }
+
+    pthread_attr_destroy(&attr);
+
+    if (in->nthreads == 0) {
+        free(in->threads);
+        in->threads = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int NE_ingestStartUring(struct NE_ingest *in) {
+#ifdef NE_HAVE_URING
+    in->ring = malloc(sizeof(*in->ring));
+    if (!in->ring)
+        return -1;
+
+    if (NE_uringInit(in->ring, in->depth) == 0) {
+        if (NE_ingestSpawn(in, 1, NE_ingestUringMain) == 0)
+            return 0;
+        NE_uringFree(in->ring);
+    }
+
+    free(in->ring);
+    in->ring = NULL;
+    return -1;
+#else
+    (void)in;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+int NE_ingestStart(
+    struct NE_ingest *in,
+    char *const *paths,
+    size_t count,
+    int depth,
+    enum NE_ingestBackend backend,
+    NE_ingestFn ready,
+    void *ctx
+) {
+    memset(in, 0, sizeof(*in));
+
+    if (depth > NE_INGEST_MAX_DEPTH)
+        depth = NE_INGEST_MAX_DEPTH;
+    if (depth < 1)
+        depth = 1;
+
+    in->depth = depth;
+    in->paths = paths;
+    in->count = count;
+    in->ready = ready;
+    in->ctx = ctx;
+
+    in->files = malloc((count ? count : 1) * sizeof(*in->files));
+    if (!in->files)
+        return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        in->files[i].fd = -1;
+        in->files[i].data = NULL;
+        in->files[i].size = 0;
+    }
+
+    pthread_mutex_init(&in->lock, NULL);
+    pthread_cond_init(&in->more, NULL);
+
+    if (backend != NE_INGEST_THREADS && NE_ingestStartUring(in) == 0) {
+        in->stats.backend = NE_INGEST_URING;
+        return 0;
+    }
+
+    if (backend != NE_INGEST_URING) {
+        int threads = depth < NE_INGEST_MAX_THREADS ? depth : NE_INGEST_MAX_THREADS;
+        if ((size_t)threads > count)
+            threads = count ? (int)count : 1;
+
+        if (NE_ingestSpawn(in, threads, NE_ingestThreadMain) == 0) {
+            in->stats.backend = NE_INGEST_THREADS;
+            return 0;
+        }
+    }
+
+    int saved = errno;
+    pthread_cond_destroy(&in->more);
+    pthread_mutex_destroy(&in->lock);
+    free(in->files);
+    in->files = NULL;
+    errno = saved;
+    return -1;
+}
+
+void NE_ingestAllow(struct NE_ingest *in, size_t limit) {
+    pthread_mutex_lock(&in->lock);
+    if (limit > in->limit) {
+        // usually one more file: wake one loader, not the whole pool
+        size_t grown = limit - in->limit;
+        in->limit = limit;
+
+        if (grown >= (size_t)in->nthreads) {
+            pthread_cond_broadcast(&in->more);
+        } else {
+            for (size_t i = 0; i < grown; i++)
+                pthread_cond_signal(&in->more);
+        }
+    }
+    pthread_mutex_unlock(&in->lock);
+}
+
+int NE_ingestTake(struct NE_ingest *in, size_t slot, struct NE_ingestFile *file) {
+    struct NE_ingestFile *own = &in->files[slot];
+
+    *file = *own;
+    own->fd = -1;
+    own->data = NULL;
+    own->size = 0;
+
+    return file->fd >= 0;
+}
+
+void NE_ingestStop(struct NE_ingest *in) {
+    pthread_mutex_lock(&in->lock);
+    in->stop = 1;
+    pthread_cond_broadcast(&in->more);
+    pthread_mutex_unlock(&in->lock);
+
+    for (int t = 0; t < in->nthreads; t++)
+        pthread_join(in->threads[t], NULL);
+
+#ifdef NE_HAVE_URING
+    if (in->ring) {
+        NE_uringFree(in->ring);
+        free(in->ring);
+        in->ring = NULL;
+    }
+#endif
+
+    for (size_t i = 0; i < in->count; i++) {
+        if (in->files[i].fd >= 0)
+            close(in->files[i].fd);
+        free(in->files[i].data);
+    }
+
+    free(in->threads);
+    free(in->files);
+    in->threads = NULL;
+    in->files = NULL;
+    in->nthreads = 0;
+
+    pthread_cond_destroy(&in->more);
+    pthread_mutex_destroy(&in->lock);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Asynchronous file ingestion. Whole files are opened, sized and read into
+// heap buffers ahead of the parser, with up to `depth` files in flight, so
+// workers never block on cold or remote storage. On Linux this runs on
+// io_uring from a single thread; elsewhere, or when the kernel refuses
+// io_uring, a pool of threads does blocking open/fstat/pread instead.
+//
+// A file that can't be loaded (errors, pipes, ...) is still handed on,
+// just without bytes, and whoever parses it opens it the usual way and
+// reports the error itself.
+//
+#pragma once
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum NE_ingestBackend {
+    NE_INGEST_AUTO,     // io_uring if it works, else threads
+    NE_INGEST_URING,
+    NE_INGEST_THREADS
+};
+
+struct NE_ingestFile {
+    int fd;             // still open, -1 if the file wasn't loaded
+    uint8_t *data;      // malloc'd, the whole file
+    size_t size;
+};
+
+// Called from an ingest thread once file `slot` is loaded or given up on
+typedef void (*NE_ingestFn)(void *ctx, size_t slot);
+
+struct NE_ingestStats {
+    enum NE_ingestBackend backend;
+    uint64_t files;     // loaded
+    uint64_t bytes;
+    uint64_t skipped;   // left to the parser to open
+};
+
+struct NE_uring;
+
+struct NE_ingest {
+    int depth;
+
+    char *const *paths;
+    size_t count;
+    struct NE_ingestFile *files;
+    NE_ingestFn ready;
+    void *ctx;
+
+    pthread_mutex_t lock;
+    pthread_cond_t more;    // `limit` moved or stopping
+    size_t next;            // first file not started yet
+    size_t limit;           // files below this may be started
+    int stop;
+
+    pthread_t *threads;
+    int nthreads;
+    struct NE_uring *ring;
+
+    struct NE_ingestStats stats; // counters updated atomically
+};
+
+// Starts loading paths[0, count) in order, none before NE_ingestAllow.
+// Returns -1 if neither backend could be started.
+int NE_ingestStart(
+    struct NE_ingest *in,
+    char *const *paths,
+    size_t count,
+    int depth,
+    enum NE_ingestBackend backend,
+    NE_ingestFn ready,
+    void *ctx
+);
+
+// Let files below `limit` be started. Bounds how far ahead of the parser
+// the buffers pile up.
+void NE_ingestAllow(struct NE_ingest *in, size_t limit);
+
+// Move file `slot` out to the caller, who then owns its fd and buffer.
+// Returns 0 if it wasn't loaded.
+int NE_ingestTake(struct NE_ingest *in, size_t slot, struct NE_ingestFile *file);
+
+// Waits for the files in flight, frees whatever wasn't taken
+void NE_ingestStop(struct NE_ingest *in);
+
+const char *NE_ingestBackendName(enum NE_ingestBackend backend);
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "json.h"
+#include <string.h>
+
+void NE_jsonInit(struct NE_json *js, FILE *out) {
+    js->out = out;
+    js->error = 0;
+    js->depth = 0;
+    js->after_key = 0;
+    js->has_items[0] = 0;
+    js->len = 0;
+}
+
+int NE_jsonFlush(struct NE_json *js) {
+    if (js->len && fwrite(js->buf, 1, js->len, js->out) != js->len)
+        js->error = 1;
+
+    js->len = 0;
+    return js->error ? -1 : 0;
+}
+
+// Make room for `len` more bytes. Nothing written here is ever longer than
+// the buffer except raw text and strings, which go through NE_jsonPut.
+static inline char *NE_jsonReserve(struct NE_json *js, size_t len) {
+    if (js->len + len > sizeof(js->buf))
+        NE_jsonFlush(js);
+
+    return js->buf + js->len;
+}
+
+static void NE_jsonPut(struct NE_json *js, const char *text, size_t len) {
+    while (len) {
+        if (js->len == sizeof(js->buf))
+            NE_jsonFlush(js);
+
+        size_t n = sizeof(js->buf) - js->len;
+        if (n > len)
+            n = len;
+
+        memcpy(js->buf + js->len, text, n);
+        js->len += n;
+        text += n;
+        len -= n;
+    }
+}
+
+static inline void NE_jsonPutc(struct NE_json *js, char c) {
+    *NE_jsonReserve(js, 1) = c;
+    js->len++;
+}
+
+// Comma before every value but the first of its array or object
+static void NE_jsonValue(struct NE_json *js) {
+    if (js->after_key) {
+        js->after_key = 0;
+        return;
+    }
+
+    if (js->has_items[js->depth])
+        NE_jsonPutc(js, ',');
+    js->has_items[js->depth] = 1;
+}
+
+static void NE_jsonOpen(struct NE_json *js, char c) {
+    NE_jsonValue(js);
+    NE_jsonPutc(js, c);
+
+    // deeper nesting still comes out as valid JSON, just with commas
+    // tracked at the deepest level
+    if (js->depth + 1 < NE_JSON_MAX_DEPTH)
+        js->depth++;
+    js->has_items[js->depth] = 0;
+}
+
+static void NE_jsonClose(struct NE_json *js, char c) {
+    NE_jsonPutc(js, c);
+    if (js->depth > 0)
+        js->depth--;
+}
+
+void NE_jsonBeginObject(struct NE_json *js) { NE_jsonOpen(js, '{'); }
+void NE_jsonEndObject(struct NE_json *js)   { NE_jsonClose(js, '}'); }
+void NE_jsonBeginArray(struct NE_json *js)  { NE_jsonOpen(js, '['); }
+void NE_jsonEndArray(struct NE_json *js)    { NE_jsonClose(js, ']'); }
+
+static void NE_jsonQuoted(struct NE_json *js, const char *str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+
+    NE_jsonPutc(js, '"');
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)str[i];
+
+        // runs of plain characters are copied in one go
+        size_t run = i;
+        while (run < len && (uint8_t)str[run] >= 0x20 && (uint8_t)str[run] < 0x80 &&
+               str[run] != '"' && str[run] != '\\')
+            run++;
+
+        if (run > i) {
+            NE_jsonPut(js, str + i, run - i);
+            i = run - 1;
+            continue;
+        }
+
+        char *p = NE_jsonReserve(js, 6);
+        switch (c) {
+            case '"':  memcpy(p, "\\\"", 2); js->len += 2; break;
+            case '\\': memcpy(p, "\\\\", 2); js->len += 2; break;
+            case '\n': memcpy(p, "\\n", 2);  js->len += 2; break;
+            case '\r': memcpy(p, "\\r", 2);  js->len += 2; break;
+            case '\t': memcpy(p, "\\t", 2);  js->len += 2; break;
+            default:
+                p[0] = '\\';
+                p[1] = 'u';
+                p[2] = '0';
+                p[3] = '0';
+                p[4] = hex[c >> 4];
+                p[5] = hex[c & 0xF];
+                js->len += 6;
+                break;
+        }
+    }
+
+    NE_jsonPutc(js, '"');
+}
+
+void NE_jsonKey(struct NE_json *js, const char *key) {
+    NE_jsonValue(js);
+    NE_jsonQuoted(js, key, strlen(key));
+    NE_jsonPutc(js, ':');
+    js->after_key = 1;
+}
+
+void NE_jsonString(struct NE_json *js, const char *str, size_t len) {
+    NE_jsonValue(js);
+    NE_jsonQuoted(js, str, len);
+}
+
+void NE_jsonCString(struct NE_json *js, const char *str) {
+    if (str)
+        NE_jsonString(js, str, strlen(str));
+    else
+        NE_jsonNull(js);
+}
+
+void NE_jsonUInt(struct NE_json *js, uint64_t value) {
+    char digits[20];
+    size_t n = 0;
+
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    NE_jsonValue(js);
+    char *p = NE_jsonReserve(js, n);
+    for (size_t i = 0; i < n; i++)
+        p[i] = digits[n - 1 - i];
+    js->len += n;
+}
+
+void NE_jsonInt(struct NE_json *js, int64_t value) {
+    if (value >= 0) {
+        NE_jsonUInt(js, (uint64_t)value);
+        return;
+    }
+
+    // the minus sign counts as the start of the value
+    NE_jsonValue(js);
+    NE_jsonPutc(js, '-');
+    js->after_key = 1;
+    NE_jsonUInt(js, -(uint64_t)value);
+}
+
+void NE_jsonBool(struct NE_json *js, int value) {
+    NE_jsonValue(js);
+    if (value)
+        NE_jsonPut(js, "true", 4);
+    else
+        NE_jsonPut(js, "false", 5);
+}
+
+void NE_jsonNull(struct NE_json *js) {
+    NE_jsonValue(js);
+    NE_jsonPut(js, "null", 4);
+}
+
+void NE_jsonRaw(struct NE_json *js, const char *text, size_t len) {
+    NE_jsonPut(js, text, len);
+}
+
+void NE_jsonEndLine(struct NE_json *js) {
+    NE_jsonPutc(js, '\n');
+    js->has_items[0] = 0;
+}
+
+void NE_jsonFieldUInt(struct NE_json *js, const char *key, uint64_t value) {
+    NE_jsonKey(js, key);
+    NE_jsonUInt(js, value);
+}
+
+void NE_jsonFieldString(struct NE_json *js, const char *key, const char *str) {
+    NE_jsonKey(js, key);
+    NE_jsonCString(js, str);
+}
+
+void NE_jsonFieldBool(struct NE_json *js, const char *key, int value) {
+    NE_jsonKey(js, key);
+    NE_jsonBool(js, value);
+}
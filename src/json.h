@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Minimal streaming JSON writer. Everything goes through one fixed buffer
+// that is handed to the FILE in large blocks; nothing is allocated per
+// field. Commas and nesting are tracked here, callers only say what comes
+// next.
+//
+#pragma once
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NE_JSON_BUFSIZE   (64 * 1024)
+#define NE_JSON_MAX_DEPTH 32
+
+struct NE_json {
+    FILE *out;
+    int error;              // a write to `out` failed
+    int depth;
+    int after_key;          // the next value belongs to a key, no comma
+    uint8_t has_items[NE_JSON_MAX_DEPTH];
+    size_t len;
+    char buf[NE_JSON_BUFSIZE];
+};
+
+void NE_jsonInit(struct NE_json *js, FILE *out);
+int NE_jsonFlush(struct NE_json *js);
+
+void NE_jsonBeginObject(struct NE_json *js);
+void NE_jsonEndObject(struct NE_json *js);
+void NE_jsonBeginArray(struct NE_json *js);
+void NE_jsonEndArray(struct NE_json *js);
+void NE_jsonKey(struct NE_json *js, const char *key);
+
+// Strings are bytes in the exe's codepage, anything outside ASCII is
+// written as the Latin-1 code point of the byte
+void NE_jsonString(struct NE_json *js, const char *str, size_t len);
+void NE_jsonCString(struct NE_json *js, const char *str); // NULL -> null
+void NE_jsonUInt(struct NE_json *js, uint64_t value);
+void NE_jsonInt(struct NE_json *js, int64_t value);
+void NE_jsonBool(struct NE_json *js, int value);
+void NE_jsonNull(struct NE_json *js);
+
+// Raw text, e.g. the newline ending an NDJSON record
+void NE_jsonRaw(struct NE_json *js, const char *text, size_t len);
+
+// Newline after a top level NDJSON record, so the next one gets no comma
+void NE_jsonEndLine(struct NE_json *js);
+
+// key + value shorthands
+void NE_jsonFieldUInt(struct NE_json *js, const char *key, uint64_t value);
+void NE_jsonFieldString(struct NE_json *js, const char *key, const char *str);
+void NE_jsonFieldBool(struct NE_json *js, const char *key, int value);
@@ -1,35 +1,982 @@
 #include "ne.h"
+#include "batch.h"
+#include "blobstore.h"
+#include "cache.h"
+#include "imgexport.h"
+#include "index.h"
+#include "json.h"
+#include "rsrc.h"
+#include "server.h"
+#include "stats.h"
+#include "watch.h"
+#include "stb_ds.h"
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-int main(int argc, char **argv) {
+// Files at least this big get their tables parsed as separate subtasks
+#define NED_DEFAULT_SPLIT_SIZE (1024 * 1024)
+
+enum ned_format {
+    NED_FORMAT_TEXT,
+    NED_FORMAT_JSON,    // one array of records
+    NED_FORMAT_NDJSON   // one record per line
+};
+
+struct ned_options {
+    int multi;          // more than one file, label each report
+    enum ned_format format;
+    size_t split_size;  // 0 = never split a file
+    struct NE_strpool *pool; // shared by every file, or NULL
+    struct NE_cache *cache;  // parse cache, or NULL
+    int verify_crc;
+    struct NE_indexBuilder *index; // `ned index`: collect instead of print
+    struct NE_indexRecord *records; // `ned watch`: one per batch file
+    struct NE_blobstore *store;    // `ned extract`: store resources, print a manifest
+    struct NE_imgExport *images;   // `ned extract --images`: also write image files
+};
+
+struct ned_tableTask {
+    const struct NE_table *table;
+    struct NE_exe exe;  // private copy, only table->field is taken back
+    struct NE_arena arena;
+    int ret;
+};
+
+static void usage(void) {
+    fprintf(
+        stderr,
+        "ned [options] [exe file or directory]...\n"
+        "ned index -o INDEX [options] [exe file or directory]...\n"
+        "ned extract -o DIR [options] [exe file or directory]...\n"
+        "ned watch [-o INDEX] [options] [exe file or directory]...\n"
+        "ned [extract -o DIR] --server[=SOCKET] [options]\n"
+        "ned query INDEX [filters]   (see ned query -h)\n"
+        "\n"
+        "  -j, --jobs N          worker threads (default: one per core)\n"
+        "      --split-size N    parse the tables of files >= N bytes in parallel (0 = off)\n"
+        "      --sched-stats     print per-worker scheduler counters to stderr\n"
+        "      --io-depth N      read up to N files ahead of the parser (0 = off)\n"
+        "      --io-backend B    auto, uring (io_uring) or threads (blocking pread)\n"
+        "      --stats[=json]    print per-phase time, bytes, syscalls and allocations\n"
+        "                        to stderr, as a table or as JSON\n"
+        "      --shared-strings  intern names in one pool for the whole batch\n"
+        "      --cache DIR       reuse parsed tables of unchanged files from DIR\n"
+        "      --cache-verify    also check the content hash of cached files\n"
+        "      --verify-crc      check each file against its FileLoadCRC\n"
+        "      --json            print a JSON array with one record per file\n"
+        "      --ndjson          print one JSON record per line\n"
+        "      --server[=SOCKET] answer requests for files read from stdin, or from\n"
+        "                        clients of the Unix socket SOCKET\n"
+        "  -o, --output PATH     index file written by `ned index` or kept up to\n"
+        "                        date by `ned watch`, blob directory of `ned extract`\n"
+        "      --images          `ned extract`: also write bitmaps, icons and cursors\n"
+        "                        as PNG, icon and cursor groups as .ico and .cur\n"
+    );
+}
+
+static void ned_queryUsage(void) {
+    fprintf(
+        stderr,
+        "ned query INDEX [filters]\n"
+        "      --os N            target OS number (2 = Windows)\n"
+        "      --winver X.Y      expected Windows version\n"
+        "      --linker X.Y      linker version\n"
+        "      --imports MODULE  imports MODULE (repeatable, all must match)\n"
+        "      --calls MOD!PROC  imports PROC from MOD, by name or as MOD!#ORDINAL\n"
+        "                        (repeatable, all must match)\n"
+        "      --rsrc TYPE       has resources of TYPE, a number or a name (repeatable)\n"
+        "      --flags MASK      all bits of MASK set in the flag word\n"
+        "      --min-segs N      at least N segments\n"
+        "  -c, --count           print the number of matches only\n"
+    );
+}
+
+static void ned_readTableTask(void *arg) {
+    struct ned_tableTask *task = arg;
+    task->ret = NE_readTable((size_t)(task->table - NE_tables), &task->exe);
+}
+
+// Run every table parser as its own subtask so idle workers can pick them
+// up, then fold the results back into `exe`.
+static int ned_readTablesSplit(struct NE_batchJob *job, struct NE_exe *exe) {
+    struct ned_tableTask *tasks = calloc(NE_tableCount, sizeof(*tasks));
+    int ret = 0;
+
+    if (!tasks)
+        return NE_readTables(exe);
+
+    // every table interns into the same pool. A shared pool is locked
+    // already and other files are using it, leave it alone then.
+    int was_locked = exe->pool->locked;
+    if (!was_locked)
+        NE_strpoolSetLocked(exe->pool, 1);
+
+    // copy `exe` for every task before any of them starts writing to it
+    // (its own pool lives inside it)
+    for (size_t i = 0; i < NE_tableCount; i++) {
+        tasks[i].table = &NE_tables[i];
+        tasks[i].exe = *exe;
+
+        // the parent's arena isn't thread safe, each table gets its own
+        NE_arenaInit(&tasks[i].arena, 0);
+        tasks[i].exe.arena = &tasks[i].arena;
+    }
+
+    for (size_t i = 0; i < NE_tableCount; i++)
+        NE_batchSpawn(job, ned_readTableTask, &tasks[i]);
+
+    NE_batchJoin(job);
+    if (!was_locked)
+        NE_strpoolSetLocked(exe->pool, 0);
+
+    for (size_t i = 0; i < NE_tableCount; i++) {
+        const struct NE_table *table = tasks[i].table;
+        memcpy(
+            (char *)exe + table->field,
+            (char *)&tasks[i].exe + table->field,
+            table->size
+        );
+        NE_arenaAdopt(exe->arena, &tasks[i].arena);
+
+        if (tasks[i].ret < 0 && ret == 0) {
+            NE_setError(exe, tasks[i].exe.status, tasks[i].exe.error);
+            ret = -1;
+        }
+    }
+
+    free(tasks);
+    return ret;
+}
+
+// Returns -1 if the CRC is stored and doesn't match
+static int ned_checkCRC(struct NE_exe *exe, uint32_t *crc) {
+    if (NE_verifyCRC(exe, crc) == 0 || exe->header.FileLoadCRC == 0)
+        return 0;
+
+    return -1;
+}
+
+static int ned_reportText(
+    const struct ned_options *opts,
+    struct NE_exe *exe,
+    const char *path,
+    FILE *out,
+    FILE *err
+) {
+    int ret = 0;
+
+    if (opts->multi)
+        fprintf(out, "%s:\n", path);
+
+    NE_fprintInfo(out, exe);
+
+    if (opts->verify_crc) {
+        uint32_t crc;
+
+        if (ned_checkCRC(exe, &crc) < 0) {
+            fprintf(out, "CRC: 0x%08x, header says 0x%08x\n", crc, exe->header.FileLoadCRC);
+            fprintf(err, "ned: %s: %s\n", path, exe->error);
+            ret = -1;
+        } else if (exe->header.FileLoadCRC == 0) {
+            // most linkers never filled it in
+            fprintf(out, "CRC: not stored (0x%08x)\n", crc);
+        } else {
+            fprintf(out, "CRC: 0x%08x ok\n", crc);
+        }
+    }
+
+    return ret;
+}
+
+// One record per file. Files that fail still get a record, with just
+// their path and the error.
+static int ned_reportJson(
+    const struct ned_options *opts,
+    struct NE_exe *exe,
+    const char *path,
+    const char *error,
+    FILE *out,
+    FILE *err
+) {
+    struct NE_json *js = malloc(sizeof(*js));
+    int ret = 0;
+
+    if (!js) {
+        fprintf(err, "ned: %s: Failed to alloc JSON writer\n", path);
+        return -1;
+    }
+
+    NE_jsonInit(js, out);
+    NE_jsonBeginObject(js);
+    NE_jsonFieldString(js, "path", path);
+
+    if (error) {
+        NE_jsonFieldString(js, "error", error);
+    } else {
+        NE_jsonInfo(js, exe);
+
+        if (opts->verify_crc) {
+            uint32_t crc;
+
+            ret = ned_checkCRC(exe, &crc);
+            if (ret < 0)
+                fprintf(err, "ned: %s: %s\n", path, exe->error);
+
+            NE_jsonFieldUInt(js, "crc_computed", crc);
+            NE_jsonKey(js, "crc_ok");
+            if (exe->header.FileLoadCRC == 0)
+                NE_jsonNull(js);
+            else
+                NE_jsonBool(js, ret == 0);
+        }
+    }
+
+    NE_jsonEndObject(js);
+
+    // NDJSON ends every record with a newline, a JSON array gets its
+    // separators from the batch
+    if (opts->format == NED_FORMAT_NDJSON)
+        NE_jsonRaw(js, "\n", 1);
+
+    NE_jsonFlush(js);
+    free(js);
+    return ret;
+}
+
+// Store every resource of the file and print one manifest record per
+// resource, naming the blob holding its bytes
+static int ned_extractFile(
+    const struct ned_options *opts,
+    struct NE_batchJob *job,
+    struct NE_exe *exe,
+    const char *path,
+    FILE *out,
+    FILE *err
+) {
+    struct NE_json *js = malloc(sizeof(*js));
+    int ret = 0;
+
+    if (!js) {
+        fprintf(err, "ned: %s: Failed to alloc JSON writer\n", path);
+        return -1;
+    }
+
+    NE_jsonInit(js, out);
+
+    struct NE_imgExportFile *images = NULL;
+    if (opts->images && !(images = NE_imgExportBegin(job, path))) {
+        fprintf(err, "ned: %s: Failed to alloc image export\n", path);
+        free(js);
+        return -1;
+    }
+
+    struct NE_rsrc r = {0};
+
+    // only the resource table is walked, each resource's bytes are read
+    // when it's stored
+    while (NE_rsrcNext(exe, &r)) {
+        const NE_ResType *res_type = r.type;
+        const struct NE_ResNameInfo *info = r.info;
+        char hex[17];
+        uint64_t hash;
+        size_t size;
+
+        const uint8_t *data = NE_rsrcData(exe, &r, &size);
+        if (!data) {
+            fprintf(err, "ned: %s: Resource data runs past the end of the file\n", path);
+            ret = -1;
+            continue;
+        }
+
+        if (NE_blobstorePut(opts->store, data, size, &hash) < 0) {
+            fprintf(err, "ned: %s: Failed to store resource: %s\n", path, strerror(errno));
+            ret = -1;
+            continue;
+        }
+
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+
+        NE_jsonBeginObject(js);
+        NE_jsonFieldString(js, "path", path);
+
+        if (res_type->TypeID & NE_RSRC_INTEGER_ID) {
+            uint16_t type = res_type->TypeID & ~NE_RSRC_INTEGER_ID;
+            NE_jsonFieldUInt(js, "type", type);
+            NE_jsonFieldString(js, "type_name", NE_detectRsrcID(type));
+        } else {
+            NE_jsonFieldString(js, "type_name", NE_getRsrcName(exe, res_type->TypeID));
+        }
+
+        if (info->ID & NE_RSRC_INTEGER_ID)
+            NE_jsonFieldUInt(js, "id", info->ID & ~NE_RSRC_INTEGER_ID);
+        else
+            NE_jsonFieldString(js, "name", NE_getRsrcName(exe, info->ID));
+
+        NE_jsonFieldString(js, "hash", hex);
+        NE_jsonFieldUInt(js, "size", size);
+
+        // the name is known before the file is written, the encoders and
+        // the writer catch up in the background
+        if (opts->images) {
+            char image[64];
+            const char *image_error;
+
+            int found = NE_imgExportRsrc(opts->images, images, exe, &r, data, size, image, sizeof(image), &image_error);
+            if (found > 0)
+                NE_jsonFieldString(js, "image", image);
+            else if (found < 0)
+                NE_jsonFieldString(js, "image_error", image_error);
+        }
+
+        NE_jsonEndObject(js);
+        NE_jsonEndLine(js);
+    }
+
+    if (images)
+        NE_imgExportEnd(opts->images, images);
+
+    NE_jsonFlush(js);
+    free(js);
+    return ret;
+}
+
+static int ned_scanFile(
+    struct NE_batchJob *job,
+    const char *path,
+    FILE *out,
+    FILE *err,
+    void *ctx
+) {
+    struct ned_options *opts = ctx;
     struct NE_exe exe = {0};
-    if (argc < 2) {
-        fprintf(stderr, "ned [exe file]\n");
-        return 1;
+    struct NE_ingestFile file;
+    uint64_t file_start = NE_statsBegin();
+    uint64_t start;
+    long out_pos = 0;
+    FILE *fp = NULL;
+    int read_ret;
+    int fd;
+    int ret = 0;
+
+    exe.arena = NE_batchArena(job);
+    exe.pool = opts->pool;
+
+    // already read by the loader, see --io-depth
+    if (NE_batchTakeFile(job, &file)) {
+        struct NE_reader rd;
+        NE_readerAdopt(&rd, file.data, file.size);
+
+        fd = file.fd;
+        read_ret = NE_openExeReader(&exe, &rd);
+    } else {
+        start = NE_statsBegin();
+        fp = fopen(path, "rb");
+        NE_statsEnd(NE_PHASE_IO, start, 0, 1, 0);
+
+        if (!fp) {
+            fprintf(err, "ned: %s: Failed open exe file: %s\n", path, strerror(errno));
+            if (opts->index)
+                NE_indexBuilderAdd(opts->index, NE_batchIndex(job), path, NULL);
+            else if (opts->records)
+                NE_indexRecordFill(&opts->records[NE_batchIndex(job)], path, NULL);
+            else if (opts->format != NED_FORMAT_TEXT)
+                ned_reportJson(opts, NULL, path, strerror(errno), out, err);
+            NE_statsEnd(NE_PHASE_FILE, file_start, 0, 0, 0);
+            return -1;
+        }
+
+        fd = fileno(fp);
+        read_ret = NE_openExe(fp, &exe);
     }
 
-    FILE *fp = fopen(argv[1], "rb");
-    if (!fp) {
-        perror("Failed open exe file");
-        return 1;
+    int cached = 0;
+
+    // data sent to --server has no file to key the cache with
+    if (read_ret == 0 && opts->cache && fd >= 0) {
+        start = NE_statsBegin();
+        cached = NE_cacheLoad(opts->cache, fd, &exe);
+        NE_statsEnd(NE_PHASE_CACHE, start, 0, 0, 0);
     }
 
-    if (NE_readFile(fp, &exe) < 0) {
+    if (read_ret == 0 && !cached) {
+        if (opts->split_size && exe.reader.size >= opts->split_size)
+            read_ret = ned_readTablesSplit(job, &exe);
+        else
+            read_ret = NE_readTables(&exe);
+
+        // a file that can't be cached is still fine to report
+        if (read_ret == 0 && opts->cache && fd >= 0) {
+            start = NE_statsBegin();
+            if (NE_cacheStore(opts->cache, fd, &exe) < 0)
+                fprintf(err, "ned: %s: %s\n", path, exe.error);
+            NE_statsEnd(NE_PHASE_CACHE, start, 0, 0, 0);
+        }
+    }
+
+    // everything from here on is output of some kind
+    start = NE_statsBegin();
+    if (start)
+        out_pos = ftell(out);
+
+    if (opts->index) {
+        // failed files still get their id, just without any columns set
+        if (NE_indexBuilderAdd(opts->index, NE_batchIndex(job), path, read_ret < 0 ? NULL : &exe) < 0)
+            fprintf(err, "ned: %s: Failed to add file to the index\n", path);
+    } else if (opts->records) {
+        NE_indexRecordFill(&opts->records[NE_batchIndex(job)], path, read_ret < 0 ? NULL : &exe);
+    }
+
+    if (read_ret < 0) {
         fprintf(
-            stderr,
-            "ned: Failed to read file: %s\n",
+            err,
+            "ned: %s: Failed to read file: %s\n",
+            path,
             exe.error
         );
 
-        goto exit_prog;
+        if (opts->format != NED_FORMAT_TEXT)
+            ned_reportJson(opts, &exe, path, exe.error, out, err);
+
+        ret = -1;
+        goto exit_scan;
+    }
+
+    if (opts->index || opts->records)
+        ret = 0;
+    else if (opts->store)
+        ret = ned_extractFile(opts, job, &exe, path, out, err);
+    else if (opts->format == NED_FORMAT_TEXT)
+        ret = ned_reportText(opts, &exe, path, out, err);
+    else
+        ret = ned_reportJson(opts, &exe, path, NULL, out, err);
+
+exit_scan:
+    if (start) {
+        long end_pos = ftell(out);
+        NE_statsEnd(NE_PHASE_OUTPUT, start, end_pos > out_pos ? (uint64_t)(end_pos - out_pos) : 0, 0, 0);
     }
 
-    NE_printInfo(exe);
-exit_prog:
+    size_t size = exe.reader.size;
     NE_freeExe(&exe);
 
+    start = NE_statsBegin();
     if (fp)
         fclose(fp);
+    else if (fd >= 0)
+        close(fd);
+    NE_statsEnd(NE_PHASE_IO, start, 0, 1, 0);
+
+    NE_statsEnd(NE_PHASE_FILE, file_start, size, 0, 0);
+    return ret;
+}
+
+// "3.10" -> 0x030A
+static int ned_parseVersion(const char *str) {
+    char *end;
+    unsigned long major = strtoul(str, &end, 10);
+    unsigned long minor = 0;
+
+    if (*end == '.')
+        minor = strtoul(end + 1, &end, 10);
+
+    if (*end != '\0' || major > 0xFF || minor > 0xFF)
+        return -1;
+
+    return (int)(major << 8 | minor);
+}
+
+static int ned_query(int argc, char **argv) {
+    struct NE_indexFilter filter;
+    const char **modules = NULL;    // stb_ds arrays
+    const char **procs = NULL;
+    char **rsrc = NULL;
+    int count_only = 0;
+    int ret = 1;
+    int opt;
+
+    enum {
+        OPT_OS = 0x100,
+        OPT_WINVER,
+        OPT_LINKER,
+        OPT_IMPORTS,
+        OPT_CALLS,
+        OPT_RSRC,
+        OPT_FLAGS,
+        OPT_MIN_SEGS
+    };
+
+    static const struct option long_opts[] = {
+        { "os",       required_argument, NULL, OPT_OS },
+        { "winver",   required_argument, NULL, OPT_WINVER },
+        { "linker",   required_argument, NULL, OPT_LINKER },
+        { "imports",  required_argument, NULL, OPT_IMPORTS },
+        { "calls",    required_argument, NULL, OPT_CALLS },
+        { "rsrc",     required_argument, NULL, OPT_RSRC },
+        { "flags",    required_argument, NULL, OPT_FLAGS },
+        { "min-segs", required_argument, NULL, OPT_MIN_SEGS },
+        { "count",    no_argument,       NULL, 'c' },
+        { "help",     no_argument,       NULL, 'h' },
+        { 0 }
+    };
+
+    NE_indexFilterInit(&filter);
+
+    while ((opt = getopt_long(argc, argv, "ch", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case OPT_OS:
+                filter.target_os = atoi(optarg);
+                break;
+            case OPT_WINVER:
+            case OPT_LINKER: {
+                int version = ned_parseVersion(optarg);
+                if (version < 0) {
+                    fprintf(stderr, "ned: Bad version: %s\n", optarg);
+                    goto exit_query;
+                }
+                if (opt == OPT_WINVER)
+                    filter.winver = version;
+                else
+                    filter.linker = version;
+                break;
+            }
+            case OPT_IMPORTS:
+                arrput(modules, optarg);
+                break;
+            case OPT_CALLS:
+                if (!strchr(optarg, '!')) {
+                    fprintf(stderr, "ned: Expected MODULE!PROC: %s\n", optarg);
+                    goto exit_query;
+                }
+                arrput(procs, optarg);
+                break;
+            case OPT_RSRC: {
+                // integer types are stored as "#N"
+                char *end;
+                unsigned long type = strtoul(optarg, &end, 0);
+                char *key;
+
+                if (*optarg && *end == '\0') {
+                    key = malloc(16);
+                    if (key)
+                        snprintf(key, 16, "#%lu", type & 0x7FFF);
+                } else {
+                    key = strdup(optarg);
+                }
+
+                if (!key)
+                    goto exit_query;
+                arrput(rsrc, key);
+                break;
+            }
+            case OPT_FLAGS:
+                filter.flags_mask = (uint16_t)strtoul(optarg, NULL, 0);
+                filter.flags_value = filter.flags_mask;
+                break;
+            case OPT_MIN_SEGS:
+                filter.min_segs = atoi(optarg);
+                break;
+            case 'c':
+                count_only = 1;
+                break;
+            case 'h':
+            default:
+                ned_queryUsage();
+                goto exit_query;
+        }
+    }
+
+    if (optind != argc - 1) {
+        ned_queryUsage();
+        goto exit_query;
+    }
+
+    filter.modules = modules;
+    filter.module_count = arrlen(modules);
+    filter.rsrc_types = (const char **)rsrc;
+    filter.rsrc_count = arrlen(rsrc);
+    filter.procs = procs;
+    filter.proc_count = arrlen(procs);
+
+    struct NE_index idx;
+    if (NE_indexOpen(&idx, argv[optind]) < 0) {
+        fprintf(stderr, "ned: %s: %s\n", argv[optind], idx.error);
+        goto exit_query;
+    }
+
+    uint64_t *result = calloc(idx.bitmap_words ? idx.bitmap_words : 1, sizeof(uint64_t));
+    if (!result) {
+        NE_indexClose(&idx);
+        goto exit_query;
+    }
+
+    size_t matches = NE_indexQuery(&idx, &filter, result);
+
+    if (count_only) {
+        printf("%zu\n", matches);
+    } else {
+        for (size_t w = 0; w < idx.bitmap_words; w++) {
+            for (uint64_t bits = result[w]; bits; bits &= bits - 1)
+                printf("%s\n", NE_indexPath(&idx, w * 64 + (size_t)__builtin_ctzll(bits)));
+        }
+    }
+
+    free(result);
+    NE_indexClose(&idx);
+    ret = matches == 0;
+
+exit_query:
+    for (ptrdiff_t i = 0; i < arrlen(rsrc); i++)
+        free(rsrc[i]);
+    arrfree(rsrc);
+    arrfree(modules);
+    arrfree(procs);
+    return ret;
+}
+
+// Set by SIGINT/SIGTERM in the modes that run until they're stopped
+static volatile sig_atomic_t ned_stop;
+
+static void ned_stopSignal(int sig) {
+    (void)sig;
+    ned_stop = 1;
+}
+
+// no SA_RESTART: the signal has to interrupt whatever is being waited for
+static void ned_catchStop(void) {
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = ned_stopSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+// `ned watch` parses its batches into index records, see NE_watch
+static void ned_watchParse(struct NE_batch *batch, struct NE_indexRecord *records, void *ctx) {
+    struct ned_options *opts = ctx;
+
+    opts->records = records;
+    NE_runBatch(batch, ned_scanFile, opts);
+    opts->records = NULL;
+}
+
+int main(int argc, char **argv) {
+    struct ned_options opts = {0};
+    struct NE_batch batch = {0};
+    struct NE_strpool shared_pool;
+    struct NE_cache cache = {0};
+    struct NE_indexBuilder index;
+    struct NE_blobstore store;
+    struct NE_imgExport images;
+    int export_images = 0;
+    const char *output = NULL;
+    const char *mode = NULL;    // "index", "extract", "watch" or NULL for reports
+    const char *socket_path = NULL;
+    int server = 0;
+    int sched_stats = 0;
+    int stats = 0;      // 1 = table, 2 = JSON
+    int shared_strings = 0;
+    int opt;
+
+    if (argc > 1 && strcmp(argv[1], "query") == 0)
+        return ned_query(argc - 1, argv + 1);
+
+    if (argc > 1 && (strcmp(argv[1], "index") == 0 || strcmp(argv[1], "extract") == 0 ||
+                     strcmp(argv[1], "watch") == 0)) {
+        mode = argv[1];
+        argc--;
+        argv++;
+    }
+
+    enum {
+        OPT_SPLIT_SIZE = 0x100,
+        OPT_SCHED_STATS,
+        OPT_STATS,
+        OPT_IO_DEPTH,
+        OPT_IO_BACKEND,
+        OPT_SHARED_STRINGS,
+        OPT_CACHE,
+        OPT_CACHE_VERIFY,
+        OPT_VERIFY_CRC,
+        OPT_JSON,
+        OPT_NDJSON,
+        OPT_SERVER,
+        OPT_IMAGES
+    };
+
+    static const struct option long_opts[] = {
+        { "jobs",        required_argument, NULL, 'j' },
+        { "split-size",  required_argument, NULL, OPT_SPLIT_SIZE },
+        { "sched-stats", no_argument,       NULL, OPT_SCHED_STATS },
+        { "stats",       optional_argument, NULL, OPT_STATS },
+        { "io-depth",    required_argument, NULL, OPT_IO_DEPTH },
+        { "io-backend",  required_argument, NULL, OPT_IO_BACKEND },
+        { "shared-strings", no_argument,    NULL, OPT_SHARED_STRINGS },
+        { "cache",       required_argument, NULL, OPT_CACHE },
+        { "cache-verify", no_argument,      NULL, OPT_CACHE_VERIFY },
+        { "verify-crc",  no_argument,       NULL, OPT_VERIFY_CRC },
+        { "json",        no_argument,       NULL, OPT_JSON },
+        { "ndjson",      no_argument,       NULL, OPT_NDJSON },
+        { "server",      optional_argument, NULL, OPT_SERVER },
+        { "images",      no_argument,       NULL, OPT_IMAGES },
+        { "output",      required_argument, NULL, 'o' },
+        { "help",        no_argument,       NULL, 'h' },
+        { 0 }
+    };
+
+    opts.split_size = NED_DEFAULT_SPLIT_SIZE;
+
+    while ((opt = getopt_long(argc, argv, "j:o:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'j':
+                batch.threads = atoi(optarg);
+                break;
+            case OPT_SPLIT_SIZE:
+                opts.split_size = strtoull(optarg, NULL, 0);
+                break;
+            case OPT_SCHED_STATS:
+                sched_stats = 1;
+                break;
+            case OPT_STATS:
+                if (optarg && strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "ned: --stats: unknown format '%s'\n", optarg);
+                    return 1;
+                }
+                stats = optarg ? 2 : 1;
+                break;
+            case OPT_IO_DEPTH:
+                batch.io_depth = atoi(optarg);
+                break;
+            case OPT_IO_BACKEND:
+                if (strcmp(optarg, "auto") == 0) {
+                    batch.io_backend = NE_INGEST_AUTO;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    batch.io_backend = NE_INGEST_URING;
+                } else if (strcmp(optarg, "threads") == 0) {
+                    batch.io_backend = NE_INGEST_THREADS;
+                } else {
+                    fprintf(stderr, "ned: --io-backend: unknown backend '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_SHARED_STRINGS:
+                shared_strings = 1;
+                break;
+            case OPT_CACHE:
+                cache.dir = optarg;
+                opts.cache = &cache;
+                break;
+            case OPT_CACHE_VERIFY:
+                cache.verify = 1;
+                break;
+            case OPT_VERIFY_CRC:
+                opts.verify_crc = 1;
+                break;
+            case OPT_JSON:
+                opts.format = NED_FORMAT_JSON;
+                break;
+            case OPT_NDJSON:
+                opts.format = NED_FORMAT_NDJSON;
+                break;
+            case OPT_SERVER:
+                server = 1;
+                socket_path = optarg;
+                break;
+            case OPT_IMAGES:
+                export_images = 1;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'h':
+            default:
+                usage();
+                return 1;
+        }
+    }
+
+    int watching = mode && strcmp(mode, "watch") == 0;
+
+    // the index of `ned watch` is optional, it can just stream events
+    int bad_args = !watching && (mode != NULL) != (output != NULL);
+    bad_args |= export_images && !(mode && strcmp(mode, "extract") == 0);
+
+    // a server gets its files from its clients, as reports or extracted
+    if (server)
+        bad_args |= optind < argc || (mode && strcmp(mode, "extract") != 0);
+    else
+        bad_args |= optind >= argc;
+
+    if (bad_args) {
+        usage();
+        return 1;
+    }
+
+    // a path that can't be read fails the run, the others are still scanned
+    int bad_paths = 0;
+    for (int i = optind; !watching && i < argc; i++) {
+        if (NE_batchAddPath(&batch, argv[i]) < 0)
+            bad_paths++;
+    }
+
+    if (watching) {
+        opts.format = NED_FORMAT_TEXT;
+    } else if (mode && strcmp(mode, "index") == 0) {
+        if (NE_indexBuilderInit(&index, arrlen(batch.paths)) < 0) {
+            fprintf(stderr, "ned: Failed to alloc index\n");
+            NE_freeBatch(&batch);
+            return 1;
+        }
+        opts.index = &index;
+        opts.format = NED_FORMAT_TEXT;
+    } else if (mode) {
+        if (NE_blobstoreInit(&store, output) < 0) {
+            fprintf(stderr, "ned: %s: Failed to create blob dir: %s\n", output, strerror(errno));
+            NE_freeBatch(&batch);
+            return 1;
+        }
+        opts.store = &store;
+        opts.format = NED_FORMAT_NDJSON;    // the manifest
+
+        // one encoder per worker, with a few images of slack each
+        size_t encoders = batch.threads > 0 ? (size_t)batch.threads : (size_t)NE_batchCPUCount();
+        if (export_images && NE_imgExportStart(&images, &store, encoders, encoders * 4) < 0) {
+            fprintf(stderr, "ned: Failed to start image export: %s\n", strerror(errno));
+            NE_blobstoreFree(&store);
+            NE_freeBatch(&batch);
+            return 1;
+        }
+        if (export_images)
+            opts.images = &images;
+    }
+
+    opts.multi = arrlen(batch.paths) > 1 || argc - optind > 1;
+
+    if (opts.cache && mkdir(cache.dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "ned: %s: Failed to create cache dir: %s\n", cache.dir, strerror(errno));
+        NE_freeBatch(&batch);
+        return 1;
+    }
+
+    if (shared_strings) {
+        if (NE_strpoolInitShared(&shared_pool) < 0) {
+            fprintf(stderr, "ned: Failed to alloc string pool\n");
+            NE_freeBatch(&batch);
+            return 1;
+        }
+        opts.pool = &shared_pool;
+    }
+
+    if (stats)
+        NE_statsEnable();
+
+    // every answer is a record of its own
+    if (server && opts.format == NED_FORMAT_JSON)
+        opts.format = NED_FORMAT_NDJSON;
+
+    if (opts.format == NED_FORMAT_JSON) {
+        batch.separator = ",\n";
+        fputs("[\n", stdout);
+    }
+
+    int failed;
+    if (server) {
+        if (socket_path)
+            ned_catchStop();
+        failed = NE_serve(&batch, ned_scanFile, &opts, socket_path, &ned_stop) < 0;
+    } else if (watching) {
+        ned_catchStop();
+        failed = NE_watch(&batch, argv + optind, argc - optind, output, ned_watchParse, &opts, &ned_stop) < 0;
+    } else {
+        failed = NE_runBatch(&batch, ned_scanFile, &opts);
+    }
+
+    if (opts.format == NED_FORMAT_JSON)
+        fputs("\n]\n", stdout);
+
+    if (opts.index) {
+        if (NE_indexBuilderWrite(opts.index, output) < 0) {
+            fprintf(stderr, "ned: %s: Failed to write index: %s\n", output, strerror(errno));
+            failed++;
+        }
+        NE_indexBuilderFree(opts.index);
+    }
+
+    if (opts.images) {
+        NE_imgExportStop(opts.images);
+        fprintf(
+            stderr,
+            "ned: %llu images, %llu files written, %llu already stored, %llu failed\n",
+            (unsigned long long)images.images,
+            (unsigned long long)images.written,
+            (unsigned long long)images.existing,
+            (unsigned long long)images.failed
+        );
+    }
+
+    if (opts.store) {
+        fprintf(
+            stderr,
+            "ned: %llu resources, %llu blobs written (%llu bytes), %llu already stored (%llu bytes)\n",
+            (unsigned long long)store.total,
+            (unsigned long long)store.stored,
+            (unsigned long long)store.stored_bytes,
+            (unsigned long long)store.dupes,
+            (unsigned long long)store.dupe_bytes
+        );
+        NE_blobstoreFree(opts.store);
+    }
+
+    if (sched_stats)
+        NE_printBatchStats(&batch, stderr);
+
+    if (stats == 1) {
+        NE_statsPrint(stderr);
+        if (opts.cache) {
+            fprintf(
+                stderr,
+                "cache: %llu hits, %llu misses, %llu stored\n",
+                (unsigned long long)cache.hits,
+                (unsigned long long)cache.misses,
+                (unsigned long long)cache.stores
+            );
+        }
+    } else if (stats == 2) {
+        struct NE_json *js = malloc(sizeof(*js));
+        if (js) {
+            NE_jsonInit(js, stderr);
+            NE_statsJson(js);
+            NE_jsonEndLine(js);
+
+            // a line of its own, the phases object stays as it was
+            if (opts.cache) {
+                NE_jsonBeginObject(js);
+                NE_jsonKey(js, "cache");
+                NE_jsonBeginObject(js);
+                NE_jsonFieldUInt(js, "hits", cache.hits);
+                NE_jsonFieldUInt(js, "misses", cache.misses);
+                NE_jsonFieldUInt(js, "stores", cache.stores);
+                NE_jsonEndObject(js);
+                NE_jsonEndObject(js);
+                NE_jsonEndLine(js);
+            }
+
+            NE_jsonFlush(js);
+            free(js);
+        }
+    }
+    NE_statsFree();
+
+    if (opts.pool)
+        NE_strpoolFree(opts.pool);
+    NE_freeBatch(&batch);
 
-    return 0;
+    return failed != 0 || bad_paths != 0;
 }
@@ -10,6 +10,11 @@
  */
 
 #include "ne.h"
+#include "crc32.h"
+#include "json.h"
+#include "reloc.h"
+#include "stats.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -20,168 +25,459 @@
 
 #define NE_PTR_OFFSET 0x3c
 
-int NE_readHeader(FILE *fp, struct NE_exe *exe) {
-    char mz_header[2];
+static int NE_parseHeader(const struct NE_reader *rd, struct NE_exe *exe) {
     exe->ready = 0;
-    exe->error = "Unknown";
+    NE_setError(exe, NE_ERR_UNKNOWN, "Unknown");
 
-    if (!fp) {
-        exe->error = "File pointer is NULL";
+    if (!rd->data) {
+        NE_setError(exe, NE_ERR_IO, "File is not loaded");
         return -1;
     }
 
-    fread(mz_header, 2, 1, fp);
-
-    if (memcmp("MZ", mz_header, 2) != 0) {
-        exe->error = "Not an EXE file. (must have MZ Header)";
+    const uint8_t *mz_header = NE_readerView(rd, 0, 2);
+    if (!mz_header || memcmp("MZ", mz_header, 2) != 0) {
+        NE_setError(exe, NE_ERR_NOT_MZ, "Not an EXE file. (must have MZ Header)");
         return -1;
     }
 
     // get pointer for NE header
-    uint16_t ne_ptr = 0;
-    if (fseek(fp, NE_PTR_OFFSET, SEEK_SET) != 0) {
-        exe->error = "Failed to seek to NE pointer offset";
+    const uint8_t *ne_ptr = NE_readerView(rd, NE_PTR_OFFSET, 4);
+    if (!ne_ptr) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Failed to read NE pointer offset");
         return -1;
     }
 
-    if (fread(&ne_ptr, 2, 1, fp) < 1) {
-        exe->error = "Failed to read NE pointer offset";
-        return -1;
-    }
+    exe->HeaderOffset = NE_getU32(ne_ptr);
 
     // now get the NE header
-    if (fseek(fp, ne_ptr, SEEK_SET) != 0) {
-        exe->error = "Failed to seek to NE header";
-        return -1;
-    }
+    const uint8_t *header = NE_readerView(
+        rd,
+        exe->HeaderOffset,
+        sizeof(struct NE_header)
+    );
 
-    if (fread(&exe->header, sizeof(struct NE_header), 1, fp) < 1)  {
-        exe->error = "Failed to read NE header";
+    if (!header) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Failed to read NE header");
         return -1;
     }
 
+    memcpy(&exe->header, header, sizeof(struct NE_header));
+
     if (memcmp("NE", exe->header.sig, 2) != 0) {
-        exe->error = "Not a New Executable formatted exe file";
+        NE_setError(exe, NE_ERR_NOT_NE, "Not a New Executable formatted exe file");
         return -1;
     }
 
     exe->ready = 1;
-    exe->error = "Success";
+    NE_setError(exe, NE_OK, "Success");
     return 0;
 }
 
-int NE_readRsrcTable(FILE *fp, struct NE_exe *exe) {
-    if (!exe->ready) {
-        exe->error = "Exe struct isn't setup/ready yet";
+int NE_readHeader(const struct NE_reader *rd, struct NE_exe *exe) {
+    uint64_t start = NE_statsBegin();
+    int ret = NE_parseHeader(rd, exe);
+
+    NE_statsEnd(NE_PHASE_HEADER, start, sizeof(struct NE_header), 0, 0);
+    return ret;
+}
+
+#define NE_TYPEINFO_SIZE 8
+#define NE_NAMEINFO_SIZE 12
+
+// Walk just the TYPEINFO headers, jumping over the NAMEINFO arrays, so the
+// real pass can allocate everything at its final size. Returns the offset
+// just past the terminating zero type ID.
+static int NE_sizeRsrcTable(
+    const struct NE_reader *rd,
+    size_t ofs,
+    size_t *type_count,
+    size_t *name_count,
+    size_t *end
+) {
+    *type_count = 0;
+    *name_count = 0;
+
+    while (1) {
+        const uint8_t *p = NE_readerView(rd, ofs, 2);
+        if (!p)
+            return -1;
+
+        if (NE_getU16(p) == rt_terminator)
+            break;
+
+        p = NE_readerView(rd, ofs, NE_TYPEINFO_SIZE);
+        if (!p)
+            return -1;
+
+        uint16_t count = NE_getU16(p + 2);
+        ofs += NE_TYPEINFO_SIZE + (size_t)count * NE_NAMEINFO_SIZE;
+
+        (*type_count)++;
+        *name_count += count;
+    }
+
+    *end = ofs + 2;
+    return 0;
+}
+
+static void NE_decodeNameInfo(struct NE_ResNameInfo *dst, const uint8_t *src, size_t count) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // the packed struct is the on-disk record
+    memcpy(dst, src, count * NE_NAMEINFO_SIZE);
+#else
+    for (size_t i = 0; i < count; i++, src += NE_NAMEINFO_SIZE) {
+        dst[i].Offset = NE_getU16(src);
+        dst[i].Length = NE_getU16(src + 2);
+        dst[i].Flags  = NE_getU16(src + 4);
+        dst[i].ID     = NE_getU16(src + 6);
+        dst[i].Handle = NE_getU16(src + 8);
+        dst[i].Usage  = NE_getU16(src + 10);
+    }
+#endif
+}
+
+// Trailing length-prefixed strings, ended by a zero length or the end of
+// the table, interned into the exe's pool
+static int NE_readRsrcNames(
+    const struct NE_reader *rd,
+    struct NE_exe *exe,
+    size_t table_start,
+    size_t ofs,
+    size_t table_end
+) {
+    size_t count = 0;
+
+    for (size_t pos = ofs; pos < table_end; ) {
+        const uint8_t *len = NE_readerView(rd, pos, 1);
+        if (!len || *len == 0)
+            break;
+        if (!NE_readerView(rd, pos + 1, *len))
+            return -1;
+
+        count++;
+        pos += 1 + *len;
+    }
+
+    if (count == 0)
+        return 0;
+
+    NE_strid *names = NE_arenaCalloc(exe->arena, count, sizeof(NE_strid));
+    uint16_t *offsets = NE_arenaCalloc(exe->arena, count, sizeof(uint16_t));
+    if (!names || !offsets)
         return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *p = rd->data + ofs;
+
+        offsets[i] = (uint16_t)(ofs - table_start);
+        names[i] = NE_strpoolIntern(exe->pool, (const char *)p + 1, p[0]);
+        if (!names[i])
+            return -1;
+
+        ofs += 1 + p[0];
     }
 
-    // seek to resource table
-    if (fseek(fp, exe->header.ResTableOffset, SEEK_SET) != 0) {
-        exe->error = "Failed to seek to resource table";
+    exe->rsrc.Names = names;
+    exe->rsrc.NameOffsets = offsets;
+    exe->rsrc.NameCount = count;
+    return 0;
+}
+
+int NE_readRsrcTable(const struct NE_reader *rd, struct NE_exe *exe) {
+    if (!exe->ready) {
+        NE_setError(exe, NE_ERR_NOT_READY, "Exe struct isn't setup/ready yet");
         return -1;
     }
 
+    memset(&exe->rsrc, 0, sizeof(exe->rsrc));
+
+    // no resource table at all
+    if (exe->header.ResTableOffset == exe->header.ResidNamTable)
+        return 0;
 
-    printf("RES TABLE OFS: 0x%04x\n", exe->header.ResTableOffset);
+    size_t table_start = (size_t)exe->HeaderOffset + exe->header.ResTableOffset;
+    size_t table_end = (size_t)exe->HeaderOffset + exe->header.ResidNamTable;
+    if (table_end < table_start)
+        table_end = rd->size;
 
     // read alignment shift value
-    if (fread(
-        &exe->rsrc.AlignmentShift,
-        sizeof(exe->rsrc.AlignmentShift),
-        1, fp) < 1
-    ) {
-        exe->error = "Failed to read alignment shift";
+    const uint8_t *p = NE_readerView(rd, table_start, sizeof(exe->rsrc.AlignmentShift));
+    if (!p) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Failed to read alignment shift");
         return -1;
     }
 
-    // read list of types
-    exe->rsrc.Types = NULL;
+    exe->rsrc.AlignmentShift = NE_getU16(p);
+    if (exe->rsrc.AlignmentShift >= 32) {
+        NE_setError(exe, NE_ERR_CORRUPT, "Resource alignment shift is out of range");
+        return -1;
+    }
 
-    NE_ResType res_type = {0};
+    size_t types_start = table_start + sizeof(exe->rsrc.AlignmentShift);
+    size_t type_count, name_count, types_end;
 
-    // use 0xCAFE because we don't want it prematurely exit
-    res_type.TypeID = 0xCAFE;
+    if (NE_sizeRsrcTable(rd, types_start, &type_count, &name_count, &types_end) < 0) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Resource type list runs past the end of the file");
+        return -1;
+    }
 
-    while (1) {
-        res_type.NameInfo = NULL;
-        if (fread(&res_type.TypeID, sizeof(res_type.TypeID), 1, fp) < 1) {
-            exe->error = "Failed to read type id (likely got to EOF)";
+    if (type_count) {
+        exe->rsrc.Types = NE_arenaCalloc(exe->arena, type_count, sizeof(NE_ResType));
+        exe->rsrc.NameInfoPool = name_count
+            ? NE_arenaCalloc(exe->arena, name_count, sizeof(struct NE_ResNameInfo))
+            : NULL;
+
+        if (!exe->rsrc.Types || (name_count && !exe->rsrc.NameInfoPool)) {
+            NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc resource table");
             return -1;
         }
+    }
 
-        if (res_type.TypeID == rt_terminator) {
-            // printf("terminator found. breaking...\n");
-            break;
-        }
+    exe->rsrc.TypeCount = type_count;
+    exe->rsrc.NameInfoCount = name_count;
+
+    // the sizing walk already bounds-checked all of this
+    p = rd->data + types_start;
+    struct NE_ResNameInfo *nameinfo = exe->rsrc.NameInfoPool;
+
+    for (size_t i = 0; i < type_count; i++) {
+        NE_ResType *res_type = &exe->rsrc.Types[i];
+
+        res_type->TypeID = NE_getU16(p);
+        res_type->metadata.ResourceCount = NE_getU16(p + 2);
+        res_type->metadata.Reserved = NE_getU32(p + 4);
+        p += NE_TYPEINFO_SIZE;
+
+        res_type->NameInfo = nameinfo;
+        NE_decodeNameInfo(nameinfo, p, res_type->metadata.ResourceCount);
+
+        nameinfo += res_type->metadata.ResourceCount;
+        p += (size_t)res_type->metadata.ResourceCount * NE_NAMEINFO_SIZE;
+    }
+
+    if (NE_readRsrcNames(rd, exe, table_start, types_end, table_end) < 0) {
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to read resource names");
+        return -1;
+    }
+
+    return 0;
+}
+
+NE_strid NE_getRsrcNameId(const struct NE_ResTable *rsrc, uint16_t id) {
+    if (id & NE_RSRC_INTEGER_ID)
+        return 0;
+
+    // strings are stored in table order, so the offsets are sorted
+    size_t lo = 0, hi = rsrc->NameCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (rsrc->NameOffsets[mid] < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < rsrc->NameCount && rsrc->NameOffsets[lo] == id)
+        return rsrc->Names[lo];
+
+    return 0;
+}
+
+const char *NE_getRsrcName(const struct NE_exe *exe, uint16_t id) {
+    return NE_str(exe, NE_getRsrcNameId(&exe->rsrc, id));
+}
+
+// Offset and Length are in units of 1 << AlignmentShift bytes
+const uint8_t *NE_getRsrcData(const struct NE_exe *exe, const struct NE_ResNameInfo *info, size_t *size) {
+    size_t ofs = (size_t)info->Offset << exe->rsrc.AlignmentShift;
+    size_t len = (size_t)info->Length << exe->rsrc.AlignmentShift;
+    size_t unit = (size_t)1 << exe->rsrc.AlignmentShift;
+    size_t file_size = exe->reader.size;
+
+    // the padding of the last resource is sometimes cut off
+    if (ofs <= file_size && len > file_size - ofs && len - (file_size - ofs) < unit)
+        len = file_size - ofs;
+
+    *size = len;
+    return NE_readerView(&exe->reader, ofs, len);
+}
+
+// CRC-32 of the whole file with the FileLoadCRC field taken as zero, as
+// ref/exefmt.txt specifies
+uint32_t NE_fileCRC(const struct NE_exe *exe) {
+    static const uint8_t zero[sizeof(exe->header.FileLoadCRC)];
+    const struct NE_reader *rd = &exe->reader;
+
+    // NE_readHeader made sure the whole header is in the file
+    size_t field = (size_t)exe->HeaderOffset + offsetof(struct NE_header, FileLoadCRC);
+    size_t after = field + sizeof(zero);
+
+    uint32_t crc = NE_crc32(0, rd->data, field);
+    crc = NE_crc32(crc, zero, sizeof(zero));
+    return NE_crc32(crc, rd->data + after, rd->size - after);
+}
+
+int NE_verifyCRC(struct NE_exe *exe, uint32_t *computed) {
+    if (!exe->ready) {
+        NE_setError(exe, NE_ERR_NOT_READY, "Exe struct isn't setup/ready yet");
+        return -1;
+    }
+
+    uint32_t crc = NE_fileCRC(exe);
+    if (computed)
+        *computed = crc;
+
+    if (exe->header.FileLoadCRC == 0) {
+        NE_setError(exe, NE_ERR_NO_CRC, "File has no CRC");
+        return -1;
+    }
+
+    if (exe->header.FileLoadCRC != crc) {
+        NE_setError(exe, NE_ERR_CRC_MISMATCH, "CRC mismatch");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Every table parser after the header. They only read the header and
+// write their own field of NE_exe, so they can run in any order or
+// concurrently on copies of the exe (see NE_tables[].field).
+const struct NE_table NE_tables[] = {
+    {
+        "resource",
+        NE_readRsrcTable,
+        offsetof(struct NE_exe, rsrc),
+        sizeof(((struct NE_exe *)0)->rsrc)
+    },
+    {
+        "segment",
+        NE_readSegTable,
+        offsetof(struct NE_exe, segs),
+        sizeof(((struct NE_exe *)0)->segs)
+    },
+    {
+        "entry",
+        NE_readEntryTable,
+        offsetof(struct NE_exe, entries),
+        sizeof(((struct NE_exe *)0)->entries)
+    },
+    {
+        "names",
+        NE_readNameTables,
+        offsetof(struct NE_exe, names),
+        sizeof(((struct NE_exe *)0)->names)
+    },
+    {
+        "imports",
+        NE_readImportTable,
+        offsetof(struct NE_exe, imports),
+        sizeof(((struct NE_exe *)0)->imports)
+    },
+};
+
+const size_t NE_tableCount = sizeof(NE_tables) / sizeof(NE_tables[0]);
+
+static int NE_setupExe(struct NE_exe *exe) {
+    exe->ready = 0;
 
-        if (fread(&res_type.metadata, sizeof(res_type.metadata), 1, fp) < 1) {
-            exe->error = "Failed to read metadata for type";
+    if (!exe->arena) {
+        NE_arenaInit(&exe->own_arena, 0);
+        exe->arena = &exe->own_arena;
+    }
+
+    if (!exe->pool) {
+        if (NE_strpoolInit(&exe->own_pool, exe->arena, NE_STRPOOL_EXE_CHUNKS) < 0) {
+            NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc string pool");
             return -1;
         }
+        exe->pool = &exe->own_pool;
+    }
+
+    return 0;
+}
+
+int NE_openExe(FILE *fp, struct NE_exe *exe) {
+    if (NE_setupExe(exe) < 0)
+        return -1;
+
+    if (!fp) {
+        NE_setError(exe, NE_ERR_IO, "File pointer is NULL");
+        return -1;
+    }
+
+    if (NE_openReader(&exe->reader, fileno(fp)) != 0) {
+        NE_setError(exe, NE_ERR_IO, "Failed to load file");
+        return -1;
+    }
+
+    return NE_readHeader(&exe->reader, exe);
+}
+
+int NE_openExeReader(struct NE_exe *exe, const struct NE_reader *rd) {
+    // the exe owns the reader from here on, even if this fails
+    exe->reader = *rd;
+
+    if (NE_setupExe(exe) < 0)
+        return -1;
+
+    return NE_readHeader(&exe->reader, exe);
+}
+
+int NE_readTable(size_t i, struct NE_exe *exe) {
+    uint64_t start = NE_statsBegin();
+    uint64_t allocs = exe->arena->allocs;
+
+    int ret = NE_tables[i].read(&exe->reader, exe);
+
+    NE_statsEnd(NE_PHASE_TABLES + (int)i, start, 0, 0, exe->arena->allocs - allocs);
+    return ret;
+}
 
-        // struct NE_ResNameInfo nameinfo;
-        // for (uint16_t i = 0; i < res_type.metadata.ResourceCount; i++) {
-        //     size_t result = fread(&nameinfo, sizeof(nameinfo), 1, fp);
-        //     // printf("%u: %zu\n", i, result);
-        //     if (result < 1) {
-        //         exe->error = "Failed to read nameinfo array";
-        //         arrfree(res_type.NameInfo);
-        //         return -1;
-        //     }
-        //     arrput(res_type.NameInfo, nameinfo);
-        // }
-        // printf("%zu\n", arrlenu(exe->rsrc.Types));
-        // fseek(fp, sizeof(struct NE_ResNameInfo) * res_type.metadata.ResourceCount, SEEK_CUR);
-
-        arrput(exe->rsrc.Types, res_type);
-    }
-
-    // ArrayUtil_create(exe->rsrc.Names);
-
-    // for (size_t i = 0; i < exe->rsrc.Names.len; i++) {
-    //     struct NE_ResNameInfo *nameinfo_ptr = res_type.metadata.NameInfo;
-    //     res_type.metadata.NameInfo = malloc(sizeof(struct NE_ResNameInfo));
-    //     if (!res_type.metadata.NameInfo) {
-    //         exe->error = "Failed to alloc nameinfo buffer";
-    //         return -1;
-    //     }
-    //
-    //     // seek to nameinfo
-    //     if (fseek(fp, (size_t)nameinfo_ptr, SEEK_SET) != 0) {
-    //         exe->error = "Failed to seek to nameinfo ptr";
-    //         return -1;
-    //     }
-    //
-    //     if (fread(res_type.metadata.NameInfo, sizeof(struct NE_ResNameInfo), 1, fp) < 1) {
-    //         exe->error = "Failed to read nameinfo";
-    //         return -1;
-    //     }
-    // }
+int NE_readTables(struct NE_exe *exe) {
+    for (size_t i = 0; i < NE_tableCount; i++) {
+        if (NE_readTable(i, exe) < 0)
+            return -1;
+    }
 
     return 0;
 }
 
+int NE_readBuffer(struct NE_exe *exe, const void *data, size_t size) {
+    struct NE_reader rd;
+    NE_readerFromBuffer(&rd, data, size);
+
+    if (NE_openExeReader(exe, &rd) < 0)
+        return -1;
+
+    return NE_readTables(exe);
+}
+
 int NE_readFile(FILE *fp, struct NE_exe *exe) {
-    int ret = 0;
+    if (NE_openExe(fp, exe) < 0)
+        return -1;
 
-    ret |= NE_readHeader(fp, exe);
-    ret |= NE_readRsrcTable(fp, exe);
-    return ret;
+    return NE_readTables(exe);
 }
 
 void NE_freeExe(struct NE_exe *exe) {
-    NE_ResType res_type = {0};
-
-    if (exe->rsrc.Types) {
-    for (size_t i = 0; i < arrlenu(exe->rsrc.Types); i++) {
-        res_type = exe->rsrc.Types[i];
-        arrfree(res_type.NameInfo);
-    }
+    // a shared pool outlives the exe, our own goes with the arena
+    if (exe->pool == &exe->own_pool) {
+        NE_strpoolFree(&exe->own_pool);
+        exe->pool = NULL;
     }
 
-    arrfree(exe->rsrc.Types);
-    arrfree(exe->rsrc.Names);
+    if (exe->arena == &exe->own_arena)
+        NE_arenaFree(exe->arena);
+    else if (exe->arena)
+        NE_arenaReset(exe->arena);
+
+    memset(&exe->rsrc, 0, sizeof(exe->rsrc));
+    memset(&exe->segs, 0, sizeof(exe->segs));
+    memset(&exe->entries, 0, sizeof(exe->entries));
+    memset(&exe->names, 0, sizeof(exe->names));
+    memset(&exe->imports, 0, sizeof(exe->imports));
+    NE_closeReader(&exe->reader);
 }
 
 const char *NE_detectOS(enum targetos os) {
@@ -200,8 +496,6 @@ const char *NE_detectOS(enum targetos os) {
         default:
             return "Unknown";
     }
-    fprintf(stderr, "somehow the program failed and went here. ask the developer about %s:%d\n", __func__, __LINE__);
-    abort();
 }
 
 const char *NE_detectRsrcID(enum restype rt) {
@@ -218,39 +512,329 @@ const char *NE_detectRsrcID(enum restype rt) {
         case rt_accelerator: return "Accelerator table";
         case rt_rcdata:      return "Resource data";
 
+        case rt_group_cursor: return "Cursor group";
+        case rt_group_icon:   return "Icon group";
+        case rt_nametable:    return "Name table";
+
         case rt_unknown:
         default: return "Unknown";
     }
-    fprintf(stderr, "somehow the program failed and went here. ask the developer about %s:%d\n", __func__, __LINE__);
-    abort();
 }
 
-void NE_printInfo(struct NE_exe exe) {
-    if (!exe.ready) { return; }
+const char *NE_statusName(enum NE_status status) {
+    switch (status) {
+        case NE_OK:               return "ok";
+        case NE_ERR_NOT_READY:    return "not_ready";
+        case NE_ERR_NOMEM:        return "nomem";
+        case NE_ERR_IO:           return "io";
+        case NE_ERR_NOT_MZ:       return "not_mz";
+        case NE_ERR_NOT_NE:       return "not_ne";
+        case NE_ERR_TRUNCATED:    return "truncated";
+        case NE_ERR_CORRUPT:      return "corrupt";
+        case NE_ERR_NO_CRC:       return "no_crc";
+        case NE_ERR_CRC_MISMATCH: return "crc_mismatch";
+        case NE_ERR_UNSUPPORTED:  return "unsupported";
+        case NE_ERR_UNKNOWN:
+        default:                  return "unknown";
+    }
+}
+
+void NE_fprintInfo(FILE *out, struct NE_exe *exe) {
+    if (!exe->ready) { return; }
 
-    printf(
+    fprintf(
+        out,
         "Linker version: %u.%u\n",
-        exe.header.MajLinkerVersion,
-        exe.header.MinLinkerVersion
+        exe->header.MajLinkerVersion,
+        exe->header.MinLinkerVersion
     );
 
-    printf(
+    fprintf(
+        out,
         "Target OS: %s [#%u]\n",
-        NE_detectOS(exe.header.targOS),
-        exe.header.targOS
+        NE_detectOS(exe->header.targOS),
+        exe->header.targOS
     );
 
-    printf("Resources:\n");
+    if (exe->names.ModuleName)
+        fprintf(out, "Module: %s\n", NE_str(exe, exe->names.ModuleName));
+    if (exe->names.Description)
+        fprintf(out, "Description: %s\n", NE_str(exe, exe->names.Description));
 
-    NE_ResType res_type = {0};
-    struct NE_ResNameInfo nameinfo = {0};
-    for (int i = 0; i < arrlenu(exe.rsrc.Types); i++) {
-        res_type = exe.rsrc.Types[i];
-        printf("Type ID: %s [#%u]\n", NE_detectRsrcID(res_type.TypeID), res_type.TypeID);
+    if (exe->imports.ModuleCount) {
+        fprintf(out, "Imports:");
+        for (size_t i = 0; i < exe->imports.ModuleCount; i++)
+            fprintf(out, "%s %s", i ? "," : "", NE_str(exe, exe->imports.Modules[i]));
+        fprintf(out, "\n");
+    }
 
-        // nameinfo = *res_type.metadata.NameInfo;
-        //
-        // printf("ID: %s [#%u]", NE_detectRsrcID(nameinfo.ID), nameinfo.ID);
+    fprintf(out, "Segments:\n");
+
+    for (size_t i = 0; i < exe->segs.Count; i++) {
+        fprintf(
+            out,
+            "    #%zu: %s, %lu bytes at 0x%lx, min alloc %lu, flags 0x%04x\n",
+            i + 1,
+            (exe->segs.Flags[i] & SEGFLAGS_TYPE_MASK) == SEGFLAGS_TYPE_CODE ? "CODE" : "DATA",
+            (unsigned long)exe->segs.FileSize[i],
+            (unsigned long)exe->segs.FileOffset[i],
+            (unsigned long)exe->segs.MinAlloc[i],
+            exe->segs.Flags[i]
+        );
+
+        size_t relocs[4];
+        if ((exe->segs.Flags[i] & SEGFLAGS_HAS_RELOCS) &&
+            NE_countRelocs(exe, (uint16_t)(i + 1), relocs) == 0) {
+            fprintf(
+                out,
+                "        relocations: %zu internal, %zu by ordinal, %zu by name, %zu OS fixups\n",
+                relocs[RELOC_INTERNALREF],
+                relocs[RELOC_IMPORTORDINAL],
+                relocs[RELOC_IMPORTNAME],
+                relocs[RELOC_OSFIXUP]
+            );
+        }
     }
+
+    fprintf(out, "Entry points:\n");
+
+    for (size_t i = 0; i < exe->entries.Count; i++) {
+        const struct NE_Entry *ent = NE_lookupOrdinal(exe, (uint16_t)(i + 1));
+        if (!ent)
+            continue;
+
+        const char *name = NE_exportName(exe, (uint16_t)(i + 1));
+        fprintf(
+            out,
+            "    @%zu: %u:%04x%s%s%s\n",
+            i + 1,
+            ent->Segment,
+            ent->Offset,
+            (ent->Flags & NE_ENTRY_EXPORTED) ? " exported" : "",
+            name ? " " : "",
+            name ? name : ""
+        );
+    }
+
+    fprintf(out, "Resources:\n");
+
+    for (size_t i = 0; i < exe->rsrc.TypeCount; i++) {
+        NE_ResType *res_type = &exe->rsrc.Types[i];
+
+        if (res_type->TypeID & NE_RSRC_INTEGER_ID) {
+            uint16_t type = res_type->TypeID & ~NE_RSRC_INTEGER_ID;
+            fprintf(out, "Type ID: %s [#%u]\n", NE_detectRsrcID(type), type);
+        } else {
+            const char *name = NE_getRsrcName(exe, res_type->TypeID);
+            fprintf(out, "Type ID: \"%s\"\n", name ? name : "?");
+        }
+
+        for (uint16_t j = 0; j < res_type->metadata.ResourceCount; j++) {
+            struct NE_ResNameInfo *nameinfo = &res_type->NameInfo[j];
+
+            if (nameinfo->ID & NE_RSRC_INTEGER_ID) {
+                fprintf(out, "    ID: #%u", nameinfo->ID & ~NE_RSRC_INTEGER_ID);
+            } else {
+                const char *name = NE_getRsrcName(exe, nameinfo->ID);
+                fprintf(out, "    ID: \"%s\"", name ? name : "?");
+            }
+
+            fprintf(
+                out,
+                " (%lu bytes at 0x%lx)\n",
+                (unsigned long)nameinfo->Length << exe->rsrc.AlignmentShift,
+                (unsigned long)nameinfo->Offset << exe->rsrc.AlignmentShift
+            );
+        }
+    }
+}
+
+void NE_printInfo(struct NE_exe *exe) {
+    NE_fprintInfo(stdout, exe);
+}
+
+static void NE_jsonFarPtr(struct NE_json *js, const char *key, uint32_t ptr) {
+    NE_jsonKey(js, key);
+    NE_jsonBeginObject(js);
+    NE_jsonFieldUInt(js, "segment", ptr >> 16);
+    NE_jsonFieldUInt(js, "offset", ptr & 0xFFFF);
+    NE_jsonEndObject(js);
 }
 
+static void NE_jsonRsrcID(struct NE_json *js, const struct NE_exe *exe, uint16_t id) {
+    if (id & NE_RSRC_INTEGER_ID) {
+        NE_jsonFieldUInt(js, "id", id & ~NE_RSRC_INTEGER_ID);
+    } else {
+        NE_jsonFieldString(js, "name", NE_getRsrcName(exe, id));
+    }
+}
+
+static void NE_jsonSegments(struct NE_json *js, const struct NE_exe *exe) {
+    NE_jsonKey(js, "segments");
+    NE_jsonBeginArray(js);
+
+    for (size_t i = 0; i < exe->segs.Count; i++) {
+        uint16_t flags = exe->segs.Flags[i];
+
+        NE_jsonBeginObject(js);
+        NE_jsonFieldUInt(js, "index", i + 1);
+        NE_jsonFieldString(
+            js,
+            "type",
+            (flags & SEGFLAGS_TYPE_MASK) == SEGFLAGS_TYPE_CODE ? "CODE" : "DATA"
+        );
+        NE_jsonFieldUInt(js, "offset", exe->segs.FileOffset[i]);
+        NE_jsonFieldUInt(js, "size", exe->segs.FileSize[i]);
+        NE_jsonFieldUInt(js, "min_alloc", exe->segs.MinAlloc[i]);
+        NE_jsonFieldUInt(js, "flags", flags);
+
+        size_t relocs[4];
+        if ((flags & SEGFLAGS_HAS_RELOCS) &&
+            NE_countRelocs(exe, (uint16_t)(i + 1), relocs) == 0) {
+            NE_jsonKey(js, "relocations");
+            NE_jsonBeginObject(js);
+            NE_jsonFieldUInt(js, "internal", relocs[RELOC_INTERNALREF]);
+            NE_jsonFieldUInt(js, "ordinal", relocs[RELOC_IMPORTORDINAL]);
+            NE_jsonFieldUInt(js, "name", relocs[RELOC_IMPORTNAME]);
+            NE_jsonFieldUInt(js, "os_fixup", relocs[RELOC_OSFIXUP]);
+            NE_jsonEndObject(js);
+        }
+
+        NE_jsonEndObject(js);
+    }
+
+    NE_jsonEndArray(js);
+}
+
+static void NE_jsonResources(struct NE_json *js, const struct NE_exe *exe) {
+    NE_jsonKey(js, "resources");
+    NE_jsonBeginArray(js);
+
+    for (size_t i = 0; i < exe->rsrc.TypeCount; i++) {
+        const NE_ResType *res_type = &exe->rsrc.Types[i];
+
+        NE_jsonBeginObject(js);
+        if (res_type->TypeID & NE_RSRC_INTEGER_ID) {
+            uint16_t type = res_type->TypeID & ~NE_RSRC_INTEGER_ID;
+            NE_jsonFieldUInt(js, "type", type);
+            NE_jsonFieldString(js, "type_name", NE_detectRsrcID(type));
+        } else {
+            NE_jsonFieldString(js, "type_name", NE_getRsrcName(exe, res_type->TypeID));
+        }
+
+        NE_jsonKey(js, "items");
+        NE_jsonBeginArray(js);
+        for (uint16_t j = 0; j < res_type->metadata.ResourceCount; j++) {
+            const struct NE_ResNameInfo *nameinfo = &res_type->NameInfo[j];
+
+            NE_jsonBeginObject(js);
+            NE_jsonRsrcID(js, exe, nameinfo->ID);
+            NE_jsonFieldUInt(js, "offset", (uint64_t)nameinfo->Offset << exe->rsrc.AlignmentShift);
+            NE_jsonFieldUInt(js, "length", (uint64_t)nameinfo->Length << exe->rsrc.AlignmentShift);
+            NE_jsonFieldUInt(js, "flags", nameinfo->Flags);
+            NE_jsonEndObject(js);
+        }
+        NE_jsonEndArray(js);
+
+        NE_jsonEndObject(js);
+    }
+
+    NE_jsonEndArray(js);
+}
+
+static void NE_jsonImports(struct NE_json *js, struct NE_exe *exe) {
+    struct NE_ImportRef *refs;
+    size_t count;
+
+    if (NE_collectImports(exe, &refs, &count) < 0)
+        count = 0;
+
+    NE_jsonKey(js, "imports");
+    NE_jsonBeginArray(js);
+
+    size_t r = 0;
+    for (size_t m = 0; m < exe->imports.ModuleCount; m++) {
+        NE_jsonBeginObject(js);
+        NE_jsonFieldString(js, "module", NE_str(exe, exe->imports.Modules[m]));
+
+        // refs are sorted by module, ordinals first
+        while (r < count && refs[r].Module < m + 1)
+            r++;
+
+        NE_jsonKey(js, "ordinals");
+        NE_jsonBeginArray(js);
+        for (; r < count && refs[r].Module == m + 1 && !refs[r].ByName; r++)
+            NE_jsonUInt(js, refs[r].Proc);
+        NE_jsonEndArray(js);
+
+        NE_jsonKey(js, "names");
+        NE_jsonBeginArray(js);
+        for (; r < count && refs[r].Module == m + 1; r++)
+            NE_jsonCString(js, NE_str(exe, refs[r].Name));
+        NE_jsonEndArray(js);
+
+        NE_jsonEndObject(js);
+    }
+
+    NE_jsonEndArray(js);
+}
+
+static void NE_jsonExports(struct NE_json *js, const struct NE_exe *exe) {
+    NE_jsonKey(js, "exports");
+    NE_jsonBeginArray(js);
+
+    for (size_t i = 0; i < exe->entries.Count; i++) {
+        const struct NE_Entry *ent = NE_lookupOrdinal(exe, (uint16_t)(i + 1));
+        if (!ent)
+            continue;
+
+        NE_jsonBeginObject(js);
+        NE_jsonFieldUInt(js, "ordinal", i + 1);
+        NE_jsonFieldString(js, "name", NE_exportName(exe, (uint16_t)(i + 1)));
+        NE_jsonFieldUInt(js, "segment", ent->Segment);
+        NE_jsonFieldUInt(js, "offset", ent->Offset);
+        NE_jsonFieldBool(js, "exported", ent->Flags & NE_ENTRY_EXPORTED);
+        NE_jsonFieldBool(js, "movable", ent->Flags & NE_ENTRY_MOVABLE);
+        NE_jsonEndObject(js);
+    }
+
+    NE_jsonEndArray(js);
+}
+
+// The fields of one exe, written into an object the caller has opened
+void NE_jsonInfo(struct NE_json *js, struct NE_exe *exe) {
+    const struct NE_header *hdr = &exe->header;
+
+    if (!exe->ready)
+        return;
+
+    NE_jsonKey(js, "linker_version");
+    NE_jsonBeginArray(js);
+    NE_jsonUInt(js, hdr->MajLinkerVersion);
+    NE_jsonUInt(js, hdr->MinLinkerVersion);
+    NE_jsonEndArray(js);
+
+    NE_jsonFieldUInt(js, "target_os", hdr->targOS);
+    NE_jsonFieldString(js, "target_os_name", NE_detectOS(hdr->targOS));
+    NE_jsonFieldUInt(js, "flags", (uint16_t)(hdr->FlagWord | (hdr->ApplFlags << 8)));
+    NE_jsonFieldUInt(js, "crc", hdr->FileLoadCRC);
+    NE_jsonFieldUInt(js, "auto_data_segment", hdr->AutoDataSegIndex);
+    NE_jsonFieldUInt(js, "heap_size", hdr->InitHeapSize);
+    NE_jsonFieldUInt(js, "stack_size", hdr->InitStackSize);
+    NE_jsonFarPtr(js, "entry_point", hdr->EntryPoint);
+    NE_jsonFarPtr(js, "initial_stack", hdr->InitStack);
+
+    NE_jsonKey(js, "windows_version");
+    NE_jsonBeginArray(js);
+    NE_jsonUInt(js, hdr->expctwinver[1]);
+    NE_jsonUInt(js, hdr->expctwinver[0]);
+    NE_jsonEndArray(js);
+
+    NE_jsonFieldString(js, "module", NE_str(exe, exe->names.ModuleName));
+    NE_jsonFieldString(js, "description", NE_str(exe, exe->names.Description));
+
+    NE_jsonSegments(js, exe);
+    NE_jsonResources(js, exe);
+    NE_jsonImports(js, exe);
+    NE_jsonExports(js, exe);
+}
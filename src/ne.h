@@ -13,6 +13,9 @@
 #pragma once
 #include <stdio.h>
 #include <stdint.h>
+#include "arena.h"
+#include "reader.h"
+#include "strpool.h"
 
 //
 // In 16-bit DOS/Windows terminology, DGROUP is a segment class that referring
@@ -40,6 +43,11 @@ enum FlagWord {
 #define SEGFLAGS_DISCARD    0xF000
 #define SEGFLAGS_TYPE_CODE  0
 #define SEGFLAGS_TYPE_DATA  1
+#define SEGFLAGS_TYPE_MASK  0x0007
+#define SEGFLAGS_MOVEABLE   0x0010
+#define SEGFLAGS_PRELOAD    0x0040
+
+#pragma pack(push,1)
 
 struct NE_header {
     char sig[2];                 // {'N', 'E'}
@@ -49,6 +57,7 @@ struct NE_header {
     uint16_t EntryTableLength;   //Length of entry table in bytes
     uint32_t FileLoadCRC;        //32-bit CRC of entire contents of file
     uint8_t FlagWord;            // Uses the FlagWord enum
+    uint8_t ApplFlags;           // High byte of the flag word (LINKERROR, LIBMODULE)
     uint16_t AutoDataSegIndex;   //The automatic data segment index
     uint16_t InitHeapSize;       //The initial local heap size
     uint16_t InitStackSize;      //The initial stack size
@@ -79,7 +88,7 @@ struct NE_header {
     uint8_t expctwinver[2];      //Expected windows version (minor first)
 };
 
-#pragma pack(push,1)
+_Static_assert(sizeof(struct NE_header) == 0x40, "NE header must match the on-disk layout");
 
 // Segment table entry
 typedef struct {
@@ -98,6 +107,64 @@ struct NE_ResNameInfo {
     uint16_t Handle;
     uint16_t Usage;
 };
+#pragma pack(pop)
+
+// Parsed segment table, stored column by column so a query over one field
+// (e.g. the flags of every segment) walks one dense array. Index i is
+// segment number i + 1.
+struct NE_SegTable {
+    size_t    Count;
+    uint32_t *FileOffset;   // SectorBase already scaled by FileAlnSzShftCnt, 0 = no data
+    uint32_t *FileSize;     // 0 (64K) already expanded
+    uint16_t *Flags;
+    uint32_t *MinAlloc;     // 0 (64K) already expanded
+};
+
+// Entry table, decoded so Entries[ordinal - 1] is the entry for an
+// ordinal. Unused ordinals have Segment 0.
+#define NE_ENTRY_EXPORTED    0x01
+#define NE_ENTRY_SHARED_DATA 0x02
+#define NE_ENTRY_MOVABLE     0x04  // not in the file, set for 0FFh bundles
+
+struct NE_Entry {
+    uint16_t Offset;
+    uint8_t  Segment;
+    uint8_t  Flags;
+};
+
+struct NE_EntryTable {
+    size_t Count;               // highest ordinal
+    struct NE_Entry *Entries;
+};
+
+// A name from the resident or nonresident name table
+struct NE_NameEntry {
+    NE_strid Name;              // in exe->pool
+    uint16_t Ordinal;
+    uint8_t  Resident;
+};
+
+// Both name tables, minus their first strings (module name and
+// description), with open addressing hash indexes by ordinal and by name.
+// Index slots hold an Exports index + 1, 0 is empty. The name index uses
+// the pool's hashes and compares ids, never characters.
+struct NE_NameTable {
+    NE_strid ModuleName;
+    NE_strid Description;
+    struct NE_NameEntry *Exports;
+    size_t ExportCount;
+    uint32_t *ByOrdinal;
+    uint32_t *ByName;
+    size_t HashMask;
+};
+
+// Module reference table. Modules[i] is the name of module i + 1, as
+// used by import relocations. Procedure names are interned on demand by
+// NE_importedName.
+struct NE_ImportTable {
+    size_t    ModuleCount;
+    NE_strid *Modules;
+};
 
 // Resource table entry
 typedef struct {
@@ -128,18 +195,66 @@ typedef struct {
 struct NE_ResTable {
     uint16_t    AlignmentShift; // Alignment shift count for resource data.
     NE_ResType *Types;
-    char **Names;
+    size_t      TypeCount;
+    struct NE_ResNameInfo *NameInfoPool; // every type's NameInfo points in here
+    size_t      NameInfoCount;
+
+    // Type and resource name strings from the end of the table.
+    // NameOffsets[i] is the offset of Names[i] relative to the start of
+    // the resource table, which is what non-integer IDs refer to.
+    NE_strid   *Names;
+    uint16_t   *NameOffsets;
+    size_t      NameCount;
 };
 
+// Integer type and resource IDs have the high bit set, the rest are
+// offsets of a name string (see NE_getRsrcName)
+#define NE_RSRC_INTEGER_ID 0x8000
+
 // Custom structs for NEd
 
+// Why a call on an exe failed. `error` has the same as a message.
+enum NE_status {
+    NE_OK,
+    NE_ERR_UNKNOWN,
+    NE_ERR_NOT_READY,           // the header wasn't read (successfully) first
+    NE_ERR_NOMEM,
+    NE_ERR_IO,                  // the file couldn't be opened or read
+    NE_ERR_NOT_MZ,              // not an executable at all
+    NE_ERR_NOT_NE,              // an executable, but not a New Executable
+    NE_ERR_TRUNCATED,           // a table runs past the end of the file
+    NE_ERR_CORRUPT,             // a table is inconsistent or out of range
+    NE_ERR_NO_CRC,
+    NE_ERR_CRC_MISMATCH,
+    NE_ERR_UNSUPPORTED
+};
+
 struct NE_exe {
     int ready;
-    const char *error;
+    enum NE_status status;
+    const char *error;          // static string, never freed
+    uint32_t HeaderOffset;       // File offset of the NE header, table offsets are relative to it
+    struct NE_reader reader;
+
+    // Every table is allocated from here. Point it at a caller's arena
+    // before NE_readFile to recycle one between files, NE_freeExe then
+    // resets it. Left NULL, the exe uses own_arena.
+    struct NE_arena *arena;
+    struct NE_arena own_arena;
+
+    // Every name is interned here. Point it at a shared, locked pool to
+    // dedupe names across files; left NULL, the exe uses own_pool, which
+    // lives in the arena.
+    struct NE_strpool *pool;
+    struct NE_strpool own_pool;
+
     struct NE_header header;
     struct NE_ResTable rsrc;
+    struct NE_SegTable segs;
+    struct NE_EntryTable entries;
+    struct NE_NameTable names;
+    struct NE_ImportTable imports;
 };
-#pragma pack(pop)
 
 #define GLOBINIT 1<<2     //global initialization
 #define PMODEONLY 1<<3    //Protected mode only
@@ -186,7 +301,10 @@ enum restype {
     rt_fontdir,     //Font component
     rt_font,        //Font directory
     rt_accelerator, //Accelerator table
-    rt_rcdata       //Resource data
+    rt_rcdata,      //Resource data
+    rt_group_cursor = 12, //Cursor directory, points at rt_cursor entries
+    rt_group_icon = 14,   //Icon directory, points at rt_icon entries
+    rt_nametable          //Resource name table (Windows 3.0 only)
 };
 
 //Other OS/2 flags
@@ -195,6 +313,73 @@ enum restype {
 #define PFONT 1<<2   //OS/2 2.x Proportional Fonts
 #define GANGL 1<<3   //OS/2 Gangload area
 
+struct NE_table {
+    const char *name;
+    int (*read)(const struct NE_reader *rd, struct NE_exe *exe);
+    size_t field; // offset and size of the part of NE_exe the parser fills
+    size_t size;
+};
+
+extern const struct NE_table NE_tables[];
+extern const size_t NE_tableCount;
+
+static inline void NE_setError(struct NE_exe *exe, enum NE_status status, const char *error) {
+    exe->status = status;
+    exe->error = error;
+}
+
+const char *NE_statusName(enum NE_status status);
+
+int NE_readHeader(const struct NE_reader *rd, struct NE_exe *exe);
+int NE_readRsrcTable(const struct NE_reader *rd, struct NE_exe *exe);
+NE_strid NE_getRsrcNameId(const struct NE_ResTable *rsrc, uint16_t id);
+const char *NE_getRsrcName(const struct NE_exe *exe, uint16_t id);
+const char *NE_detectRsrcID(enum restype rt);
+
+// Bytes of one resource in the file, NULL if they run past its end
+const uint8_t *NE_getRsrcData(const struct NE_exe *exe, const struct NE_ResNameInfo *info, size_t *size);
+
+static inline const char *NE_str(const struct NE_exe *exe, NE_strid id) {
+    return NE_strpoolGet(exe->pool, id);
+}
+
+int NE_readSegTable(const struct NE_reader *rd, struct NE_exe *exe);
+size_t NE_segCountWhere(const struct NE_SegTable *segs, uint16_t mask, uint16_t value);
+size_t NE_segSelect(
+    const struct NE_SegTable *segs,
+    uint16_t mask,
+    uint16_t value,
+    uint16_t *out
+);
+size_t NE_segCodeSegments(const struct NE_SegTable *segs, uint16_t *out);
+uint64_t NE_segDiscardableBytes(const struct NE_SegTable *segs);
+
+int NE_readEntryTable(const struct NE_reader *rd, struct NE_exe *exe);
+int NE_readNameTables(const struct NE_reader *rd, struct NE_exe *exe);
+int NE_indexNameTable(struct NE_exe *exe);
+const struct NE_Entry *NE_lookupOrdinal(const struct NE_exe *exe, uint16_t ordinal);
+const char *NE_exportName(const struct NE_exe *exe, uint16_t ordinal);
+int NE_exportOrdinal(const struct NE_exe *exe, const char *name, size_t len);
+
+int NE_readImportTable(const struct NE_reader *rd, struct NE_exe *exe);
+NE_strid NE_importedName(const struct NE_exe *exe, uint16_t offset);
+
+uint32_t NE_fileCRC(const struct NE_exe *exe);
+int NE_verifyCRC(struct NE_exe *exe, uint32_t *computed);
+
+int NE_openExe(FILE *fp, struct NE_exe *exe);
+int NE_openExeReader(struct NE_exe *exe, const struct NE_reader *rd); // takes rd over
+int NE_readTable(size_t i, struct NE_exe *exe);
+int NE_readTables(struct NE_exe *exe);
 int NE_readFile(FILE *fp, struct NE_exe *exe);
-void NE_printInfo(struct NE_exe exe);
+
+// Parse a whole executable from memory. The bytes are borrowed, they have
+// to outlive the exe. Like every parser function it never prints, and it
+// only touches `exe`: any number of threads can parse at once.
+int NE_readBuffer(struct NE_exe *exe, const void *data, size_t size);
+void NE_printInfo(struct NE_exe *exe);
+void NE_fprintInfo(FILE *out, struct NE_exe *exe);
+
+struct NE_json;
+void NE_jsonInfo(struct NE_json *js, struct NE_exe *exe);
 void NE_freeExe(struct NE_exe *exe);
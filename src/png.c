@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "png.h"
+#include "crc32.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NE_PNG_WINDOW    32768  // deflate's
+#define NE_PNG_MIN_MATCH 3
+#define NE_PNG_MAX_MATCH 258
+#define NE_PNG_CHAIN     32     // candidates tried per position
+
+// Positions are 32-bit. Far more than any bitmap Windows 3.x could load.
+#define NE_PNG_MAX_RAW   0x7FFFFFFFu
+
+struct NE_pngOut {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int failed;
+    uint64_t bits;      // not yet written, LSB first
+    int nbits;
+};
+
+static void NE_pngReserve(struct NE_pngOut *o, size_t n) {
+    if (o->failed || o->cap - o->len >= n)
+        return;
+
+    size_t cap = o->cap ? o->cap : 1024;
+    while (cap - o->len < n)
+        cap *= 2;
+
+    uint8_t *data = realloc(o->data, cap);
+    if (!data) {
+        o->failed = 1;
+        return;
+    }
+
+    o->data = data;
+    o->cap = cap;
+}
+
+static void NE_pngPut(struct NE_pngOut *o, const void *p, size_t n) {
+    NE_pngReserve(o, n);
+    if (o->failed)
+        return;
+
+    memcpy(o->data + o->len, p, n);
+    o->len += n;
+}
+
+static void NE_pngPutU32(struct NE_pngOut *o, uint32_t v) {
+    uint8_t be[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+    NE_pngPut(o, be, sizeof(be));
+}
+
+static void NE_pngBits(struct NE_pngOut *o, uint32_t value, int count) {
+    o->bits |= (uint64_t)value << o->nbits;
+    o->nbits += count;
+
+    if (o->nbits >= 32) {
+        uint8_t b[4] = { (uint8_t)o->bits, (uint8_t)(o->bits >> 8), (uint8_t)(o->bits >> 16), (uint8_t)(o->bits >> 24) };
+        NE_pngPut(o, b, sizeof(b));
+        o->bits >>= 32;
+        o->nbits -= 32;
+    }
+}
+
+static void NE_pngFlushBits(struct NE_pngOut *o) {
+    while (o->nbits > 0) {
+        uint8_t b = (uint8_t)o->bits;
+        NE_pngPut(o, &b, 1);
+        o->bits >>= 8;
+        o->nbits -= 8;
+    }
+
+    o->bits = 0;
+    o->nbits = 0;
+}
+
+// Huffman codes go out MSB first, the rest of the stream LSB first
+static uint32_t NE_pngReverse(uint32_t code, int len) {
+    uint32_t r = 0;
+
+    for (int i = 0; i < len; i++, code >>= 1)
+        r = (r << 1) | (code & 1);
+    return r;
+}
+
+static const uint16_t NE_pngLenBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t NE_pngLenExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t NE_pngDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t NE_pngDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// The fixed literal/length code (RFC 1951 3.2.6), bit reversed
+struct NE_pngCodes {
+    uint16_t code[288];
+    uint8_t len[288];
+};
+
+static void NE_pngFixedCodes(struct NE_pngCodes *c) {
+    for (uint32_t sym = 0; sym < 288; sym++) {
+        uint32_t code;
+        int len;
+
+        if (sym < 144) {
+            code = 0x30 + sym;
+            len = 8;
+        } else if (sym < 256) {
+            code = 0x190 + (sym - 144);
+            len = 9;
+        } else if (sym < 280) {
+            code = sym - 256;
+            len = 7;
+        } else {
+            code = 0xC0 + (sym - 280);
+            len = 8;
+        }
+
+        c->code[sym] = (uint16_t)NE_pngReverse(code, len);
+        c->len[sym] = (uint8_t)len;
+    }
+}
+
+static void NE_pngMatch(struct NE_pngOut *o, const struct NE_pngCodes *c, size_t len, size_t dist) {
+    int l = 28;
+    while (NE_pngLenBase[l] > len)
+        l--;
+    NE_pngBits(o, c->code[257 + l], c->len[257 + l]);
+    NE_pngBits(o, (uint32_t)(len - NE_pngLenBase[l]), NE_pngLenExtra[l]);
+
+    int d = 29;
+    while (NE_pngDistBase[d] > dist)
+        d--;
+    NE_pngBits(o, NE_pngReverse((uint32_t)d, 5), 5);
+    NE_pngBits(o, (uint32_t)(dist - NE_pngDistBase[d]), NE_pngDistExtra[d]);
+}
+
+// One final fixed Huffman block. The hash table grows with the input, up
+// to 2^15 buckets, so a 32x32 icon doesn't pay for clearing a big one.
+static int NE_pngDeflate(struct NE_pngOut *o, const uint8_t *src, size_t n) {
+    struct NE_pngCodes c;
+    int hash_bits = 8;
+
+    while (hash_bits < 15 && ((size_t)1 << hash_bits) < n)
+        hash_bits++;
+
+    size_t window = NE_PNG_WINDOW;
+    while (window / 2 >= n && window > 256)
+        window /= 2;
+
+    // 0 = empty, positions are stored + 1
+    uint32_t *head = calloc((size_t)1 << hash_bits, sizeof(*head));
+    uint32_t *prev = calloc(window, sizeof(*prev));
+    if (!head || !prev) {
+        free(head);
+        free(prev);
+        return -1;
+    }
+
+    NE_pngFixedCodes(&c);
+    NE_pngBits(o, 1, 1);    // BFINAL
+    NE_pngBits(o, 1, 2);    // BTYPE 01, fixed codes
+
+    size_t i = 0;
+    while (i < n) {
+        size_t best_len = 0;
+        size_t best_dist = 0;
+        uint32_t h = 0;
+
+        if (n - i >= NE_PNG_MIN_MATCH) {
+            uint32_t key = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+            h = (key * 2654435761u) >> (32 - hash_bits);
+
+            size_t max = n - i < NE_PNG_MAX_MATCH ? n - i : NE_PNG_MAX_MATCH;
+            uint32_t cand = head[h];
+
+            for (int tries = NE_PNG_CHAIN; cand && tries > 0; tries--) {
+                size_t pos = cand - 1;
+                if (i - pos > NE_PNG_WINDOW || i - pos > window)
+                    break;
+
+                size_t len = 0;
+                while (len < max && src[pos + len] == src[i + len])
+                    len++;
+
+                if (len > best_len) {
+                    best_len = len;
+                    best_dist = i - pos;
+                    if (len == max)
+                        break;
+                }
+
+                cand = prev[pos & (window - 1)];
+            }
+        }
+
+        size_t step = best_len >= NE_PNG_MIN_MATCH ? best_len : 1;
+
+        if (step > 1)
+            NE_pngMatch(o, &c, best_len, best_dist);
+        else
+            NE_pngBits(o, c.code[src[i]], c.len[src[i]]);
+
+        // every position of a match goes in the chains too
+        for (size_t end = i + step; i < end; i++) {
+            if (n - i < NE_PNG_MIN_MATCH)
+                continue;
+
+            uint32_t key = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+            h = (key * 2654435761u) >> (32 - hash_bits);
+            prev[i & (window - 1)] = head[h];
+            head[h] = (uint32_t)i + 1;
+        }
+    }
+
+    NE_pngBits(o, c.code[256], c.len[256]);
+    NE_pngFlushBits(o);
+
+    free(head);
+    free(prev);
+    return 0;
+}
+
+static uint32_t NE_pngAdler32(const uint8_t *p, size_t n) {
+    uint32_t a = 1, b = 0;
+
+    while (n) {
+        // the most bytes before b can overflow 32 bits
+        size_t chunk = n < 5552 ? n : 5552;
+        for (size_t i = 0; i < chunk; i++) {
+            a += p[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        p += chunk;
+        n -= chunk;
+    }
+
+    return b << 16 | a;
+}
+
+static uint8_t NE_pngPaeth(uint8_t a, uint8_t b, uint8_t c) {
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return a;
+    return pb <= pc ? b : c;
+}
+
+// Filter type byte and filtered row into `out`, `prev` is NULL for the
+// first row
+static void NE_pngFilterRow(const uint8_t *row, const uint8_t *prev, size_t stride, uint8_t *tmp, uint8_t *out) {
+    uint64_t best_sum = UINT64_MAX;
+
+    for (int f = 0; f < 5; f++) {
+        uint64_t sum = 0;
+
+        for (size_t x = 0; x < stride; x++) {
+            uint8_t a = x >= 4 ? row[x - 4] : 0;
+            uint8_t b = prev ? prev[x] : 0;
+            uint8_t c = x >= 4 && prev ? prev[x - 4] : 0;
+            uint8_t v;
+
+            switch (f) {
+                case 0:  v = row[x]; break;
+                case 1:  v = (uint8_t)(row[x] - a); break;
+                case 2:  v = (uint8_t)(row[x] - b); break;
+                case 3:  v = (uint8_t)(row[x] - ((a + b) >> 1)); break;
+                default: v = (uint8_t)(row[x] - NE_pngPaeth(a, b, c)); break;
+            }
+
+            tmp[x] = v;
+            sum += v < 128 ? v : 256 - v;
+        }
+
+        if (sum < best_sum) {
+            best_sum = sum;
+            out[0] = (uint8_t)f;
+            memcpy(out + 1, tmp, stride);
+        }
+    }
+}
+
+static void NE_pngChunkEnd(struct NE_pngOut *o, size_t start) {
+    // the length and the CRC cover everything after the length field
+    size_t len = o->len - start - 8;
+    uint8_t *p = o->data + start;
+
+    p[0] = (uint8_t)(len >> 24);
+    p[1] = (uint8_t)(len >> 16);
+    p[2] = (uint8_t)(len >> 8);
+    p[3] = (uint8_t)len;
+    NE_pngPutU32(o, NE_crc32(0, p + 4, len + 4));
+}
+
+static void NE_pngChunkBegin(struct NE_pngOut *o, const char *type, size_t *start) {
+    NE_pngReserve(o, 8);
+    *start = o->len;
+    NE_pngPutU32(o, 0);
+    NE_pngPut(o, type, 4);
+}
+
+int NE_pngEncode(const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t **out, size_t *size) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    struct NE_pngOut o = {0};
+    size_t stride = (size_t)width * 4;
+    size_t start;
+
+    if (!width || !height || (stride + 1) * height > NE_PNG_MAX_RAW) {
+        errno = EFBIG;
+        return -1;
+    }
+
+    size_t raw_len = (stride + 1) * height;
+    uint8_t *raw = malloc(raw_len);
+    uint8_t *tmp = malloc(stride);
+    if (!raw || !tmp) {
+        free(raw);
+        free(tmp);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *row = rgba + y * stride;
+        NE_pngFilterRow(row, y ? row - stride : NULL, stride, tmp, raw + y * (stride + 1));
+    }
+    free(tmp);
+
+    NE_pngPut(&o, signature, sizeof(signature));
+
+    // 8 bit RGBA, deflate, adaptive filters, not interlaced
+    uint8_t ihdr[13] = {
+        (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+        (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+        8, 6, 0, 0, 0
+    };
+    NE_pngChunkBegin(&o, "IHDR", &start);
+    NE_pngPut(&o, ihdr, sizeof(ihdr));
+    if (!o.failed)
+        NE_pngChunkEnd(&o, start);
+
+    // zlib stream: 32K window, no dictionary, then the Adler-32 of the rows
+    static const uint8_t zlib_header[2] = { 0x78, 0x01 };
+    NE_pngChunkBegin(&o, "IDAT", &start);
+    NE_pngPut(&o, zlib_header, sizeof(zlib_header));
+    if (NE_pngDeflate(&o, raw, raw_len) < 0)
+        o.failed = 1;
+    NE_pngPutU32(&o, NE_pngAdler32(raw, raw_len));
+    if (!o.failed)
+        NE_pngChunkEnd(&o, start);
+    free(raw);
+
+    NE_pngChunkBegin(&o, "IEND", &start);
+    if (!o.failed)
+        NE_pngChunkEnd(&o, start);
+
+    if (o.failed) {
+        free(o.data);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    *out = o.data;
+    *size = o.len;
+    return 0;
+}
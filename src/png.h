@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// PNG writer for RGBA images, without zlib. Each row gets the filter
+// whose output has the smallest sum of magnitudes (the usual heuristic),
+// and the rows are compressed by a small deflate: greedy LZ77 over hash
+// chains coded with the fixed Huffman tables. Files come out somewhat
+// bigger than zlib's best, but any PNG reader takes them.
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// `width` * `height` pixels, 4 bytes each in R, G, B, A order. Returns a
+// malloc'd file in `out`, or -1 with errno set.
+int NE_pngEncode(const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t **out, size_t *size);
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "postings.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NE_POSTINGS_SKIP_SIZE sizeof(struct NE_postingsSkip)
+
+static size_t NE_postingsBlocks(size_t count) {
+    return (count + NE_POSTINGS_BLOCK - 1) / NE_POSTINGS_BLOCK;
+}
+
+size_t NE_postingsBound(size_t count) {
+    return NE_postingsBlocks(count) * NE_POSTINGS_SKIP_SIZE + count * 5;
+}
+
+static size_t NE_putVarint(uint8_t *out, uint32_t value) {
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+// 0 if the varint runs past `end` or doesn't fit 32 bits
+static int NE_getVarint(const uint8_t **p, const uint8_t *end, uint32_t *value) {
+    uint32_t v = 0;
+
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        uint8_t byte = *(*p)++;
+        v |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = v;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+size_t NE_postingsEncode(const uint32_t *ids, size_t count, uint8_t *out) {
+    size_t nblocks = NE_postingsBlocks(count);
+    uint8_t *data = out + nblocks * NE_POSTINGS_SKIP_SIZE;
+    size_t n = 0;
+
+    for (size_t b = 0; b < nblocks; b++) {
+        size_t start = b * NE_POSTINGS_BLOCK;
+        size_t stop = start + NE_POSTINGS_BLOCK < count ? start + NE_POSTINGS_BLOCK : count;
+        struct NE_postingsSkip skip = { ids[start], (uint32_t)n };
+
+        memcpy(out + b * NE_POSTINGS_SKIP_SIZE, &skip, sizeof(skip));
+
+        for (size_t i = start + 1; i < stop; i++)
+            n += NE_putVarint(data + n, ids[i] - ids[i - 1]);
+    }
+
+    return nblocks * NE_POSTINGS_SKIP_SIZE + n;
+}
+
+static struct NE_postingsSkip NE_postingsGetSkip(const struct NE_postingsCursor *cur, size_t block) {
+    struct NE_postingsSkip skip;
+    memcpy(&skip, cur->skip + block * NE_POSTINGS_SKIP_SIZE, sizeof(skip));
+    return skip;
+}
+
+static int NE_postingsLoadBlock(struct NE_postingsCursor *cur, size_t block) {
+    struct NE_postingsSkip skip = NE_postingsGetSkip(cur, block);
+    size_t start = block * NE_POSTINGS_BLOCK;
+
+    cur->block = block;
+    cur->id = skip.first;
+    cur->p = cur->data + skip.offset;
+    cur->left = (cur->count - start < NE_POSTINGS_BLOCK ? cur->count - start : NE_POSTINGS_BLOCK) - 1;
+    cur->valid = 1;
+    return 1;
+}
+
+int NE_postingsOpen(struct NE_postingsCursor *cur, const uint8_t *list, size_t size, size_t count) {
+    memset(cur, 0, sizeof(*cur));
+
+    size_t nblocks = NE_postingsBlocks(count);
+    if (size < nblocks * NE_POSTINGS_SKIP_SIZE || (count && !list))
+        return -1;
+
+    cur->skip = list;
+    cur->nblocks = nblocks;
+    cur->count = count;
+    cur->data = list + nblocks * NE_POSTINGS_SKIP_SIZE;
+    cur->end = list + size;
+
+    // seeks trust the skip table, so check it once here
+    for (size_t b = 0; b < nblocks; b++) {
+        struct NE_postingsSkip skip = NE_postingsGetSkip(cur, b);
+
+        if (skip.offset > (size_t)(cur->end - cur->data) ||
+            (b && skip.first <= NE_postingsGetSkip(cur, b - 1).first))
+            return -1;
+    }
+
+    if (nblocks)
+        NE_postingsLoadBlock(cur, 0);
+    return 0;
+}
+
+int NE_postingsNext(struct NE_postingsCursor *cur) {
+    if (!cur->valid)
+        return 0;
+
+    if (cur->left == 0) {
+        if (cur->block + 1 < cur->nblocks)
+            return NE_postingsLoadBlock(cur, cur->block + 1);
+
+        cur->valid = 0;
+        return 0;
+    }
+
+    uint32_t delta;
+    if (!NE_getVarint(&cur->p, cur->end, &delta) || delta == 0 || cur->id > UINT32_MAX - delta) {
+        // corrupt: stop here rather than go backwards
+        cur->valid = 0;
+        return 0;
+    }
+
+    cur->id += delta;
+    cur->left--;
+    return 1;
+}
+
+int NE_postingsSeek(struct NE_postingsCursor *cur, uint32_t target) {
+    if (!cur->valid || cur->id >= target)
+        return cur->valid;
+
+    // last block starting at or before the target
+    size_t lo = cur->block + 1, hi = cur->nblocks;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (NE_postingsGetSkip(cur, mid).first <= target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo - 1 != cur->block)
+        NE_postingsLoadBlock(cur, lo - 1);
+
+    while (cur->valid && cur->id < target)
+        NE_postingsNext(cur);
+
+    return cur->valid;
+}
+
+static int NE_postingsCompareCount(const void *a, const void *b) {
+    const struct NE_postingsCursor *x = a;
+    const struct NE_postingsCursor *y = b;
+
+    if (x->count != y->count)
+        return x->count < y->count ? -1 : 1;
+    return 0;
+}
+
+size_t NE_postingsIntersect(
+    struct NE_postingsCursor *lists,
+    size_t n,
+    uint64_t *bits,
+    size_t nbits
+) {
+    size_t found = 0;
+
+    if (n == 0)
+        return 0;
+
+    // the shortest list drives, the others only seek
+    qsort(lists, n, sizeof(*lists), NE_postingsCompareCount);
+
+    struct NE_postingsCursor *lead = &lists[0];
+    while (lead->valid) {
+        uint32_t id = lead->id;
+        size_t i;
+
+        for (i = 1; i < n; i++) {
+            if (!NE_postingsSeek(&lists[i], id))
+                return found;
+            if (lists[i].id != id)
+                break;
+        }
+
+        if (i < n) {
+            // some list skipped past: catch the lead up to it
+            NE_postingsSeek(lead, lists[i].id);
+            continue;
+        }
+
+        if (id < nbits) {
+            bits[id / 64] |= (uint64_t)1 << (id % 64);
+            found++;
+        }
+        NE_postingsNext(lead);
+    }
+
+    return found;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Posting lists: the sorted ids of the files sharing some key, stored
+// compressed. Ids go in blocks of NE_POSTINGS_BLOCK. A skip table in front
+// holds the first id and byte offset of every block, and the rest of each
+// block is LEB128 varint deltas.
+//
+// Seeking binary searches the skip table and decodes at most one block,
+// so intersecting a rare list with a common one costs about as much as
+// walking the rare one.
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define NE_POSTINGS_BLOCK 128
+
+struct NE_postingsSkip {
+    uint32_t first;             // first id of the block
+    uint32_t offset;            // of its deltas, from the end of the skip table
+};
+
+// Worst case encoded size of `count` ids
+size_t NE_postingsBound(size_t count);
+
+// Encode `count` sorted, unique ids into `out`. Returns the bytes written.
+size_t NE_postingsEncode(const uint32_t *ids, size_t count, uint8_t *out);
+
+struct NE_postingsCursor {
+    const uint8_t *skip;
+    size_t nblocks;
+    size_t count;
+    const uint8_t *data;        // deltas
+    const uint8_t *end;
+
+    const uint8_t *p;
+    size_t block;
+    size_t left;                // ids left in the block after `id`
+    uint32_t id;
+    int valid;                  // 0 once past the end
+};
+
+// Position on the first id of an encoded list. -1 if `size` bytes can't
+// hold `count` ids.
+int NE_postingsOpen(struct NE_postingsCursor *cur, const uint8_t *list, size_t size, size_t count);
+
+// Step to the next id, or to the first id >= `target`. Return cur->valid.
+int NE_postingsNext(struct NE_postingsCursor *cur);
+int NE_postingsSeek(struct NE_postingsCursor *cur, uint32_t target);
+
+// Set the bit of every id found in all `n` lists, ids >= `nbits` are
+// dropped. Returns the number of ids set. The cursors are consumed.
+size_t NE_postingsIntersect(
+    struct NE_postingsCursor *lists,
+    size_t n,
+    uint64_t *bits,
+    size_t nbits
+);
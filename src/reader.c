@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "reader.h"
+#include "stats.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define read _read
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define NE_READ_CHUNK (64 * 1024)
+
+// Slurp a descriptor we can't map or pread (pipes, ttys). The size isn't
+// known up front so the buffer grows geometrically.
+static int NE_readAll(struct NE_reader *rd, int fd, uint64_t *calls) {
+    size_t cap = NE_READ_CHUNK;
+    size_t len = 0;
+    uint8_t *buf = malloc(cap);
+    if (!buf)
+        return -1;
+
+    while (1) {
+        if (len == cap) {
+            uint8_t *grown = realloc(buf, cap * 2);
+            if (!grown) {
+                free(buf);
+                return -1;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+
+        ssize_t got = read(fd, buf + len, cap - len);
+        (*calls)++;
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            free(buf);
+            return -1;
+        }
+        if (got == 0)
+            break;
+        len += (size_t)got;
+    }
+
+    rd->data = buf;
+    rd->size = len;
+    rd->kind = NE_READER_HEAP;
+    return 0;
+}
+
+#ifndef _WIN32
+static int NE_preadAll(struct NE_reader *rd, int fd, size_t size, uint64_t *calls) {
+    uint8_t *buf = malloc(size ? size : 1);
+    if (!buf)
+        return -1;
+
+    size_t len = 0;
+    while (len < size) {
+        ssize_t got = pread(fd, buf + len, size - len, (off_t)len);
+        (*calls)++;
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            free(buf);
+            return -1;
+        }
+        if (got == 0)
+            break; // file shrank under us, keep what we have
+        len += (size_t)got;
+    }
+
+    rd->data = buf;
+    rd->size = len;
+    rd->kind = NE_READER_HEAP;
+    return 0;
+}
+#endif
+
+static int NE_openReaderFd(struct NE_reader *rd, int fd, uint64_t *calls) {
+    rd->data = NULL;
+    rd->size = 0;
+    rd->kind = NE_READER_NONE;
+
+    if (fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+#ifndef _WIN32
+    struct stat st;
+    (*calls)++;
+    if (fstat(fd, &st) != 0)
+        return -1;
+
+    if (!S_ISREG(st.st_mode))
+        return NE_readAll(rd, fd, calls);
+
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        // mmap refuses empty ranges, an empty reader is still valid
+        rd->kind = NE_READER_HEAP;
+        return 0;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    (*calls)++;
+    if (map == MAP_FAILED)
+        return NE_preadAll(rd, fd, size, calls);
+
+    rd->data = map;
+    rd->size = size;
+    rd->kind = NE_READER_MMAP;
+    return 0;
+#else
+    return NE_readAll(rd, fd, calls);
+#endif
+}
+
+int NE_openReader(struct NE_reader *rd, int fd) {
+    uint64_t start = NE_statsBegin();
+    uint64_t calls = 0;
+
+    int rc = NE_openReaderFd(rd, fd, &calls);
+    NE_statsEnd(NE_PHASE_IO, start, rd->size, calls, rd->kind == NE_READER_HEAP);
+    return rc;
+}
+
+void NE_readerFromBuffer(struct NE_reader *rd, const void *buf, size_t size) {
+    rd->data = buf;
+    rd->size = size;
+    rd->kind = NE_READER_BORROWED;
+}
+
+void NE_readerAdopt(struct NE_reader *rd, void *buf, size_t size) {
+    rd->data = buf;
+    rd->size = size;
+    rd->kind = NE_READER_HEAP;
+}
+
+void NE_readerPrefetch(const struct NE_reader *rd, size_t offset, size_t len) {
+#ifndef _WIN32
+    if (rd->kind != NE_READER_MMAP || len == 0 || offset > rd->size || len > rd->size - offset)
+        return;
+
+    // the map itself is page aligned
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(page - 1);
+    madvise((void *)(rd->data + start), offset + len - start, MADV_WILLNEED);
+#else
+    (void)rd;
+    (void)offset;
+    (void)len;
+#endif
+}
+
+void NE_closeReader(struct NE_reader *rd) {
+    uint64_t start = NE_statsBegin();
+
+    switch (rd->kind) {
+#ifndef _WIN32
+        case NE_READER_MMAP:
+            munmap((void *)rd->data, rd->size);
+            NE_statsEnd(NE_PHASE_IO, start, 0, 1, 0);
+            break;
+#endif
+        case NE_READER_HEAP:
+            free((void *)rd->data);
+            break;
+        default:
+            break;
+    }
+
+    rd->data = NULL;
+    rd->size = 0;
+    rd->kind = NE_READER_NONE;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// The reader holds the whole executable in memory so the table parsers
+// can pull bounds-checked views out of it instead of doing a fseek/fread
+// pair for every field. Regular files are mapped, anything else (pipes,
+// filesystems that refuse mmap) is read into a heap buffer once.
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum NE_readerKind {
+    NE_READER_NONE,
+    NE_READER_BORROWED, // caller owns the bytes
+    NE_READER_MMAP,
+    NE_READER_HEAP
+};
+
+struct NE_reader {
+    const uint8_t *data;
+    size_t size;
+    enum NE_readerKind kind;
+};
+
+int NE_openReader(struct NE_reader *rd, int fd);
+void NE_readerFromBuffer(struct NE_reader *rd, const void *buf, size_t size);
+void NE_readerAdopt(struct NE_reader *rd, void *buf, size_t size); // frees buf on close
+void NE_closeReader(struct NE_reader *rd);
+
+// Asks for the pages of a mapped range to be read in one go rather than
+// faulted in one by one. Nothing to do for the other kinds.
+void NE_readerPrefetch(const struct NE_reader *rd, size_t offset, size_t len);
+
+// Returns a pointer to `len` bytes at `offset`, or NULL if any of it lies
+// outside the file.
+static inline const uint8_t *NE_readerView(
+    const struct NE_reader *rd,
+    size_t offset,
+    size_t len
+) {
+    if (offset > rd->size || len > rd->size - offset)
+        return NULL;
+
+    return rd->data + offset;
+}
+
+// NE files are little endian, these don't care about alignment
+static inline uint16_t NE_getU16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t NE_getU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "reloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define NE_RELOC_SIZE 8
+#define NE_CHAIN_END 0xFFFF
+
+// Count the records of each target type. The target type is the low two
+// bits of byte 1 of each 8-byte record, i.e. bits 8-9 of every 64-bit lane,
+// so four records fit in two SSE registers.
+static void NE_countRelocTypes(const uint8_t *rec, size_t count, size_t counts[4]) {
+    size_t i = 0;
+
+    counts[0] = counts[1] = counts[2] = counts[3] = 0;
+
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi64x(RELOC_TARGET_MASK);
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    __m128i acc2 = _mm_setzero_si128();
+
+    for (; i + 4 <= count; i += 4, rec += 4 * NE_RELOC_SIZE) {
+        __m128i a = _mm_loadu_si128((const __m128i *)rec);
+        __m128i b = _mm_loadu_si128((const __m128i *)(rec + 16));
+
+        a = _mm_and_si128(_mm_srli_epi64(a, 8), mask);
+        b = _mm_and_si128(_mm_srli_epi64(b, 8), mask);
+
+        // low dword of every lane -> one type per 32-bit element
+        __m128i t = _mm_castps_si128(_mm_shuffle_ps(
+            _mm_castsi128_ps(a),
+            _mm_castsi128_ps(b),
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ));
+
+        // compares give -1 per match, so subtracting counts up
+        acc0 = _mm_sub_epi32(acc0, _mm_cmpeq_epi32(t, _mm_setzero_si128()));
+        acc1 = _mm_sub_epi32(acc1, _mm_cmpeq_epi32(t, _mm_set1_epi32(1)));
+        acc2 = _mm_sub_epi32(acc2, _mm_cmpeq_epi32(t, _mm_set1_epi32(2)));
+    }
+
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc0);
+    counts[0] = (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_storeu_si128((__m128i *)lanes, acc1);
+    counts[1] = (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_storeu_si128((__m128i *)lanes, acc2);
+    counts[2] = (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    counts[3] = i - counts[0] - counts[1] - counts[2];
+#endif
+
+    for (; i < count; i++, rec += NE_RELOC_SIZE)
+        counts[rec[1] & RELOC_TARGET_MASK]++;
+}
+
+// Finds the records of `segment`, *count is 0 if it has none. Returns
+// NE_OK, or what's wrong with the table with a message in `error`.
+static enum NE_status NE_relocRecords(
+    const struct NE_exe *exe,
+    uint16_t segment,
+    const uint8_t **rec,
+    size_t *count,
+    const char **error
+) {
+    const struct NE_reader *rd = &exe->reader;
+    const struct NE_SegTable *segs = &exe->segs;
+
+    *rec = NULL;
+    *count = 0;
+
+    if (segment == 0 || segment > segs->Count) {
+        *error = "Segment number is out of range";
+        return NE_ERR_CORRUPT;
+    }
+
+    size_t i = segment - 1;
+    if (!(segs->Flags[i] & SEGFLAGS_HAS_RELOCS) || segs->FileOffset[i] == 0)
+        return NE_OK;
+
+    size_t ofs = (size_t)segs->FileOffset[i] + segs->FileSize[i];
+    const uint8_t *p = NE_readerView(rd, ofs, 2);
+    if (!p) {
+        *error = "Relocation count runs past the end of the file";
+        return NE_ERR_TRUNCATED;
+    }
+
+    size_t n = NE_getU16(p);
+    *rec = NE_readerView(rd, ofs + 2, n * NE_RELOC_SIZE);
+    if (!*rec) {
+        *error = "Relocation records run past the end of the file";
+        return NE_ERR_TRUNCATED;
+    }
+
+    *count = n;
+    return NE_OK;
+}
+
+int NE_countRelocs(const struct NE_exe *exe, uint16_t segment, size_t counts[4]) {
+    const uint8_t *rec;
+    const char *error;
+    size_t count;
+
+    if (NE_relocRecords(exe, segment, &rec, &count, &error) != NE_OK)
+        return -1;
+
+    NE_countRelocTypes(rec, count, counts);
+    return 0;
+}
+
+int NE_readRelocs(struct NE_exe *exe, uint16_t segment, struct NE_RelocTable *relocs) {
+    const uint8_t *rec;
+    const char *error;
+    size_t count;
+
+    memset(relocs, 0, sizeof(*relocs));
+    relocs->Segment = segment;
+
+    enum NE_status status = NE_relocRecords(exe, segment, &rec, &count, &error);
+    if (status != NE_OK) {
+        NE_setError(exe, status, error);
+        return -1;
+    }
+
+    if (count == 0)
+        return 0;
+
+    size_t counts[4];
+    NE_countRelocTypes(rec, count, counts);
+
+    relocs->Count = count;
+    relocs->Internal = NE_arenaAlloc(exe->arena, counts[RELOC_INTERNALREF] * sizeof(*relocs->Internal));
+    relocs->ImportOrdinal = NE_arenaAlloc(exe->arena, counts[RELOC_IMPORTORDINAL] * sizeof(*relocs->ImportOrdinal));
+    relocs->ImportName = NE_arenaAlloc(exe->arena, counts[RELOC_IMPORTNAME] * sizeof(*relocs->ImportName));
+    relocs->OSFixup = NE_arenaAlloc(exe->arena, counts[RELOC_OSFIXUP] * sizeof(*relocs->OSFixup));
+
+    if (!relocs->Internal || !relocs->ImportOrdinal || !relocs->ImportName || !relocs->OSFixup) {
+        memset(relocs, 0, sizeof(*relocs));
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc relocation table");
+        return -1;
+    }
+
+    // every bucket is already the right size, this pass only scatters
+    for (size_t r = 0; r < count; r++, rec += NE_RELOC_SIZE) {
+        uint16_t src_offset = NE_getU16(rec + 2);
+        uint16_t a = NE_getU16(rec + 4);
+        uint16_t b = NE_getU16(rec + 6);
+
+        switch (rec[1] & RELOC_TARGET_MASK) {
+            case RELOC_INTERNALREF: {
+                struct NE_RelocInternal *ref = &relocs->Internal[relocs->InternalCount++];
+                ref->SrcOffset = src_offset;
+                ref->SrcType = rec[0];
+                ref->Flags = rec[1];
+                ref->Segment = rec[4];
+                ref->Target = b;
+                break;
+            }
+            case RELOC_IMPORTORDINAL:
+            case RELOC_IMPORTNAME: {
+                struct NE_RelocImport *imp = (rec[1] & RELOC_TARGET_MASK) == RELOC_IMPORTNAME
+                    ? &relocs->ImportName[relocs->ImportNameCount++]
+                    : &relocs->ImportOrdinal[relocs->ImportOrdinalCount++];
+                imp->SrcOffset = src_offset;
+                imp->SrcType = rec[0];
+                imp->Flags = rec[1];
+                imp->Module = a;
+                imp->Proc = b;
+                break;
+            }
+            case RELOC_OSFIXUP: {
+                struct NE_RelocOSFixup *fix = &relocs->OSFixup[relocs->OSFixupCount++];
+                fix->SrcOffset = src_offset;
+                fix->SrcType = rec[0];
+                fix->Flags = rec[1];
+                fix->FixupType = a;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int NE_compareImports(const void *a, const void *b) {
+    const struct NE_ImportRef *x = a;
+    const struct NE_ImportRef *y = b;
+
+    if (x->Module != y->Module)
+        return x->Module < y->Module ? -1 : 1;
+    if (x->ByName != y->ByName)
+        return x->ByName < y->ByName ? -1 : 1;
+    if (x->Proc != y->Proc)
+        return x->Proc < y->Proc ? -1 : 1;
+    return 0;
+}
+
+static size_t NE_appendImports(
+    struct NE_ImportRef *out,
+    const struct NE_RelocImport *imp,
+    size_t count,
+    uint8_t by_name
+) {
+    for (size_t i = 0; i < count; i++) {
+        out[i].Module = imp[i].Module;
+        out[i].Proc = imp[i].Proc;
+        out[i].ByName = by_name;
+        out[i].Name = 0;
+    }
+
+    return count;
+}
+
+int NE_collectImports(struct NE_exe *exe, struct NE_ImportRef **refs, size_t *count) {
+    struct NE_RelocTable *tables;
+    size_t total = 0;
+
+    *refs = NULL;
+    *count = 0;
+
+    if (exe->segs.Count == 0)
+        return 0;
+
+    tables = NE_arenaCalloc(exe->arena, exe->segs.Count, sizeof(*tables));
+    if (!tables) {
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc relocation tables");
+        return -1;
+    }
+
+    for (size_t i = 0; i < exe->segs.Count; i++) {
+        if (NE_readRelocs(exe, (uint16_t)(i + 1), &tables[i]) < 0)
+            return -1;
+        total += tables[i].ImportOrdinalCount + tables[i].ImportNameCount;
+    }
+
+    if (total == 0)
+        return 0;
+
+    struct NE_ImportRef *out = NE_arenaAlloc(exe->arena, total * sizeof(*out));
+    if (!out) {
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc import list");
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < exe->segs.Count; i++) {
+        n += NE_appendImports(out + n, tables[i].ImportOrdinal, tables[i].ImportOrdinalCount, 0);
+        n += NE_appendImports(out + n, tables[i].ImportName, tables[i].ImportNameCount, 1);
+    }
+
+    // the same procedure is usually imported from many places
+    qsort(out, n, sizeof(*out), NE_compareImports);
+
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (unique && NE_compareImports(&out[unique - 1], &out[i]) == 0)
+            continue;
+
+        out[unique] = out[i];
+        if (out[unique].ByName)
+            out[unique].Name = NE_importedName(exe, out[unique].Proc);
+        unique++;
+    }
+
+    *refs = out;
+    *count = unique;
+    return 0;
+}
+
+// Additive records patch exactly one place. The others patch a 0xFFFF
+// terminated list threaded through the segment data, each patched word
+// holding the offset of the next one.
+void NE_relocChainBegin(
+    const struct NE_exe *exe,
+    uint16_t segment,
+    uint16_t src_offset,
+    uint8_t flags,
+    struct NE_RelocChain *chain
+) {
+    memset(chain, 0, sizeof(*chain));
+    chain->next = 0x10000;
+
+    if (segment == 0 || segment > exe->segs.Count)
+        return;
+
+    size_t i = segment - 1;
+    chain->data = NE_readerView(&exe->reader, exe->segs.FileOffset[i], exe->segs.FileSize[i]);
+    if (!chain->data)
+        return;
+
+    chain->size = exe->segs.FileSize[i];
+    chain->additive = (flags & RELOC_ADDITIVE) != 0;
+    chain->next = src_offset;
+    chain->steps_left = chain->size / 2 + 1;
+}
+
+int NE_relocChainNext(struct NE_RelocChain *chain, uint16_t *offset) {
+    if (chain->next > 0xFFFF || chain->steps_left == 0)
+        return 0;
+
+    *offset = (uint16_t)chain->next;
+    chain->steps_left--;
+
+    if (chain->additive || (size_t)chain->next + 2 > chain->size) {
+        chain->next = 0x10000;
+    } else {
+        uint16_t next = NE_getU16(chain->data + chain->next);
+        chain->next = next == NE_CHAIN_END ? 0x10000 : next;
+    }
+
+    return 1;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Per-segment relocation records (see "PER SEGMENT DATA" in
+// ref/exefmt.txt). They're decoded on demand, one segment at a time, into
+// one compact array per target type.
+//
+#pragma once
+#include "ne.h"
+
+// Source type
+#define RELOC_SRC_MASK     0x0F
+#define RELOC_SRC_LOBYTE   0x00
+#define RELOC_SRC_SEGMENT  0x02
+#define RELOC_SRC_FAR_ADDR 0x03
+#define RELOC_SRC_OFFSET   0x05
+
+// Flags byte
+#define RELOC_TARGET_MASK   0x03
+#define RELOC_INTERNALREF   0x00
+#define RELOC_IMPORTORDINAL 0x01
+#define RELOC_IMPORTNAME    0x02
+#define RELOC_OSFIXUP       0x03
+#define RELOC_ADDITIVE      0x04
+
+#define RELOC_MOVABLE_SEG 0xFF
+
+struct NE_RelocInternal {
+    uint16_t SrcOffset;
+    uint8_t  SrcType;
+    uint8_t  Flags;
+    uint8_t  Segment;   // RELOC_MOVABLE_SEG: Target is an entry table ordinal
+    uint16_t Target;    // offset in a fixed segment
+};
+
+// IMPORTORDINAL and IMPORTNAME share a layout
+struct NE_RelocImport {
+    uint16_t SrcOffset;
+    uint8_t  SrcType;
+    uint8_t  Flags;
+    uint16_t Module;    // 1-based index into the module reference table
+    uint16_t Proc;      // ordinal, or offset into the imported names table
+};
+
+struct NE_RelocOSFixup {
+    uint16_t SrcOffset;
+    uint8_t  SrcType;
+    uint8_t  Flags;
+    uint16_t FixupType;
+};
+
+struct NE_RelocTable {
+    uint16_t Segment;   // 1-based segment number
+    size_t   Count;     // records in the file
+
+    struct NE_RelocInternal *Internal;
+    size_t InternalCount;
+    struct NE_RelocImport *ImportOrdinal;
+    size_t ImportOrdinalCount;
+    struct NE_RelocImport *ImportName;
+    size_t ImportNameCount;
+    struct NE_RelocOSFixup *OSFixup;
+    size_t OSFixupCount;
+};
+
+// One imported procedure, by ordinal or by name
+struct NE_ImportRef {
+    uint16_t Module;    // 1-based index into exe->imports.Modules
+    uint16_t Proc;      // ordinal, or offset into the imported names table
+    uint8_t  ByName;
+    NE_strid Name;      // ByName only
+};
+
+// Walks the source chain of one record without materializing it
+struct NE_RelocChain {
+    const uint8_t *data;    // segment data in the file
+    size_t size;
+    uint32_t next;          // 0x10000 once finished
+    size_t steps_left;      // guards against looping chains
+    int additive;
+};
+
+int NE_readRelocs(struct NE_exe *exe, uint16_t segment, struct NE_RelocTable *relocs);
+
+// Only the number of records of each target type, indexed by
+// RELOC_INTERNALREF ... RELOC_OSFIXUP. Nothing is allocated and `exe` is
+// left alone, -1 if the table is out of the file.
+int NE_countRelocs(const struct NE_exe *exe, uint16_t segment, size_t counts[4]);
+
+// Every distinct procedure the relocations of all segments import, sorted
+// by module, then ordinals before names, then ordinal/name offset.
+// Allocated from the exe's arena.
+int NE_collectImports(struct NE_exe *exe, struct NE_ImportRef **refs, size_t *count);
+
+void NE_relocChainBegin(
+    const struct NE_exe *exe,
+    uint16_t segment,
+    uint16_t src_offset,
+    uint8_t flags,
+    struct NE_RelocChain *chain
+);
+int NE_relocChainNext(struct NE_RelocChain *chain, uint16_t *offset);
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "rsrc.h"
+#include <stdlib.h>
+#include <strings.h>
+
+static void NE_rsrcSet(const struct NE_exe *exe, size_t t, size_t i, struct NE_rsrc *r) {
+    r->type = &exe->rsrc.Types[t];
+    r->info = &r->type->NameInfo[i];
+    r->type_index = t;
+    r->index = i;
+}
+
+int NE_rsrcNext(const struct NE_exe *exe, struct NE_rsrc *r) {
+    size_t t = r->info ? r->type_index : 0;
+    size_t i = r->info ? r->index + 1 : 0;
+
+    for (; t < exe->rsrc.TypeCount; t++, i = 0) {
+        if (i < exe->rsrc.Types[t].metadata.ResourceCount) {
+            NE_rsrcSet(exe, t, i, r);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int NE_rsrcFind(const struct NE_exe *exe, uint16_t type, uint16_t id, struct NE_rsrc *r) {
+    type |= NE_RSRC_INTEGER_ID;
+    id |= NE_RSRC_INTEGER_ID;
+
+    for (size_t t = 0; t < exe->rsrc.TypeCount; t++) {
+        const NE_ResType *res_type = &exe->rsrc.Types[t];
+        if (res_type->TypeID != type)
+            continue;
+
+        for (size_t i = 0; i < res_type->metadata.ResourceCount; i++) {
+            if (res_type->NameInfo[i].ID == id) {
+                NE_rsrcSet(exe, t, i, r);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// `key` is a name or "#N", `id` a table ID
+static int NE_rsrcMatch(const struct NE_exe *exe, const char *key, uint16_t id) {
+    if (key[0] == '#') {
+        char *end;
+        unsigned long n = strtoul(key + 1, &end, 10);
+        return *end == '\0' && n < NE_RSRC_INTEGER_ID && id == (n | NE_RSRC_INTEGER_ID);
+    }
+
+    const char *name = NE_getRsrcName(exe, id);
+    return name && strcasecmp(name, key) == 0;
+}
+
+int NE_rsrcFindName(const struct NE_exe *exe, const char *type, const char *name, struct NE_rsrc *r) {
+    for (size_t t = 0; t < exe->rsrc.TypeCount; t++) {
+        const NE_ResType *res_type = &exe->rsrc.Types[t];
+        if (!NE_rsrcMatch(exe, type, res_type->TypeID))
+            continue;
+
+        for (size_t i = 0; i < res_type->metadata.ResourceCount; i++) {
+            if (NE_rsrcMatch(exe, name, res_type->NameInfo[i].ID)) {
+                NE_rsrcSet(exe, t, i, r);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+const uint8_t *NE_rsrcData(const struct NE_exe *exe, const struct NE_rsrc *r, size_t *size) {
+    const uint8_t *data = NE_getRsrcData(exe, r->info, size);
+
+    if (data)
+        NE_readerPrefetch(&exe->reader, (size_t)(data - exe->reader.data), *size);
+    return data;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Resource handles. Walking and looking up resources only reads the
+// resource table NE_readRsrcTable already parsed; the bytes of a resource
+// are first touched by NE_rsrcData, so a query that looks at one icon of a
+// file doesn't page in every bitmap and dialog of it.
+//
+#pragma once
+#include "ne.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct NE_rsrc {
+    const NE_ResType *type;
+    const struct NE_ResNameInfo *info;  // NULL before the first NE_rsrcNext
+    size_t type_index;                  // in exe->rsrc.Types
+    size_t index;                       // in type->NameInfo
+};
+
+// Moves `r` to the next resource in table order, starting from a zeroed
+// handle. Returns 0 after the last one.
+int NE_rsrcNext(const struct NE_exe *exe, struct NE_rsrc *r);
+
+// Finds a resource by integer type and id. Returns 0 if there is none.
+int NE_rsrcFind(const struct NE_exe *exe, uint16_t type, uint16_t id, struct NE_rsrc *r);
+
+// Same with names, compared ignoring case. Like FindResource, "#123"
+// stands for the integer 123.
+int NE_rsrcFindName(const struct NE_exe *exe, const char *type, const char *name, struct NE_rsrc *r);
+
+// The resource's bytes, NULL if they run past the end of the file
+const uint8_t *NE_rsrcData(const struct NE_exe *exe, const struct NE_rsrc *r, size_t *size);
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ne.h"
+#include <string.h>
+
+#define NE_SEGENT_SIZE 8
+#define NE_DEFAULT_ALIGN_SHIFT 9
+
+int NE_readSegTable(const struct NE_reader *rd, struct NE_exe *exe) {
+    struct NE_SegTable *segs = &exe->segs;
+
+    if (!exe->ready) {
+        NE_setError(exe, NE_ERR_NOT_READY, "Exe struct isn't setup/ready yet");
+        return -1;
+    }
+
+    memset(segs, 0, sizeof(*segs));
+
+    size_t count = exe->header.SegCount;
+    if (count == 0)
+        return 0;
+
+    unsigned shift = exe->header.FileAlnSzShftCnt;
+    if (shift == 0)
+        shift = NE_DEFAULT_ALIGN_SHIFT;
+
+    // sector bases are 16 bits, anything past this can't be a file offset
+    if (shift > 16) {
+        NE_setError(exe, NE_ERR_CORRUPT, "Segment alignment shift is out of range");
+        return -1;
+    }
+
+    const uint8_t *p = NE_readerView(
+        rd,
+        (size_t)exe->HeaderOffset + exe->header.SegTableOffset,
+        count * NE_SEGENT_SIZE
+    );
+
+    if (!p) {
+        NE_setError(exe, NE_ERR_TRUNCATED, "Segment table runs past the end of the file");
+        return -1;
+    }
+
+    segs->FileOffset = NE_arenaAlloc(exe->arena, count * sizeof(uint32_t));
+    segs->FileSize = NE_arenaAlloc(exe->arena, count * sizeof(uint32_t));
+    segs->Flags = NE_arenaAlloc(exe->arena, count * sizeof(uint16_t));
+    segs->MinAlloc = NE_arenaAlloc(exe->arena, count * sizeof(uint32_t));
+
+    if (!segs->FileOffset || !segs->FileSize || !segs->Flags || !segs->MinAlloc) {
+        memset(segs, 0, sizeof(*segs));
+        NE_setError(exe, NE_ERR_NOMEM, "Failed to alloc segment table");
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++, p += NE_SEGENT_SIZE) {
+        uint32_t sector = NE_getU16(p);
+        uint32_t size = NE_getU16(p + 2);
+        uint32_t min_alloc = NE_getU16(p + 6);
+
+        segs->FileOffset[i] = sector << shift;
+        segs->FileSize[i] = (size == 0 && sector != 0) ? 0x10000 : size;
+        segs->Flags[i] = NE_getU16(p + 4);
+        segs->MinAlloc[i] = min_alloc == 0 ? 0x10000 : min_alloc;
+    }
+
+    segs->Count = count;
+    return 0;
+}
+
+// The queries below only touch the columns they need and are written
+// without branches in the loop body so the compiler can vectorize them.
+
+size_t NE_segCountWhere(const struct NE_SegTable *segs, uint16_t mask, uint16_t value) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < segs->Count; i++)
+        n += (segs->Flags[i] & mask) == value;
+
+    return n;
+}
+
+// Writes the numbers (1-based) of every segment whose flags match into
+// `out`, which needs room for segs->Count entries. Returns how many.
+size_t NE_segSelect(
+    const struct NE_SegTable *segs,
+    uint16_t mask,
+    uint16_t value,
+    uint16_t *out
+) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < segs->Count; i++) {
+        out[n] = (uint16_t)(i + 1);
+        n += (segs->Flags[i] & mask) == value;
+    }
+
+    return n;
+}
+
+size_t NE_segCodeSegments(const struct NE_SegTable *segs, uint16_t *out) {
+    return NE_segSelect(segs, SEGFLAGS_TYPE_MASK, SEGFLAGS_TYPE_CODE, out);
+}
+
+// In-memory size of every segment with a non-zero discard priority
+uint64_t NE_segDiscardableBytes(const struct NE_SegTable *segs) {
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < segs->Count; i++)
+        total += (segs->Flags[i] & SEGFLAGS_DISCARD) ? segs->MinAlloc[i] : 0;
+
+    return total;
+}
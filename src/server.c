@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "server.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define NE_SERVER_MAX_DATA (1024u * 1024 * 1024)
+
+struct NE_serverSession {
+    struct NE_batchRun *run;
+    FILE *in;
+    FILE *out;
+};
+
+// Runs on its own thread: a client may send any number of requests before
+// reading the first answer, and submitting blocks once a window of answers
+// is waiting to be written.
+static void *NE_serveAnswers(void *arg) {
+    struct NE_serverSession *s = arg;
+    struct NE_batchResult res;
+    int broken = 0;
+
+    while (NE_batchCollect(s->run, &res)) {
+        // a client that went away still gets its requests drained
+        if (!broken) {
+            fprintf(s->out, "%s %zu %zu\n", res.ret < 0 ? "error" : "ok", res.out_len, res.err_len);
+            if (res.out_len)
+                fwrite(res.out, 1, res.out_len, s->out);
+            if (res.err_len)
+                fwrite(res.err, 1, res.err_len, s->out);
+            broken = fflush(s->out) != 0;
+        }
+
+        free(res.out);
+        free(res.err);
+    }
+
+    return NULL;
+}
+
+// Reads requests until the end of the input. Returns -1 on one that can't
+// be read, there is no telling where the next would start.
+static int NE_serveRequests(struct NE_serverSession *s) {
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int ret = 0;
+
+    while ((len = getline(&line, &cap, s->in)) > 0) {
+        if (line[len - 1] == '\n')
+            line[--len] = '\0';
+        if (len == 0)
+            continue;
+
+        if (line[0] != ':') {
+            if (NE_batchSubmit(s->run, line, NULL) < 0) {
+                fprintf(stderr, "ned: %s: Failed to queue file: %s\n", line, strerror(errno));
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+
+        char *end = line;
+        unsigned long long size = 0;
+
+        if (strncmp(line, ":data ", 6) == 0)
+            size = strtoull(line + 6, &end, 10);
+
+        if (end == line || end == line + 6 || (*end && *end != ' ') || size > NE_SERVER_MAX_DATA) {
+            fprintf(stderr, "ned: Bad request '%s'\n", line);
+            ret = -1;
+            break;
+        }
+
+        // same as a loaded empty file, see NE_openReader
+        struct NE_ingestFile file = { .fd = -1, .size = size };
+        if (size && !(file.data = malloc(size))) {
+            fprintf(stderr, "ned: Failed to alloc %llu bytes of data\n", size);
+            ret = -1;
+            break;
+        }
+
+        if (size && fread(file.data, 1, size, s->in) != size) {
+            fprintf(stderr, "ned: Input ended inside %llu bytes of data\n", size);
+            free(file.data);
+            ret = -1;
+            break;
+        }
+
+        if (NE_batchSubmit(s->run, *end ? end + 1 : "<data>", &file) < 0) {
+            fprintf(stderr, "ned: Failed to queue data: %s\n", strerror(errno));
+            free(file.data);
+            ret = -1;
+            break;
+        }
+    }
+
+    free(line);
+    return ret;
+}
+
+static int NE_serveSession(struct NE_batchRun *run, FILE *in, FILE *out) {
+    struct NE_serverSession s = { .run = run, .in = in, .out = out };
+    pthread_t tid;
+
+    if (pthread_create(&tid, NULL, NE_serveAnswers, &s) != 0) {
+        fprintf(stderr, "ned: Failed to start server thread\n");
+        return -1;
+    }
+
+    int ret = NE_serveRequests(&s);
+
+    NE_batchEndInput(run);
+    pthread_join(tid, NULL);
+    return ret;
+}
+
+// One client at a time, the next ones wait in the listen backlog
+static int NE_serveSocket(struct NE_batchRun *run, const char *path, volatile sig_atomic_t *stop) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct stat st;
+    int ret = 0;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "ned: %s: Socket path too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // left over from a server that didn't get to clean up
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        fprintf(stderr, "ned: %s: Failed to listen: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    while (!*stop) {
+        int conn = accept(fd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            fprintf(stderr, "ned: %s: Failed to accept: %s\n", path, strerror(errno));
+            ret = -1;
+            break;
+        }
+
+        int conn_out = dup(conn);
+        FILE *in = fdopen(conn, "rb");
+        FILE *out = conn_out >= 0 ? fdopen(conn_out, "wb") : NULL;
+
+        if (in && out) {
+            NE_serveSession(run, in, out);
+        } else {
+            fprintf(stderr, "ned: %s: Failed to open connection: %s\n", path, strerror(errno));
+        }
+
+        if (in)
+            fclose(in);
+        else
+            close(conn);
+        if (out)
+            fclose(out);
+        else if (conn_out >= 0)
+            close(conn_out);
+    }
+
+    close(fd);
+    unlink(path);
+    return ret;
+}
+
+int NE_serve(
+    struct NE_batch *batch,
+    NE_batchFn fn,
+    void *ctx,
+    const char *socket_path,
+    volatile sig_atomic_t *stop
+) {
+    int ret;
+
+    // answered to a closed pipe or socket, which is handled by the writer
+    signal(SIGPIPE, SIG_IGN);
+
+    struct NE_batchRun *run = NE_batchStart(batch, fn, ctx);
+    if (!run) {
+        fprintf(stderr, "ned: Failed to start workers\n");
+        return -1;
+    }
+
+    if (socket_path)
+        ret = NE_serveSocket(run, socket_path, stop);
+    else
+        ret = NE_serveSession(run, stdin, stdout);
+
+    NE_batchStop(run);
+    return ret;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// `ned --server`: every line of the input is a request, a path, or
+// ":data SIZE [NAME]" followed by SIZE bytes of the file itself. Each one
+// is answered in order by "ok|error OUT_LEN ERR_LEN\n" and then what ned
+// would have printed for that file to stdout and to stderr.
+//
+// The requests are run on one streaming batch (NE_batchStart), so the
+// workers, with their arenas, live as long as the server.
+//
+#pragma once
+#include "batch.h"
+#include <signal.h>
+
+// Answer requests with `fn`, from stdin until it ends, or with
+// `socket_path` from one client of that Unix socket at a time until
+// `*stop` is set. Returns -1 if it couldn't start or a request couldn't
+// be read.
+int NE_serve(
+    struct NE_batch *batch,
+    NE_batchFn fn,
+    void *ctx,
+    const char *socket_path,
+    volatile sig_atomic_t *stop
+);
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "stats.h"
+#include "json.h"
+#include "ne.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct NE_statsSlot {
+    struct NE_statsSlot *next;
+    struct NE_statsPhase phases[NE_STATS_PHASES];
+};
+
+int NE_statsOn;
+
+static _Thread_local struct NE_statsSlot *NE_statsSelf;
+static struct NE_statsSlot *NE_statsSlots;
+static pthread_mutex_t NE_statsLock = PTHREAD_MUTEX_INITIALIZER;
+static int NE_statsThreads;
+
+void NE_statsEnable(void) {
+    NE_statsOn = 1;
+}
+
+// First phase a thread records: give it a slot of its own
+static struct NE_statsSlot *NE_statsSlot(void) {
+    size_t size = (sizeof(struct NE_statsSlot) + 63) & ~(size_t)63;
+    struct NE_statsSlot *slot = aligned_alloc(64, size);
+    if (!slot)
+        return NULL;
+
+    memset(slot, 0, size);
+
+    pthread_mutex_lock(&NE_statsLock);
+    slot->next = NE_statsSlots;
+    NE_statsSlots = slot;
+    NE_statsThreads++;
+    pthread_mutex_unlock(&NE_statsLock);
+
+    return NE_statsSelf = slot;
+}
+
+void NE_statsRecord(int phase, uint64_t start, uint64_t bytes, uint64_t syscalls, uint64_t allocs) {
+    struct NE_statsSlot *slot = NE_statsSelf ? NE_statsSelf : NE_statsSlot();
+    if (!slot || phase < 0 || phase >= NE_STATS_PHASES)
+        return;
+
+    uint64_t ns = NE_statsNow() - start;
+    int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+    if (bucket >= NE_STATS_BUCKETS)
+        bucket = NE_STATS_BUCKETS - 1;
+
+    struct NE_statsPhase *p = &slot->phases[phase];
+    p->calls++;
+    p->ns += ns;
+    p->bytes += bytes;
+    p->syscalls += syscalls;
+    p->allocs += allocs;
+    p->hist[bucket]++;
+}
+
+void NE_statsTotals(struct NE_statsPhase totals[NE_STATS_PHASES]) {
+    memset(totals, 0, NE_STATS_PHASES * sizeof(*totals));
+
+    pthread_mutex_lock(&NE_statsLock);
+    for (const struct NE_statsSlot *slot = NE_statsSlots; slot; slot = slot->next) {
+        for (int i = 0; i < NE_STATS_PHASES; i++) {
+            const struct NE_statsPhase *p = &slot->phases[i];
+            struct NE_statsPhase *t = &totals[i];
+
+            t->calls += p->calls;
+            t->ns += p->ns;
+            t->bytes += p->bytes;
+            t->syscalls += p->syscalls;
+            t->allocs += p->allocs;
+            for (int b = 0; b < NE_STATS_BUCKETS; b++)
+                t->hist[b] += p->hist[b];
+        }
+    }
+    pthread_mutex_unlock(&NE_statsLock);
+}
+
+const char *NE_statsPhaseName(int phase) {
+    static const char *const fixed[NE_PHASE_TABLES] = {
+        [NE_PHASE_FILE]   = "file",
+        [NE_PHASE_IO]     = "io",
+        [NE_PHASE_HEADER] = "header",
+        [NE_PHASE_CACHE]  = "cache",
+        [NE_PHASE_OUTPUT] = "output",
+    };
+
+    if (phase >= 0 && phase < NE_PHASE_TABLES)
+        return fixed[phase];
+    if (phase >= NE_PHASE_TABLES && (size_t)(phase - NE_PHASE_TABLES) < NE_tableCount)
+        return NE_tables[phase - NE_PHASE_TABLES].name;
+    return NULL;
+}
+
+// Upper bound of the bucket holding the p-th latency, in ns
+static uint64_t NE_statsPercentile(const struct NE_statsPhase *p, double pct) {
+    uint64_t want = (uint64_t)(pct * (double)p->calls + 0.5);
+    uint64_t seen = 0;
+
+    if (want == 0)
+        want = 1;
+
+    for (int b = 0; b < NE_STATS_BUCKETS; b++) {
+        seen += p->hist[b];
+        if (seen >= want)
+            return (uint64_t)1 << b;
+    }
+
+    return (uint64_t)1 << (NE_STATS_BUCKETS - 1);
+}
+
+void NE_statsPrint(FILE *out) {
+    struct NE_statsPhase totals[NE_STATS_PHASES];
+    NE_statsTotals(totals);
+
+    fprintf(
+        out,
+        "%-10s %9s %11s %9s %9s %9s %12s %9s %9s\n",
+        "phase", "calls", "total ms", "avg us", "p50 us", "p99 us",
+        "bytes", "syscalls", "allocs"
+    );
+
+    for (int i = 0; i < NE_STATS_PHASES; i++) {
+        const struct NE_statsPhase *p = &totals[i];
+        if (!p->calls || !NE_statsPhaseName(i))
+            continue;
+
+        fprintf(
+            out,
+            "%-10s %9llu %11.3f %9.1f %9.1f %9.1f %12llu %9llu %9llu\n",
+            NE_statsPhaseName(i),
+            (unsigned long long)p->calls,
+            p->ns / 1e6,
+            p->ns / 1e3 / p->calls,
+            NE_statsPercentile(p, 0.50) / 1e3,
+            NE_statsPercentile(p, 0.99) / 1e3,
+            (unsigned long long)p->bytes,
+            (unsigned long long)p->syscalls,
+            (unsigned long long)p->allocs
+        );
+    }
+
+    // one line per phase, "<bound in us>:<count>" for every used bucket
+    fprintf(out, "latency histograms (us upper bound:count):\n");
+    for (int i = 0; i < NE_STATS_PHASES; i++) {
+        const struct NE_statsPhase *p = &totals[i];
+        if (!p->calls || !NE_statsPhaseName(i))
+            continue;
+
+        fprintf(out, "  %-10s", NE_statsPhaseName(i));
+        for (int b = 0; b < NE_STATS_BUCKETS; b++) {
+            if (p->hist[b])
+                fprintf(out, " %g:%llu", ((uint64_t)1 << b) / 1e3, (unsigned long long)p->hist[b]);
+        }
+        fputc('\n', out);
+    }
+}
+
+void NE_statsJson(struct NE_json *js) {
+    struct NE_statsPhase totals[NE_STATS_PHASES];
+    NE_statsTotals(totals);
+
+    NE_jsonBeginObject(js);
+    NE_jsonFieldUInt(js, "threads", (uint64_t)NE_statsThreads);
+    NE_jsonKey(js, "phases");
+    NE_jsonBeginArray(js);
+
+    for (int i = 0; i < NE_STATS_PHASES; i++) {
+        const struct NE_statsPhase *p = &totals[i];
+        if (!p->calls || !NE_statsPhaseName(i))
+            continue;
+
+        NE_jsonBeginObject(js);
+        NE_jsonFieldString(js, "name", NE_statsPhaseName(i));
+        NE_jsonFieldUInt(js, "calls", p->calls);
+        NE_jsonFieldUInt(js, "ns", p->ns);
+        NE_jsonFieldUInt(js, "p50_ns", NE_statsPercentile(p, 0.50));
+        NE_jsonFieldUInt(js, "p99_ns", NE_statsPercentile(p, 0.99));
+        NE_jsonFieldUInt(js, "bytes", p->bytes);
+        NE_jsonFieldUInt(js, "syscalls", p->syscalls);
+        NE_jsonFieldUInt(js, "allocs", p->allocs);
+
+        // buckets that were hit, each with its exclusive upper bound
+        NE_jsonKey(js, "histogram");
+        NE_jsonBeginArray(js);
+        for (int b = 0; b < NE_STATS_BUCKETS; b++) {
+            if (!p->hist[b])
+                continue;
+
+            NE_jsonBeginObject(js);
+            NE_jsonFieldUInt(js, "lt_ns", (uint64_t)1 << b);
+            NE_jsonFieldUInt(js, "count", p->hist[b]);
+            NE_jsonEndObject(js);
+        }
+        NE_jsonEndArray(js);
+
+        NE_jsonEndObject(js);
+    }
+
+    NE_jsonEndArray(js);
+    NE_jsonEndObject(js);
+}
+
+void NE_statsFree(void) {
+    pthread_mutex_lock(&NE_statsLock);
+    while (NE_statsSlots) {
+        struct NE_statsSlot *next = NE_statsSlots->next;
+        free(NE_statsSlots);
+        NE_statsSlots = next;
+    }
+    NE_statsThreads = 0;
+    pthread_mutex_unlock(&NE_statsLock);
+
+    // the calling thread's pointer is stale now
+    NE_statsSelf = NULL;
+}
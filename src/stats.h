@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Per-phase counters for --stats: time on the monotonic clock, bytes,
+// syscalls and allocations, plus a log2 histogram of each phase's
+// latency. Every thread counts into its own cache-line aligned slot, so
+// nothing is shared or atomic on the hot path; the slots are only summed
+// once the workers are done.
+//
+// Off by default. Then a phase costs one predictable branch.
+//
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+enum NE_statsPhaseId {
+    NE_PHASE_FILE,              // one whole file, start to finish
+    NE_PHASE_IO,                // opening (mapping or reading) and closing files
+    NE_PHASE_HEADER,
+    NE_PHASE_CACHE,
+    NE_PHASE_OUTPUT,            // reports, manifests, index records
+    NE_PHASE_TABLES,            // NE_tables[i] is NE_PHASE_TABLES + i
+    NE_STATS_PHASES = NE_PHASE_TABLES + 16
+};
+
+#define NE_STATS_BUCKETS 40     // bucket k: latencies below 2^k ns
+
+struct NE_statsPhase {
+    uint64_t calls;
+    uint64_t ns;
+    uint64_t bytes;
+    uint64_t syscalls;
+    uint64_t allocs;
+    uint64_t hist[NE_STATS_BUCKETS];
+};
+
+extern int NE_statsOn;
+
+void NE_statsEnable(void);
+
+static inline uint64_t NE_statsNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Start of a phase, 0 when stats are off
+static inline uint64_t NE_statsBegin(void) {
+    return NE_statsOn ? NE_statsNow() : 0;
+}
+
+void NE_statsRecord(int phase, uint64_t start, uint64_t bytes, uint64_t syscalls, uint64_t allocs);
+
+// End of a phase started with NE_statsBegin
+static inline void NE_statsEnd(int phase, uint64_t start, uint64_t bytes, uint64_t syscalls, uint64_t allocs) {
+    if (start)
+        NE_statsRecord(phase, start, bytes, syscalls, allocs);
+}
+
+// Sum of every thread's slot. Only while no thread is counting.
+void NE_statsTotals(struct NE_statsPhase totals[NE_STATS_PHASES]);
+const char *NE_statsPhaseName(int phase);
+
+struct NE_json;
+void NE_statsPrint(FILE *out);
+void NE_statsJson(struct NE_json *js);
+void NE_statsFree(void);
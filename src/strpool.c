@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "strpool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NE_STRPOOL_RECORD_HEADER 5
+
+static void *NE_strpoolAlloc(struct NE_strpool *pool, size_t size) {
+    if (pool->arena)
+        return NE_arenaCalloc(pool->arena, 1, size);
+
+    return calloc(1, size);
+}
+
+static void NE_strpoolRelease(struct NE_strpool *pool, void *ptr) {
+    if (!pool->arena)
+        free(ptr);
+}
+
+int NE_strpoolInit(struct NE_strpool *pool, struct NE_arena *arena, uint32_t max_chunks) {
+    memset(pool, 0, sizeof(*pool));
+    pool->arena = arena;
+    pthread_mutex_init(&pool->lock, NULL);
+
+    if (max_chunks == 0 || max_chunks > NE_STRPOOL_MAX_CHUNKS)
+        max_chunks = NE_STRPOOL_MAX_CHUNKS;
+
+    pool->max_chunks = max_chunks;
+    pool->chunks = NE_strpoolAlloc(pool, max_chunks * sizeof(uint8_t *));
+    if (!pool->chunks)
+        return -1;
+
+    return 0;
+}
+
+// Heap backed pool for a whole batch
+int NE_strpoolInitShared(struct NE_strpool *pool) {
+    if (NE_strpoolInit(pool, NULL, NE_STRPOOL_MAX_CHUNKS) < 0)
+        return -1;
+
+    pool->locked = 1;
+    return 0;
+}
+
+// Only while nobody else is using the pool
+void NE_strpoolSetLocked(struct NE_strpool *pool, int locked) {
+    pool->locked = locked;
+}
+
+void NE_strpoolFree(struct NE_strpool *pool) {
+    if (pool->chunks) {
+        for (uint32_t i = 0; i < pool->nchunks; i++)
+            NE_strpoolRelease(pool, pool->chunks[i]);
+        NE_strpoolRelease(pool, pool->chunks);
+    }
+
+    NE_strpoolRelease(pool, pool->index);
+    pthread_mutex_destroy(&pool->lock);
+    memset(pool, 0, sizeof(*pool));
+}
+
+uint32_t NE_strHash(const char *str, size_t len) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int NE_strpoolGrowIndex(struct NE_strpool *pool) {
+    size_t buckets = pool->index ? (pool->mask + 1) * 2 : 256;
+    NE_strid *index = NE_strpoolAlloc(pool, buckets * sizeof(NE_strid));
+    if (!index)
+        return -1;
+
+    size_t mask = buckets - 1;
+    if (pool->index) {
+        for (size_t i = 0; i <= pool->mask; i++) {
+            NE_strid id = pool->index[i];
+            if (!id)
+                continue;
+
+            size_t slot = NE_strpoolHash(pool, id) & mask;
+            while (index[slot])
+                slot = (slot + 1) & mask;
+            index[slot] = id;
+        }
+        NE_strpoolRelease(pool, pool->index);
+    }
+
+    pool->index = index;
+    pool->mask = mask;
+    return 0;
+}
+
+// Slot holding `str`, or the empty slot it would go in
+static size_t NE_strpoolProbe(
+    const struct NE_strpool *pool,
+    const char *str,
+    size_t len,
+    uint32_t h
+) {
+    size_t slot = h & pool->mask;
+
+    while (pool->index[slot]) {
+        NE_strid id = pool->index[slot];
+        const uint8_t *rec = NE_strpoolRecord(pool, id);
+
+        if (NE_strpoolHash(pool, id) == h && rec[4] == len &&
+            memcmp(rec + NE_STRPOOL_RECORD_HEADER, str, len) == 0)
+            break;
+
+        slot = (slot + 1) & pool->mask;
+    }
+
+    return slot;
+}
+
+static NE_strid NE_strpoolAdd(struct NE_strpool *pool, const char *str, size_t len, uint32_t h) {
+    size_t need = NE_STRPOOL_RECORD_HEADER + len + 1;
+
+    if (pool->nchunks == 0 || pool->used + need > NE_STRPOOL_CHUNK) {
+        if (pool->nchunks == pool->max_chunks)
+            return 0;
+
+        uint8_t *chunk = NE_strpoolAlloc(pool, NE_STRPOOL_CHUNK);
+        if (!chunk)
+            return 0;
+
+        pool->chunks[pool->nchunks++] = chunk;
+        pool->used = 0;
+    }
+
+    uint8_t *rec = pool->chunks[pool->nchunks - 1] + pool->used;
+    rec[0] = (uint8_t)h;
+    rec[1] = (uint8_t)(h >> 8);
+    rec[2] = (uint8_t)(h >> 16);
+    rec[3] = (uint8_t)(h >> 24);
+    rec[4] = (uint8_t)len;
+    memcpy(rec + NE_STRPOOL_RECORD_HEADER, str, len);
+    rec[NE_STRPOOL_RECORD_HEADER + len] = '\0';
+
+    NE_strid id = (((pool->nchunks - 1) << 16) | pool->used) + 1;
+
+    // keep records 4-byte aligned
+    pool->used += (uint32_t)((need + 3) & ~(size_t)3);
+    return id;
+}
+
+NE_strid NE_strpoolIntern(struct NE_strpool *pool, const char *str, size_t len) {
+    NE_strid id = 0;
+
+    if (len > 0xFF)
+        return 0;
+
+    uint32_t h = NE_strHash(str, len);
+
+    if (pool->locked)
+        pthread_mutex_lock(&pool->lock);
+
+    // keep the load factor under 1/2
+    if ((!pool->index || (pool->count + 1) * 2 > pool->mask + 1) &&
+        NE_strpoolGrowIndex(pool) < 0)
+        goto exit_intern;
+
+    size_t slot = NE_strpoolProbe(pool, str, len, h);
+    id = pool->index[slot];
+
+    if (!id) {
+        id = NE_strpoolAdd(pool, str, len, h);
+        if (id) {
+            pool->index[slot] = id;
+            pool->count++;
+        }
+    }
+
+exit_intern:
+    if (pool->locked)
+        pthread_mutex_unlock(&pool->lock);
+
+    return id;
+}
+
+NE_strid NE_strpoolFind(struct NE_strpool *pool, const char *str, size_t len) {
+    NE_strid id = 0;
+
+    if (len > 0xFF)
+        return 0;
+
+    uint32_t h = NE_strHash(str, len);
+
+    if (pool->locked)
+        pthread_mutex_lock(&pool->lock);
+
+    if (pool->index)
+        id = pool->index[NE_strpoolProbe(pool, str, len, h)];
+
+    if (pool->locked)
+        pthread_mutex_unlock(&pool->lock);
+
+    return id;
+}
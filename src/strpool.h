@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+//
+// Interned strings. Every distinct counted string is stored once, in
+// 64K chunks that never move, as [hash:4][len:1][text][NUL]. A string is
+// referred to by a 32-bit id, so within one pool two names are equal
+// exactly when their ids are.
+//
+// A pool either lives in an arena (one per exe, gone on arena reset) or
+// on the heap. With `locked` set interning takes a mutex, so one pool can
+// be shared by every worker of a batch. Reading a string by id never
+// locks: chunks are never moved or freed while the pool is alive.
+//
+#pragma once
+#include "arena.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t NE_strid; // 0 = no string
+
+#define NE_STRPOOL_CHUNK      0x10000
+#define NE_STRPOOL_EXE_CHUNKS 64      // 4 MiB of names per exe
+#define NE_STRPOOL_MAX_CHUNKS 0x10000 // what fits in an id
+
+struct NE_strpool {
+    struct NE_arena *arena;  // NULL: heap backed
+    int locked;
+    pthread_mutex_t lock;
+
+    uint8_t **chunks;        // fixed size table, max_chunks long
+    uint32_t max_chunks;
+    uint32_t nchunks;
+    uint32_t used;           // bytes used in the last chunk
+
+    NE_strid *index;         // open addressing, by hash
+    size_t mask;
+    size_t count;
+};
+
+int NE_strpoolInit(struct NE_strpool *pool, struct NE_arena *arena, uint32_t max_chunks);
+int NE_strpoolInitShared(struct NE_strpool *pool);
+void NE_strpoolSetLocked(struct NE_strpool *pool, int locked);
+void NE_strpoolFree(struct NE_strpool *pool);
+
+uint32_t NE_strHash(const char *str, size_t len);
+
+// Returns the id of `str`, adding it if needed. 0 if out of memory or the
+// string is longer than 255 bytes.
+NE_strid NE_strpoolIntern(struct NE_strpool *pool, const char *str, size_t len);
+
+// Like NE_strpoolIntern but never adds, 0 if the string isn't in the pool
+NE_strid NE_strpoolFind(struct NE_strpool *pool, const char *str, size_t len);
+
+static inline const uint8_t *NE_strpoolRecord(const struct NE_strpool *pool, NE_strid id) {
+    id--;
+    return pool->chunks[id >> 16] + (id & 0xFFFF);
+}
+
+// NUL terminated text of an id, NULL for id 0
+static inline const char *NE_strpoolGet(const struct NE_strpool *pool, NE_strid id) {
+    return id ? (const char *)NE_strpoolRecord(pool, id) + 5 : NULL;
+}
+
+static inline size_t NE_strpoolLen(const struct NE_strpool *pool, NE_strid id) {
+    return id ? NE_strpoolRecord(pool, id)[4] : 0;
+}
+
+static inline uint32_t NE_strpoolHash(const struct NE_strpool *pool, NE_strid id) {
+    const uint8_t *rec = NE_strpoolRecord(pool, id);
+    return (uint32_t)rec[0] | ((uint32_t)rec[1] << 8) |
+        ((uint32_t)rec[2] << 16) | ((uint32_t)rec[3] << 24);
+}
@@ -0,0 +1,584 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include "watch.h"
+#include "batch.h"
+#include "index.h"
+#include "json.h"
+#include "stb_ds.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NE_WATCH_DIR_MASK \
+    (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_ONLYDIR)
+#define NE_WATCH_FILE_MASK \
+    (IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+int NE_watcherInit(struct NE_watcher *w) {
+    w->dirs = NULL;
+    w->overflow = 0;
+    w->fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    return w->fd < 0 ? -1 : 0;
+}
+
+void NE_watcherFree(struct NE_watcher *w) {
+    for (ptrdiff_t i = 0; i < arrlen(w->dirs); i++)
+        free(w->dirs[i]);
+
+    arrfree(w->dirs);
+    if (w->fd >= 0)
+        close(w->fd);
+    w->fd = -1;
+}
+
+static char *NE_watchJoin(const char *dir, const char *name) {
+    size_t dir_len = strlen(dir);
+    size_t len = dir_len + 1 + strlen(name) + 1;
+    char *path = malloc(len);
+
+    if (path)
+        snprintf(path, len, "%s%s%s", dir, (dir_len && dir[dir_len - 1] == '/') ? "" : "/", name);
+    return path;
+}
+
+static int NE_watchRemember(struct NE_watcher *w, int wd, const char *path) {
+    char *copy = strdup(path);
+    if (!copy)
+        return -1;
+
+    while (arrlen(w->dirs) <= wd)
+        arrput(w->dirs, NULL);
+
+    free(w->dirs[wd]);
+    w->dirs[wd] = copy;
+    return 0;
+}
+
+// Files get a watch of their own only when named as a root, in a tree the
+// watch of their directory reports them. A watch that can't be added
+// (ENOSPC past max_user_watches, say) doesn't stop the walk: every file is
+// still listed, the return value says some changes won't be seen.
+static int NE_watchTree(struct NE_watcher *w, const char *path, char ***files, int root) {
+    struct stat st;
+    int ret = 0;
+
+    // like the batch walk, symlinked directories aren't followed
+    if (lstat(path, &st) != 0)
+        return -1;
+
+    if (S_ISLNK(st.st_mode) && (stat(path, &st) != 0 || S_ISDIR(st.st_mode)))
+        return 0;
+
+    if (!S_ISDIR(st.st_mode)) {
+        if (root) {
+            int wd = inotify_add_watch(w->fd, path, NE_WATCH_FILE_MASK);
+            if (wd < 0 || NE_watchRemember(w, wd, path) < 0)
+                ret = -1;
+        }
+
+        char *copy = strdup(path);
+        if (!copy)
+            return -1;
+        arrput(*files, copy);
+        return ret;
+    }
+
+    // watch before listing, a file written in between shows up in both
+    int wd = inotify_add_watch(w->fd, path, NE_WATCH_DIR_MASK);
+    if (wd < 0 || NE_watchRemember(w, wd, path) < 0)
+        ret = -1;
+    int saved = errno;
+
+    DIR *dir = opendir(path);
+    if (!dir)
+        return -1;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+            continue;
+
+        char *child = NE_watchJoin(path, ent->d_name);
+        if (!child) {
+            saved = errno;
+            ret = -1;
+            break;
+        }
+
+        // a child that vanished meanwhile isn't an error
+        if (NE_watchTree(w, child, files, 0) < 0 && errno != ENOENT) {
+            saved = errno;
+            ret = -1;
+        }
+        free(child);
+    }
+
+    closedir(dir);
+    errno = saved;
+    return ret;
+}
+
+int NE_watcherAdd(struct NE_watcher *w, const char *path, char ***files) {
+    return NE_watchTree(w, path, files, 1);
+}
+
+// A directory moved away keeps its watches (they follow the inode), under
+// a path that is wrong now. Drop them, a move within the tree adds it back.
+static void NE_watchForget(struct NE_watcher *w, const char *path) {
+    size_t len = strlen(path);
+
+    for (ptrdiff_t wd = 0; wd < arrlen(w->dirs); wd++) {
+        const char *dir = w->dirs[wd];
+
+        if (dir && strncmp(dir, path, len) == 0 && (dir[len] == '\0' || dir[len] == '/')) {
+            inotify_rm_watch(w->fd, (int)wd);
+            free(w->dirs[wd]);
+            w->dirs[wd] = NULL;
+        }
+    }
+}
+
+static void NE_watchPush(char ***list, const char *dir, const char *name) {
+    char *path = name ? NE_watchJoin(dir, name) : strdup(dir);
+    if (path)
+        arrput(*list, path);
+}
+
+int NE_watcherPoll(struct NE_watcher *w, int timeout_ms, char ***changed, char ***removed) {
+    char buf[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd = { .fd = w->fd, .events = POLLIN };
+    int events = 0;
+
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready <= 0)
+        return ready;
+
+    while (1) {
+        ssize_t len = read(w->fd, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EAGAIN)
+                break;
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(*ev) + ev->len;
+            events++;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                w->overflow = 1;
+                continue;
+            }
+
+            if (ev->wd < 0 || ev->wd >= arrlen(w->dirs) || !w->dirs[ev->wd])
+                continue;
+
+            const char *dir = w->dirs[ev->wd];
+            const char *name = ev->len ? ev->name : NULL;
+
+            if (ev->mask & IN_IGNORED) {
+                // the watch is gone, the descriptor may be reused
+                free(w->dirs[ev->wd]);
+                w->dirs[ev->wd] = NULL;
+                continue;
+            }
+
+            if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    char *sub = NE_watchJoin(dir, name);
+                    if (sub && NE_watcherAdd(w, sub, changed) < 0 && errno != ENOENT)
+                        w->overflow = 1; // couldn't watch it, rescan later
+                    free(sub);
+                } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    char *sub = NE_watchJoin(dir, name);
+                    if (sub && (ev->mask & IN_MOVED_FROM))
+                        NE_watchForget(w, sub);
+                    if (sub)
+                        arrput(*removed, sub);
+                }
+                continue;
+            }
+
+            if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                NE_watchPush(changed, dir, name);
+            else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                NE_watchPush(removed, dir, name);
+            else if (!name && (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)))
+                NE_watchPush(removed, dir, NULL);
+        }
+    }
+
+    return events;
+}
+
+// What is known about one file
+struct NE_watchFile {
+    char *key;                  // path
+    struct NE_indexRecord rec;
+    struct stat st;             // as it was when parsed
+};
+
+struct NE_watchState {
+    const struct NE_batch *config;  // threads and I/O settings for each run
+    NE_watchParseFn parse;
+    void *ctx;
+    char **roots;
+    int root_count;
+    const char *output;             // index to keep fresh, or NULL
+    const char *output_name;        // its basename, never parsed itself
+    struct NE_watchFile *files;    // stb_ds string hashmap
+    struct NE_json *js;             // events on stdout
+};
+
+// Quiet period after an event before anything is parsed, so a directory
+// being copied in is handled as one batch
+#define NE_WATCH_SETTLE_MS 200
+#define NE_WATCH_SETTLE_MAX 25     // settle periods to wait at most
+
+static int NE_watchSameFile(const struct stat *a, const struct stat *b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino &&
+        a->st_size == b->st_size &&
+        a->st_mtim.tv_sec == b->st_mtim.tv_sec &&
+        a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+static void NE_watchEvent(struct NE_watchState *w, const char *event, const char *path, int parsed) {
+    NE_jsonBeginObject(w->js);
+    NE_jsonFieldString(w->js, "event", event);
+    NE_jsonFieldString(w->js, "path", path);
+    if (parsed >= 0)
+        NE_jsonFieldBool(w->js, "parsed", parsed);
+    NE_jsonEndObject(w->js);
+    NE_jsonEndLine(w->js);
+}
+
+// The index and the temp files it's written through
+static int NE_watchIgnored(const struct NE_watchState *w, const char *path) {
+    if (!w->output_name)
+        return 0;
+
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+    size_t len = strlen(w->output_name);
+
+    return strncmp(name, w->output_name, len) == 0 && (name[len] == '\0' || name[len] == '.');
+}
+
+static int NE_watchDrop(struct NE_watchState *w, const char *path) {
+    ptrdiff_t i = shgeti(w->files, path);
+    if (i < 0)
+        return 0;
+
+    NE_watchEvent(w, "removed", path, -1);
+    NE_indexRecordFree(&w->files[i].rec);
+    (void)shdel(w->files, path);
+    return 1;
+}
+
+// A removed path may be a whole directory
+static int NE_watchRemove(struct NE_watchState *w, const char *path) {
+    size_t len = strlen(path);
+    char **gone = NULL;
+    int removed = NE_watchDrop(w, path);
+
+    for (ptrdiff_t i = 0; i < shlen(w->files); i++) {
+        const char *key = w->files[i].key;
+        if (strncmp(key, path, len) == 0 && key[len] == '/')
+            arrput(gone, strdup(key));
+    }
+
+    for (ptrdiff_t i = 0; i < arrlen(gone); i++) {
+        if (gone[i])
+            removed += NE_watchDrop(w, gone[i]);
+        free(gone[i]);
+    }
+
+    arrfree(gone);
+    return removed;
+}
+
+// Parse `paths` (taken over) on the batch pool and keep their records
+static int NE_watchParse(struct NE_watchState *w, char **paths, struct stat *sts) {
+    struct NE_batch batch = {0};
+    size_t count = arrlenu(paths);
+
+    if (count == 0) {
+        arrfree(paths);
+        return 0;
+    }
+
+    struct NE_indexRecord *records = calloc(count, sizeof(*records));
+    if (!records) {
+        for (size_t i = 0; i < count; i++)
+            free(paths[i]);
+        arrfree(paths);
+        return -1;
+    }
+
+    batch.paths = paths;
+    batch.threads = w->config->threads;
+    batch.io_depth = w->config->io_depth;
+    batch.io_backend = w->config->io_backend;
+
+    w->parse(&batch, records, w->ctx);
+
+    for (size_t i = 0; i < count; i++) {
+        struct NE_watchFile file = { paths[i], records[i], sts[i] };
+        ptrdiff_t old = shgeti(w->files, paths[i]);
+
+        if (old >= 0)
+            NE_indexRecordFree(&w->files[old].rec);
+
+        NE_watchEvent(w, old >= 0 ? "updated" : "added", paths[i], records[i].Status);
+        shputs(w->files, file);
+    }
+
+    free(records);
+    NE_freeBatch(&batch);
+    return (int)count;
+}
+
+// Work out which of `changed` really are new or different, then parse
+// those. Returns the number of files added, updated or removed.
+static int NE_watchUpdate(struct NE_watchState *w, char **changed) {
+    char **parse = NULL;
+    struct stat *sts = NULL;
+    struct { char *key; int value; } *seen = NULL;
+    int updates = 0;
+
+    sh_new_arena(seen);
+
+    for (ptrdiff_t i = 0; i < arrlen(changed); i++) {
+        const char *path = changed[i];
+        struct stat st;
+
+        if (shgeti(seen, path) >= 0 || NE_watchIgnored(w, path))
+            continue;
+        shput(seen, path, 1);
+
+        if (stat(path, &st) != 0) {
+            updates += NE_watchDrop(w, path); // gone again already
+            continue;
+        }
+
+        if (!S_ISREG(st.st_mode))
+            continue;
+
+        ptrdiff_t known = shgeti(w->files, path);
+        if (known >= 0 && NE_watchSameFile(&w->files[known].st, &st))
+            continue;
+
+        char *copy = strdup(path);
+        if (!copy)
+            continue;
+
+        arrput(parse, copy);
+        arrput(sts, st);
+    }
+
+    shfree(seen);
+
+    int parsed = NE_watchParse(w, parse, sts);
+    arrfree(sts);
+
+    return updates + (parsed > 0 ? parsed : 0);
+}
+
+// Walk every root again, after the kernel dropped events or at startup
+static int NE_watchRescan(struct NE_watchState *w, struct NE_watcher *watcher) {
+    char **found = NULL;
+    char **gone = NULL;
+    struct { char *key; int value; } *present = NULL;
+    int updates = 0;
+
+    for (int i = 0; i < w->root_count; i++) {
+        // what was found is indexed even if some of it isn't watched
+        if (NE_watcherAdd(watcher, w->roots[i], &found) < 0)
+            fprintf(stderr, "ned: %s: Failed to watch, changes may be missed: %s\n", w->roots[i], strerror(errno));
+    }
+
+    sh_new_arena(present);
+    for (ptrdiff_t i = 0; i < arrlen(found); i++)
+        shput(present, found[i], 1);
+
+    for (ptrdiff_t i = 0; i < shlen(w->files); i++) {
+        if (shgeti(present, w->files[i].key) < 0)
+            arrput(gone, strdup(w->files[i].key));
+    }
+
+    for (ptrdiff_t i = 0; i < arrlen(gone); i++) {
+        if (gone[i])
+            updates += NE_watchDrop(w, gone[i]);
+        free(gone[i]);
+    }
+
+    updates += NE_watchUpdate(w, found);
+
+    for (ptrdiff_t i = 0; i < arrlen(found); i++)
+        free(found[i]);
+    arrfree(found);
+    arrfree(gone);
+    shfree(present);
+    return updates;
+}
+
+static int NE_watchComparePaths(const void *a, const void *b) {
+    const struct NE_watchFile *fa = *(const struct NE_watchFile *const *)a;
+    const struct NE_watchFile *fb = *(const struct NE_watchFile *const *)b;
+    return strcmp(fa->key, fb->key);
+}
+
+// The records are kept, only the columns are rebuilt: no file is read
+static int NE_watchWriteIndex(struct NE_watchState *w) {
+    struct NE_indexBuilder index;
+    size_t count = (size_t)shlen(w->files);
+    int ret = -1;
+
+    // ids in path order, like `ned index` over the same tree
+    struct NE_watchFile **sorted = malloc((count ? count : 1) * sizeof(*sorted));
+    if (!sorted)
+        return -1;
+
+    for (size_t i = 0; i < count; i++)
+        sorted[i] = &w->files[i];
+    qsort(sorted, count, sizeof(*sorted), NE_watchComparePaths);
+
+    if (NE_indexBuilderInit(&index, count) == 0) {
+        ret = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (NE_indexBuilderAddRecord(&index, i, &sorted[i]->rec) < 0)
+                ret = -1;
+        }
+
+        if (ret == 0)
+            ret = NE_indexBuilderWrite(&index, w->output);
+        NE_indexBuilderFree(&index);
+    }
+
+    free(sorted);
+
+    if (ret < 0) {
+        fprintf(stderr, "ned: %s: Failed to write index: %s\n", w->output, strerror(errno));
+        return -1;
+    }
+
+    NE_jsonBeginObject(w->js);
+    NE_jsonFieldString(w->js, "event", "index");
+    NE_jsonFieldString(w->js, "path", w->output);
+    NE_jsonFieldUInt(w->js, "files", count);
+    NE_jsonEndObject(w->js);
+    NE_jsonEndLine(w->js);
+    return 0;
+}
+
+int NE_watch(
+    const struct NE_batch *config,
+    char **roots,
+    int root_count,
+    const char *output,
+    NE_watchParseFn parse,
+    void *ctx,
+    volatile sig_atomic_t *stop
+) {
+    struct NE_watchState w = {
+        .config = config,
+        .parse = parse,
+        .ctx = ctx,
+        .roots = roots,
+        .root_count = root_count,
+        .output = output
+    };
+    struct NE_watcher watcher;
+    int ret = 0;
+
+    if (output) {
+        const char *slash = strrchr(output, '/');
+        w.output_name = slash ? slash + 1 : output;
+    }
+
+    w.js = malloc(sizeof(*w.js));
+    if (!w.js || NE_watcherInit(&watcher) < 0) {
+        fprintf(stderr, "ned: Failed to start watching: %s\n", strerror(errno));
+        free(w.js);
+        return -1;
+    }
+
+    NE_jsonInit(w.js, stdout);
+    sh_new_strdup(w.files);
+
+    NE_watchRescan(&w, &watcher);
+    if (output && NE_watchWriteIndex(&w) < 0)
+        ret = -1;
+    NE_jsonFlush(w.js);
+    fflush(stdout);
+
+    while (!*stop) {
+        char **changed = NULL;
+        char **removed = NULL;
+        int updates = 0;
+
+        int events = NE_watcherPoll(&watcher, -1, &changed, &removed);
+        for (int i = 0; events > 0 && i < NE_WATCH_SETTLE_MAX && !*stop; i++) {
+            events = NE_watcherPoll(&watcher, NE_WATCH_SETTLE_MS, &changed, &removed);
+        }
+
+        if (events < 0 && errno != EINTR) {
+            fprintf(stderr, "ned: Failed to read events: %s\n", strerror(errno));
+            ret = -1;
+            *stop = 1;
+        }
+
+        if (watcher.overflow) {
+            watcher.overflow = 0;
+            updates += NE_watchRescan(&w, &watcher);
+        } else {
+            for (ptrdiff_t i = 0; i < arrlen(removed); i++)
+                updates += NE_watchRemove(&w, removed[i]);
+            updates += NE_watchUpdate(&w, changed);
+        }
+
+        if (updates && output && NE_watchWriteIndex(&w) < 0)
+            ret = -1;
+
+        // the events are for whoever reads the other end of a pipe now,
+        // not when stdio's buffer happens to fill up
+        NE_jsonFlush(w.js);
+        fflush(stdout);
+
+        for (ptrdiff_t i = 0; i < arrlen(changed); i++)
+            free(changed[i]);
+        for (ptrdiff_t i = 0; i < arrlen(removed); i++)
+            free(removed[i]);
+        arrfree(changed);
+        arrfree(removed);
+    }
+
+    for (ptrdiff_t i = 0; i < shlen(w.files); i++)
+        NE_indexRecordFree(&w.files[i].rec);
+    shfree(w.files);
+    NE_watcherFree(&watcher);
+    free(w.js);
+    return ret;
+}
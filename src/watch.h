@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025 AllMeatball
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+//
+// Recursive file watching for `ned watch`, on Linux inotify. Directories
+// are watched with everything below them; directories created later are
+// picked up as they appear. Events come out as two lists of paths: files
+// that were written or moved in, and files or whole directories that went
+// away.
+//
+// NE_watch is `ned watch` on top of it: the files are parsed in batches
+// as they change and the index is rebuilt from the records kept for them.
+//
+#pragma once
+#include <signal.h>
+#include <stddef.h>
+
+struct NE_batch;
+struct NE_indexRecord;
+
+struct NE_watcher {
+    int fd;
+    char **dirs;        // stb_ds array indexed by watch descriptor, or NULL
+    int overflow;       // events were lost, rescan everything
+};
+
+int NE_watcherInit(struct NE_watcher *w);
+void NE_watcherFree(struct NE_watcher *w);
+
+// Watch `path`, a file or a directory tree, and append every file found
+// in it to `files` (stb_ds array of malloc'd paths). Returns -1 with errno
+// set if some of it couldn't be watched; the files are listed anyway.
+int NE_watcherAdd(struct NE_watcher *w, const char *path, char ***files);
+
+// Wait up to `timeout_ms` (-1 = forever) and append what happened to
+// `changed` and `removed` (both stb_ds arrays of malloc'd paths). New
+// directories are watched and their files appended to `changed`.
+// Returns the number of events, 0 on timeout, -1 on error (e.g. EINTR).
+int NE_watcherPoll(struct NE_watcher *w, int timeout_ms, char ***changed, char ***removed);
+
+// Parse the paths of `batch` into `records`, one per path
+typedef void (*NE_watchParseFn)(struct NE_batch *batch, struct NE_indexRecord *records, void *ctx);
+
+// Parse every file under `roots`, then again whenever one changes, until
+// `*stop` is set. Each file added, updated or removed is a JSON event on
+// stdout, and the index at `output` (unless NULL) is rewritten after every
+// batch. `config` has the thread and I/O settings for the batches.
+// Returns -1 if watching couldn't start or an index couldn't be written.
+int NE_watch(
+    const struct NE_batch *config,
+    char **roots,
+    int root_count,
+    const char *output,
+    NE_watchParseFn parse,
+    void *ctx,
+    volatile sig_atomic_t *stop
+);